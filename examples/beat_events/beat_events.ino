@@ -0,0 +1,90 @@
+#include <Arduino.h>
+#include <Wire.h>
+#include <ReWire_MAX32664.h>
+
+// Reset pin, MFIO pin
+// Set these to match the pin values on your board!!!
+int reset_pin = 0;
+int mfio_pin = 2;
+
+// Pin driving the haptic motor
+int haptic_pin = 4;
+
+// An instance of the MAX32664. We are using the default I2C instance.
+// Change this to match the values for your board.
+ReWire_MAX32664 max32664 = ReWire_MAX32664(&Wire, mfio_pin, reset_pin);
+
+uint32_t haptic_off_ms = 0;
+
+// Called from inside ReadSample_BPTSensorAndAlgorithm() and ReadSensorHubStatus(), as soon as
+// each record is decoded. Keep it short.
+void on_event(const MAX32664_Event &event, void *context)
+{
+    switch (event.type)
+    {
+    case Event_Beat:
+        digitalWrite(haptic_pin, HIGH);
+        haptic_off_ms = millis() + 50;
+        break;
+    case Event_BptStatus:
+        Serial.print("BP status: ");
+        Serial.println(event.current);
+        break;
+    case Event_BptProgress:
+        Serial.print("Progress: ");
+        Serial.println(event.current);
+        break;
+    case Event_FifoOverflow:
+        Serial.println("[DEBUG] FIFO overflow");
+        break;
+    }
+}
+
+void setup()
+{
+    // Initialize serial communication and I2C
+    Serial.begin(115200);
+    Wire.begin();
+    pinMode(haptic_pin, OUTPUT);
+
+    uint8_t device_mode;
+    uint8_t result = max32664.Begin(device_mode);
+    if (result == MAX32664_ReadStatusByteValue::SUCCESS_STATUS && device_mode == MAX32664_DeviceOperatingMode::ApplicationMode)
+    {
+        // Subscribe before configuring, so the hub is configured with a FIFO threshold of one
+        // sample and every beat is read as soon as the hub reports it
+        max32664.SetEventCallback(on_event, NULL, Event_Beat | Event_BptStatus | Event_BptProgress | Event_FifoOverflow, true);
+        result = max32664.ConfigureBPT_SensorAndAlgorithm();
+    }
+    if (result != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        Serial.println("[DEBUG] Could not configure the sensor!");
+        while (1)
+        {
+            // empty
+        }
+    }
+}
+
+void loop()
+{
+    uint8_t hub_status;
+    uint8_t num_samples = 0;
+    uint8_t result = max32664.ReadSensorHubStatus(hub_status);
+    if (result == MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        result = max32664.ReadNumberAvailableSamples(num_samples);
+    }
+
+    for (uint8_t i = 0; result == MAX32664_ReadStatusByteValue::SUCCESS_STATUS && i < num_samples; i++)
+    {
+        MAX32664_Data_VerD sample;
+        result = max32664.ReadSample_BPTSensorAndAlgorithm(sample);
+    }
+
+    if (haptic_off_ms != 0 && (int32_t)(millis() - haptic_off_ms) >= 0)
+    {
+        digitalWrite(haptic_pin, LOW);
+        haptic_off_ms = 0;
+    }
+}
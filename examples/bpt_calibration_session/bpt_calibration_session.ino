@@ -0,0 +1,96 @@
+#include <Arduino.h>
+#include <Wire.h>
+#include <ReWire_MAX32664.h>
+#include <MAX32664_Calibration.h>
+
+// Reset pin, MFIO pin
+// Set these to match the pin values on your board!!!
+int reset_pin = 0;
+int mfio_pin = 2;
+
+// An instance of the MAX32664. We are using the default I2C instance.
+// Change this to match the values for your board.
+ReWire_MAX32664 max32664 = ReWire_MAX32664(&Wire, mfio_pin, reset_pin);
+
+MAX32664_CalibrationSession calibration = MAX32664_CalibrationSession(&max32664);
+
+// Systolic and diastolic reference values from a medically approved device, one per cal_index
+MAX32664_CalibrationReference references[MAX32664_CALIBRATION_POINTS] = {
+    {117, 76}, {119, 78}, {121, 77}, {118, 75}, {120, 79}};
+
+// The calibration vectors; store them with the user profile
+uint8_t vectors[MAX32664_CALIBRATION_POINTS * CALIBVECTOR_SIZE];
+
+void setup()
+{
+    // Initialize serial communication and I2C
+    Serial.begin(115200);
+    Wire.begin();
+
+    uint8_t device_mode;
+    uint8_t result = max32664.Begin(device_mode);
+    if (result != MAX32664_ReadStatusByteValue::SUCCESS_STATUS || device_mode != MAX32664_DeviceOperatingMode::ApplicationMode)
+    {
+        Serial.println("[DEBUG] Could not communicate with the sensor!");
+        while (1)
+        {
+            // empty
+        }
+    }
+
+    calibration.Begin(references, MAX32664_CALIBRATION_POINTS, vectors);
+}
+
+void loop()
+{
+    MAX32664_CalibrationState state = calibration.GetState();
+    if (state == CalibrationState_Done || state == CalibrationState_Failed)
+    {
+        return;
+    }
+
+    uint8_t cal_index = calibration.GetCurrentIndex();
+    state = calibration.Step();
+
+    if (state == CalibrationState_Collect)
+    {
+        // Do other work here; the session only needs to be stepped every few tens of milliseconds
+        delay(40);
+        return;
+    }
+
+    // Report each point as soon as it is finished
+    MAX32664_CalibrationPointResult point;
+    calibration.GetPointResult(cal_index, point);
+    if (point.complete || state == CalibrationState_Failed)
+    {
+        Serial.print("cal_index ");
+        Serial.print(cal_index);
+        Serial.print(point.complete ? " done" : " failed");
+        Serial.print("\tbp_status: ");
+        Serial.print(point.bp_status);
+        Serial.print("\ttime (ms): ");
+        Serial.print(point.wall_ms);
+        Serial.print("\tcommands: ");
+        Serial.print(point.transactions);
+        Serial.print("\tbytes: ");
+        Serial.println(point.bytes);
+    }
+    if (state == CalibrationState_Done)
+    {
+        // Configuring the hub and turning it off belong to no point
+        MAX32664_CalibrationCost overhead;
+        calibration.GetOverhead(overhead);
+        Serial.print("setup and shutdown\ttime (ms): ");
+        Serial.print(overhead.wall_ms);
+        Serial.print("\tcommands: ");
+        Serial.print(overhead.transactions);
+        Serial.print("\tbytes: ");
+        Serial.println(overhead.bytes);
+    }
+    if (state == CalibrationState_Failed)
+    {
+        Serial.print("[DEBUG] Calibration failed, status: ");
+        Serial.println(calibration.GetStatus());
+    }
+}
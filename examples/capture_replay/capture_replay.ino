@@ -0,0 +1,130 @@
+#include <Arduino.h>
+#include <Wire.h>
+#include <SD.h>
+#include <ReWire_MAX32664.h>
+#include <MAX32664_Capture.h>
+
+// Reset pin, MFIO pin
+// Set these to match the pin values on your board!!!
+int reset_pin = 0;
+int mfio_pin = 2;
+
+// The capture file on the SD card, and the number of FIFO drains to record
+const char *capture_path = "/max32664.cap";
+const int capture_drains = 500;
+
+// An instance of the MAX32664. We are using the default I2C instance.
+// Change this to match the values for your board.
+ReWire_MAX32664 max32664 = ReWire_MAX32664(&Wire, mfio_pin, reset_pin);
+
+// Drains the output FIFO once, the same way basic_example does
+int DrainFifo()
+{
+    int num_read = 0;
+    uint8_t sensor_hub_status;
+    uint8_t read_status = max32664.ReadSensorHubStatus(sensor_hub_status);
+    if (read_status == MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        uint8_t num_available_samples;
+        read_status = max32664.ReadNumberAvailableSamples(num_available_samples);
+        if (read_status == MAX32664_ReadStatusByteValue::SUCCESS_STATUS && num_available_samples > 0)
+        {
+            for (int i = 0; i < num_available_samples; i++)
+            {
+                MAX32664_Data current_sample;
+                if (max32664.ReadSample_SensorAndAlgorithm(current_sample) == MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+                {
+                    num_read++;
+                }
+            }
+        }
+    }
+    return num_read;
+}
+
+void setup()
+{
+    // Initialize serial communication, I2C and the SD card
+    Serial.begin(115200);
+    Wire.begin();
+    if (!SD.begin())
+    {
+        Serial.println("[DEBUG] Could not open the SD card!");
+        while (1)
+        {
+            // empty
+        }
+    }
+
+    // Initialize and configure the MAX32664 biohub
+    uint8_t device_mode;
+    uint8_t result = max32664.Begin(device_mode);
+    if (result == MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        result = max32664.ConfigureDevice_SensorAndAlgorithm();
+    }
+    if (result != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        Serial.println("[DEBUG] Could not start the sensor!");
+        while (1)
+        {
+            // empty
+        }
+    }
+
+    // Record: every byte exchanged with the hub goes to the capture file
+    Serial.println("[DEBUG] Capturing...");
+    File capture_file = SD.open(capture_path, FILE_WRITE);
+    MAX32664_CaptureBus capture_bus(max32664.GetBus(), &capture_file);
+    capture_bus.Begin();
+    max32664.SetBus(&capture_bus);
+    int samples_captured = 0;
+    for (int i = 0; i < capture_drains; i++)
+    {
+        samples_captured += DrainFifo();
+        delay(40);
+    }
+    max32664.SetBus(NULL);
+    capture_file.close();
+
+    Serial.print("[DEBUG] Captured samples: ");
+    Serial.print(samples_captured);
+    Serial.print(", bytes: ");
+    Serial.println(capture_bus.GetBytesCaptured());
+
+    // Replay: the same code runs against the capture file at maximum speed, which gives a
+    // repeatable measure of how long the driver spends outside of the bus.
+    Serial.println("[DEBUG] Replaying...");
+    File replay_file = SD.open(capture_path, FILE_READ);
+    MAX32664_ReplayBus replay_bus(&replay_file, ReplayMaximumSpeed);
+    if (!replay_bus.Begin())
+    {
+        Serial.println("[DEBUG] Not a capture file!");
+        while (1)
+        {
+            // empty
+        }
+    }
+    max32664.SetBus(&replay_bus);
+    int samples_replayed = 0;
+    unsigned long start_us = micros();
+    for (int i = 0; i < capture_drains; i++)
+    {
+        samples_replayed += DrainFifo();
+    }
+    unsigned long elapsed_us = micros() - start_us;
+    max32664.SetBus(NULL);
+    replay_file.close();
+
+    Serial.print("[DEBUG] Replayed samples: ");
+    Serial.print(samples_replayed);
+    Serial.print(", mismatches: ");
+    Serial.print(replay_bus.GetMismatches());
+    Serial.print(", time (us): ");
+    Serial.println(elapsed_us);
+}
+
+void loop()
+{
+    // empty
+}
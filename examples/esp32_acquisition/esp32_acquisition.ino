@@ -0,0 +1,73 @@
+// ESP32 only: the MAX32664 is read by a FreeRTOS task and shares the I2C bus with other drivers.
+#include <Arduino.h>
+#include <Wire.h>
+#include <ReWire_MAX32664.h>
+#include <MAX32664_Acquisition.h>
+
+// Reset pin, MFIO pin
+// Set these to match the pin values on your board!!!
+int reset_pin = 4;
+int mfio_pin = 5;
+
+// One mutex per physical bus. Every driver on the bus has to hold it while it uses the bus.
+MAX32664_Mutex wire_mutex;
+MAX32664_WireBus wire_bus = MAX32664_WireBus(&Wire);
+MAX32664_LockedBus locked_bus = MAX32664_LockedBus(&wire_bus, &wire_mutex);
+
+ReWire_MAX32664 max32664 = ReWire_MAX32664(&Wire, mfio_pin, reset_pin);
+MAX32664_Acquisition acquisition = MAX32664_Acquisition(&max32664);
+
+void setup()
+{
+    Serial.begin(115200);
+    Wire.begin();
+
+    // The hub only holds the bus while bytes are transferred, not during its command delays
+    max32664.SetBus(&locked_bus);
+
+    uint8_t device_mode;
+    uint8_t result = max32664.Begin(device_mode);
+    if (result == MAX32664_ReadStatusByteValue::SUCCESS_STATUS && device_mode == MAX32664_DeviceOperatingMode::ApplicationMode)
+    {
+        result = max32664.ConfigureDevice();
+    }
+    if (result != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        Serial.println("[DEBUG] Could not configure the sensor!");
+        while (1)
+        {
+            delay(1000);
+        }
+    }
+
+    // Poll the output FIFO every 20 ms in the background
+    acquisition.Start(20);
+}
+
+void loop()
+{
+    // Another driver on the same bus
+    wire_mutex.Lock();
+    Wire.beginTransmission(0x48);
+    Wire.write(0x00);
+    Wire.endTransmission();
+    wire_mutex.Unlock();
+
+    MAX32664_AcquiredSample sample;
+    while (acquisition.Pop(sample))
+    {
+        Serial.print(sample.time_ms);
+        Serial.print("\tHR: ");
+        Serial.print(sample.bpt ? sample.bpt_data.hr : sample.data.hr);
+        Serial.print("\tSpO2: ");
+        Serial.println(sample.bpt ? sample.bpt_data.spo2 : sample.data.spo2);
+    }
+
+    if (acquisition.GetDropped() > 0)
+    {
+        Serial.print("[DEBUG] Dropped samples: ");
+        Serial.println(acquisition.GetDropped());
+    }
+
+    delay(100);
+}
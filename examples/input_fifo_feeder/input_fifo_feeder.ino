@@ -0,0 +1,140 @@
+#include <Arduino.h>
+#include <Wire.h>
+#include <ReWire_MAX32664.h>
+#include <MAX32664_InputFeeder.h>
+
+// Reset pin, MFIO pin
+// Set these to match the pin values on your board!!!
+int reset_pin = 0;
+int mfio_pin = 2;
+
+// Rate at which the algorithm consumes samples; must match the sample rate of the sensor
+const uint16_t sample_rate_hz = 100;
+
+// A recorded accelerometer trace (X, Y, Z in mg) that is played back this many times. Replace it
+// with your own data set, e.g. read from an SD card in feed_samples().
+const int16_t recording[][3] = {
+    {12, -8, 1002}, {15, -6, 998}, {40, 10, 1050}, {85, 42, 1130}, {60, 25, 1080},
+    {20, -2, 1010}, {-30, -25, 950}, {-70, -48, 890}, {-45, -30, 930}, {5, -10, 995}};
+const uint32_t recording_repeats = 300;
+
+// An instance of the MAX32664. We are using the default I2C instance.
+// Change this to match the values for your board.
+ReWire_MAX32664 max32664 = ReWire_MAX32664(&Wire, mfio_pin, reset_pin);
+MAX32664_InputFeeder feeder = MAX32664_InputFeeder(&max32664);
+
+uint32_t next_sample = 0;
+bool reported = false;
+
+// Called by the feeder for the next samples to write to the input FIFO
+uint16_t feed_samples(uint8_t *samples, uint16_t max_samples, uint8_t sample_size, void *context)
+{
+    const uint32_t recording_length = sizeof(recording) / sizeof(recording[0]);
+    uint16_t count = 0;
+    while (count < max_samples && next_sample < recording_length * recording_repeats)
+    {
+        const int16_t *xyz = recording[next_sample % recording_length];
+        MAX32664_PackAccelSample(xyz[0], xyz[1], xyz[2], samples + count * sample_size);
+        next_sample++;
+        count++;
+    }
+    return count;
+}
+
+// Called by the feeder for every record read from the output FIFO (21 bytes: sensor + algorithm)
+void on_record(const uint8_t *record, uint8_t record_size, uint32_t latency_us, void *context)
+{
+    uint16_t hr = ((record[12] << 8) | record[13]) / 10;
+    Serial.print("HR: ");
+    Serial.print(hr);
+    Serial.print(", latency: ");
+    if (latency_us == MAX32664_LATENCY_UNPAIRED)
+    {
+        Serial.println("-");
+    }
+    else
+    {
+        Serial.print(latency_us / 1000);
+        Serial.println(" ms");
+    }
+}
+
+void setup()
+{
+    // Initialize serial communication and I2C
+    Serial.begin(115200);
+    Wire.begin();
+
+    // Step 1 of Table 8 in the MAX32664A user guide, with the accelerometer data supplied by the
+    // host (step 1.5)
+    uint8_t device_mode;
+    uint8_t result = max32664.Begin(device_mode);
+    if (result == MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        result = max32664.SetOutputMode_OutputFormat(MAX32664_OutputModeFormat::SensorData_And_AlgorithmData);
+    }
+    if (result == MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        result = max32664.SetOutputMode_FifoInterruptThreshold(1);
+    }
+    if (result == MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        result = max32664.SetAlgorithmMode_EnableAGC(true);
+    }
+    if (result == MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        result = max32664.EnableHostAccelerometer(true);
+    }
+    if (result == MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        result = max32664.EnableSensor(true);
+    }
+    if (result == MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        result = max32664.EnableAlgorithmMode_MaximFast(0x01);
+    }
+
+    if (result == MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        feeder.SetSink(on_record);
+        result = feeder.Begin(feed_samples, NULL, sample_rate_hz);
+    }
+    if (result != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        Serial.println("[DEBUG] Could not configure the sensor!");
+        while (1)
+        {
+            // empty
+        }
+    }
+}
+
+void loop()
+{
+    feeder.Step();
+
+    if (feeder.IsFinished() && !reported)
+    {
+        MAX32664_FeederStats stats;
+        feeder.GetStats(stats);
+        Serial.print("Samples written: ");
+        Serial.print(stats.samples_written);
+        Serial.print(" in ");
+        Serial.print(stats.writes);
+        Serial.print(" writes, input FIFO overflows: ");
+        Serial.print(stats.fifo_in_overflows);
+        Serial.print(", highest fill: ");
+        Serial.print(stats.max_fill);
+        Serial.print("/");
+        Serial.println(feeder.GetCapacity());
+        Serial.print("Latency (ms): min ");
+        Serial.print(stats.latency_min_us / 1000);
+        Serial.print(", mean ");
+        Serial.print(stats.latency_mean_us / 1000);
+        Serial.print(", max ");
+        Serial.println(stats.latency_max_us / 1000);
+        reported = true;
+    }
+
+    delay(20);
+}
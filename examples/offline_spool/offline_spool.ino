@@ -0,0 +1,127 @@
+// ESP32 only: samples are spooled to a LittleFS file while the uplink is down and replayed when it is back.
+#include <Arduino.h>
+#include <Wire.h>
+#include <LittleFS.h>
+#include <ReWire_MAX32664.h>
+#include <MAX32664_Spool.h>
+
+// Reset pin, MFIO pin
+// Set these to match the pin values on your board!!!
+int reset_pin = 4;
+int mfio_pin = 5;
+
+// 64 pages of 4 KiB: about 7000 samples
+#define SPOOL_PAGE_SIZE 4096
+#define SPOOL_PAGE_COUNT 64
+
+ReWire_MAX32664 max32664 = ReWire_MAX32664(&Wire, mfio_pin, reset_pin);
+
+FILE *spool_file;
+uint8_t spool_page[SPOOL_PAGE_SIZE];
+MAX32664_FileSpoolStorage *spool_storage;
+MAX32664_Spooler *spooler;
+
+// First spooled record that has not been sent yet
+uint32_t next_to_send = 0;
+
+bool UplinkConnected()
+{
+    // Replace with the state of your BLE or Wi-Fi connection
+    return (millis() / 30000) % 2 == 1;
+}
+
+void SendSample(uint32_t time_ms, const MAX32664_Data &sample)
+{
+    Serial.print(time_ms);
+    Serial.print("\tHR: ");
+    Serial.print(sample.hr);
+    Serial.print("\tSpO2: ");
+    Serial.println(sample.spo2);
+}
+
+void SendBatch(const MAX32664_SpoolBatch &batch, const uint8_t *records, void *context)
+{
+    if (batch.type != SpoolRecord_Sample || batch.record_size != sizeof(MAX32664_Data))
+    {
+        return;
+    }
+    for (uint16_t i = 0; i < batch.count; i++)
+    {
+        MAX32664_Data sample;
+        memcpy(&sample, records + i * batch.record_size, sizeof(sample));
+        SendSample(batch.time_ms, sample);
+    }
+}
+
+void setup()
+{
+    Serial.begin(115200);
+    Wire.begin();
+
+    LittleFS.begin(true);
+    spool_file = fopen("/littlefs/spool.bin", "r+b");
+    if (spool_file == NULL)
+    {
+        spool_file = fopen("/littlefs/spool.bin", "w+b");
+    }
+    spool_storage = new MAX32664_FileSpoolStorage(spool_file, SPOOL_PAGE_SIZE, SPOOL_PAGE_COUNT);
+    spooler = new MAX32664_Spooler(spool_storage, spool_page);
+
+    // Picks up whatever was spooled before a reset
+    spooler->Begin();
+    next_to_send = spooler->GetFirstRecord();
+
+    uint8_t device_mode;
+    uint8_t result = max32664.Begin(device_mode);
+    if (result == MAX32664_ReadStatusByteValue::SUCCESS_STATUS && device_mode == MAX32664_DeviceOperatingMode::ApplicationMode)
+    {
+        result = max32664.ConfigureDevice();
+    }
+    if (result != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        Serial.println("[DEBUG] Could not configure the sensor!");
+        while (1)
+        {
+            delay(1000);
+        }
+    }
+}
+
+void loop()
+{
+    uint8_t num_available_samples = 0;
+    uint8_t read_status = max32664.ReadNumberAvailableSamples(num_available_samples);
+
+    MAX32664_Data samples[MAX32664_FIFO_THRESHOLD_DEFAULT];
+    uint16_t count = 0;
+    for (int i = 0; read_status == MAX32664_ReadStatusByteValue::SUCCESS_STATUS && i < num_available_samples && count < MAX32664_FIFO_THRESHOLD_DEFAULT; i++)
+    {
+        read_status = max32664.ReadSample_SensorAndAlgorithm(samples[count]);
+        if (read_status == MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+        {
+            count++;
+        }
+    }
+
+    if (UplinkConnected())
+    {
+        // Catch up on what was spooled while the link was down, then send the live samples
+        if (next_to_send < spooler->GetNextRecord())
+        {
+            spooler->Replay(next_to_send, spooler->GetNextRecord() - 1, SendBatch);
+            next_to_send = spooler->GetNextRecord();
+        }
+        for (uint16_t i = 0; i < count; i++)
+        {
+            SendSample(millis(), samples[i]);
+        }
+    }
+    else if (count > 0)
+    {
+        // Only whole pages are written while the buffer fills up. Call Flush() now and then to
+        // limit what a power loss can take, at the cost of rewriting the current page.
+        spooler->Append(SpoolRecord_Sample, samples, sizeof(MAX32664_Data), count, millis());
+    }
+
+    delay(100);
+}
@@ -0,0 +1,68 @@
+#include <Arduino.h>
+#include <Wire.h>
+#include <ReWire_MAX32664.h>
+#include <MAX32664_SpotCheck.h>
+
+// Reset pin, MFIO pin
+// Set these to match the pin values on your board!!!
+int reset_pin = 0;
+int mfio_pin = 2;
+
+// An instance of the MAX32664. We are using the default I2C instance.
+// Change this to match the values for your board.
+ReWire_MAX32664 max32664 = ReWire_MAX32664(&Wire, mfio_pin, reset_pin);
+
+// Take a reading every 5 minutes, and keep the hub shut down in between
+MAX32664_SpotCheck spot_check = MAX32664_SpotCheck(&max32664, SpotCheckSleep_Shutdown);
+
+void setup()
+{
+    // Initialize serial communication and I2C
+    Serial.begin(115200);
+    Wire.begin();
+
+    // Accept readings with at least 90% confidence, and give up after 30 seconds
+    spot_check.SetInterval(5UL * 60UL * 1000UL);
+    spot_check.SetValidity(90, 30000);
+}
+
+void loop()
+{
+    if (!spot_check.IsDue())
+    {
+        // Put the host to sleep here
+        delay(1000);
+        return;
+    }
+
+    MAX32664_SpotCheckResult result;
+    uint8_t status = spot_check.Measure(result);
+    if (status != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        Serial.print("[DEBUG] Error: ");
+        Serial.println(status);
+    }
+    else if (result.valid)
+    {
+        Serial.print("HR: ");
+        Serial.print(result.sample.hr);
+        Serial.print("\tSpO2: ");
+        Serial.println(result.sample.spo2);
+    }
+    else
+    {
+        Serial.println("No valid reading");
+    }
+
+    // What the measurement cost
+    Serial.print("awake (ms): ");
+    Serial.print(result.awake_ms);
+    Serial.print("\tsettle (ms): ");
+    Serial.print(result.settle_ms);
+    Serial.print("\tbus (us): ");
+    Serial.print(result.bus_us);
+    Serial.print("\tcommands: ");
+    Serial.print(result.transactions);
+    Serial.print("\tbytes: ");
+    Serial.println(result.bytes);
+}
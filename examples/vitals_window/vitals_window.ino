@@ -0,0 +1,90 @@
+#include <Arduino.h>
+#include <Wire.h>
+#include <ReWire_MAX32664.h>
+#include <MAX32664_Vitals.h>
+
+// Reset pin, MFIO pin
+// Set these to match the pin values on your board!!!
+int reset_pin = 0;
+int mfio_pin = 2;
+
+// An instance of the MAX32664. We are using the default I2C instance.
+// Change this to match the values for your board.
+ReWire_MAX32664 max32664 = ReWire_MAX32664(&Wire, mfio_pin, reset_pin);
+
+// One summary per second
+MAX32664_VitalsAggregator vitals = MAX32664_VitalsAggregator(1000);
+
+void print_stats(const char *name, const MAX32664_VitalStats &stats)
+{
+    Serial.print(name);
+    if (stats.count == 0)
+    {
+        Serial.print(" -\t");
+        return;
+    }
+    Serial.print(" min ");
+    Serial.print(stats.min);
+    Serial.print(" max ");
+    Serial.print(stats.max);
+    Serial.print(" mean ");
+    Serial.print(stats.mean);
+    Serial.print(" median ");
+    Serial.print(stats.median);
+    Serial.print("\t");
+}
+
+void setup()
+{
+    // Initialize serial communication and I2C
+    Serial.begin(115200);
+    Wire.begin();
+
+    uint8_t device_mode;
+    uint8_t result = max32664.Begin(device_mode);
+    if (result == MAX32664_ReadStatusByteValue::SUCCESS_STATUS && device_mode == MAX32664_DeviceOperatingMode::ApplicationMode)
+    {
+        result = max32664.ConfigureDevice_SensorAndAlgorithm();
+    }
+    if (result != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        Serial.println("[DEBUG] Could not configure the sensor!");
+        while (1)
+        {
+            // empty
+        }
+    }
+
+    // Drop samples below 80% confidence and weight the rest by their confidence
+    vitals.SetMinConfidence(80);
+    vitals.SetWeighting(true);
+}
+
+void loop()
+{
+    uint8_t num_samples = 0;
+    uint8_t result = max32664.ReadNumberAvailableSamples(num_samples);
+
+    for (uint8_t i = 0; result == MAX32664_ReadStatusByteValue::SUCCESS_STATUS && i < num_samples; i++)
+    {
+        MAX32664_Data sample;
+        result = max32664.ReadSample_SensorAndAlgorithm(sample);
+        if (result == MAX32664_ReadStatusByteValue::SUCCESS_STATUS && vitals.AddSample(sample, millis()))
+        {
+            // A window closed: send its summary instead of every sample
+            MAX32664_VitalsSummary summary;
+            vitals.GetSummary(summary);
+            Serial.print(summary.start_ms);
+            Serial.print("\tsamples ");
+            Serial.print(summary.samples);
+            Serial.print(" rejected ");
+            Serial.print(summary.rejected);
+            Serial.print("\t");
+            print_stats("HR", summary.hr);
+            print_stats("SpO2", summary.spo2);
+            Serial.println();
+        }
+    }
+
+    delay(40);
+}
@@ -0,0 +1,183 @@
+// Host benchmark for MAX32664_PpgPipeline (floating point), MAX32664_PpgPipelineFixed and
+// MAX32664_PpgPipelineBank (floating point, vectorised across MAX32664_PPG_BANK_LANES patients).
+//
+// Build and run from the root of the library (-march=native picks AVX/SSE2/NEON if the host has
+// them; without it x86-64 still uses SSE2):
+//   g++ -O2 -march=native -Isrc extras/benchmarks/ppg_pipeline_bench.cpp src/MAX32664_PpgBank.cpp -o ppg_pipeline_bench
+//   ./ppg_pipeline_bench
+//
+// The input is one synthetic PPG signal per lane (48 to 84 bpm, SpO2 ~96%), fed in batches of 32
+// samples (a typical FIFO drain). The bank's beats are checked against a float pipeline per lane
+// fed the same samples. The result is the number of samples (over all lanes) one core processes
+// per second.
+
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+#include "MAX32664_PpgPipeline.h"
+#include "MAX32664_PpgBank.h"
+
+#define SAMPLE_RATE 100
+#define SIGNAL_SECONDS 60
+#define NUM_SAMPLES (SAMPLE_RATE * SIGNAL_SECONDS)
+#define NUM_LANES MAX32664_PPG_BANK_LANES
+#define BATCH_SIZE 32
+#define REPEATS 50
+#define MAX_BEATS 128
+
+static uint32_t ir[NUM_LANES][NUM_SAMPLES];
+static uint32_t red[NUM_LANES][NUM_SAMPLES];
+
+struct BeatLog
+{
+    MAX32664_PpgBeat beats[MAX_BEATS];
+    uint32_t count;
+};
+
+static BeatLog scalar_log[NUM_LANES];
+static BeatLog bank_log[NUM_LANES];
+
+static void make_signal()
+{
+    for (int lane = 0; lane < NUM_LANES; ++lane)
+    {
+        double bpm = 72.0 + 12.0 * (lane % 2 == 0 ? lane / 2 : -(lane + 1) / 2);
+        for (int i = 0; i < NUM_SAMPLES; ++i)
+        {
+            double t = (double)i / SAMPLE_RATE;
+            double phase = fmod(t * bpm / 60.0, 1.0);
+            double pulse = (phase < 0.3) ? sin(phase / 0.3 * M_PI / 2) : cos((phase - 0.3) / 0.7 * M_PI / 2);
+            pulse *= pulse;
+            ir[lane][i] = (uint32_t)(100000 + 5000 * lane - 1000 * pulse + 200 * sin(t * 0.3));
+            red[lane][i] = (uint32_t)(80000 + 3000 * lane - 400 * pulse + 100 * sin(t * 0.3));
+        }
+    }
+}
+
+static void log_beats(BeatLog &log, const MAX32664_PpgBeat *beats, uint16_t found)
+{
+    for (uint16_t i = 0; i < found && log.count < MAX_BEATS; ++i)
+    {
+        log.beats[log.count++] = beats[i];
+    }
+}
+
+static void print_result(const char *name, double seconds, const BeatLog &log)
+{
+    const MAX32664_PpgBeat &last_beat = log.beats[(log.count > 0) ? log.count - 1 : 0];
+    printf("%-12s %10.2f Msamples/s  lane 0 beats/run: %u  last: hr %.1f spo2 %.1f ibi %u ms\n", name,
+           (double)NUM_SAMPLES * NUM_LANES * REPEATS / seconds / 1e6, log.count, last_beat.hr, last_beat.spo2, last_beat.ibi_ms);
+}
+
+// Runs every lane through its own pipeline, one lane after the other
+template <typename Pipeline>
+static void run(const char *name, bool keep_beats)
+{
+    Pipeline pipeline(SAMPLE_RATE);
+    MAX32664_PpgBeat beats[8];
+    BeatLog log[NUM_LANES];
+
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < REPEATS; ++r)
+    {
+        for (int lane = 0; lane < NUM_LANES; ++lane)
+        {
+            log[lane].count = 0;
+            pipeline.Reset(SAMPLE_RATE);
+            for (int i = 0; i < NUM_SAMPLES; i += BATCH_SIZE)
+            {
+                int count = (NUM_SAMPLES - i < BATCH_SIZE) ? NUM_SAMPLES - i : BATCH_SIZE;
+                uint16_t found = pipeline.Process(ir[lane] + i, red[lane] + i, count, beats, 8);
+                log_beats(log[lane], beats, found);
+            }
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    print_result(name, seconds, log[0]);
+    if (keep_beats)
+    {
+        for (int lane = 0; lane < NUM_LANES; ++lane)
+        {
+            scalar_log[lane] = log[lane];
+        }
+    }
+}
+
+// Runs all lanes through a bank, side by side
+static void run_bank()
+{
+    MAX32664_PpgPipelineBank bank(SAMPLE_RATE);
+    MAX32664_PpgBeat beats[NUM_LANES][8];
+    MAX32664_PpgBeat *beat_buffers[NUM_LANES];
+    uint16_t found[NUM_LANES];
+    for (int lane = 0; lane < NUM_LANES; ++lane)
+    {
+        beat_buffers[lane] = beats[lane];
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < REPEATS; ++r)
+    {
+        bank.Reset(SAMPLE_RATE);
+        for (int lane = 0; lane < NUM_LANES; ++lane)
+        {
+            bank_log[lane].count = 0;
+        }
+        for (int i = 0; i < NUM_SAMPLES; i += BATCH_SIZE)
+        {
+            int count = (NUM_SAMPLES - i < BATCH_SIZE) ? NUM_SAMPLES - i : BATCH_SIZE;
+            const uint32_t *ir_batch[NUM_LANES];
+            const uint32_t *red_batch[NUM_LANES];
+            for (int lane = 0; lane < NUM_LANES; ++lane)
+            {
+                ir_batch[lane] = ir[lane] + i;
+                red_batch[lane] = red[lane] + i;
+            }
+            bank.Process(ir_batch, red_batch, count, beat_buffers, 8, found);
+            for (int lane = 0; lane < NUM_LANES; ++lane)
+            {
+                log_beats(bank_log[lane], beats[lane], found[lane]);
+            }
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    char name[32];
+    snprintf(name, sizeof(name), "bank (%s)", MAX32664_PpgFilterLanes_Implementation());
+    print_result(name, seconds, bank_log[0]);
+}
+
+// The bank must find the same beats as the float pipeline; the values may differ by float rounding
+static bool check_bank()
+{
+    for (int lane = 0; lane < NUM_LANES; ++lane)
+    {
+        const BeatLog &expected = scalar_log[lane];
+        const BeatLog &actual = bank_log[lane];
+        bool match = (expected.count == actual.count);
+        for (uint32_t i = 0; match && i < expected.count; ++i)
+        {
+            const MAX32664_PpgBeat &a = expected.beats[i];
+            const MAX32664_PpgBeat &b = actual.beats[i];
+            match = a.sample_index == b.sample_index && a.ibi_ms == b.ibi_ms && fabsf(a.hr - b.hr) < 0.01f &&
+                    fabsf(a.spo2 - b.spo2) < 0.01f && fabsf(a.r_value - b.r_value) < 1e-4f;
+        }
+        if (!match)
+        {
+            printf("MISMATCH between the bank and the float pipeline in lane %d (%u vs %u beats)\n", lane, actual.count, expected.count);
+            return false;
+        }
+    }
+    printf("bank beats match the float pipeline in all %d lanes\n", NUM_LANES);
+    return true;
+}
+
+int main()
+{
+    make_signal();
+    run<MAX32664_PpgPipeline>("float", true);
+    run<MAX32664_PpgPipelineFixed>("fixed", false);
+    run_bank();
+    return check_bank() ? 0 : 1;
+}
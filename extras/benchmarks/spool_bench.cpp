@@ -0,0 +1,175 @@
+// Host benchmark for MAX32664_Spooler with a file backend: append throughput, write
+// amplification for a few flush policies, full and range replay, and recovery after a restart.
+//
+// Build and run from the root of the library:
+//   g++ -O2 -Isrc extras/benchmarks/spool_bench.cpp src/MAX32664_Spool.cpp -o spool_bench
+//   ./spool_bench [spool file]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "MAX32664_Spool.h"
+
+// A 1 MiB ring of 4 KiB pages (a typical SD card or SPI flash sector)
+#define PAGE_SIZE 4096
+#define PAGE_COUNT 256
+
+// MAX32664D sensor + algorithm records, drained 15 at a time (the default FIFO threshold)
+#define RECORD_SIZE 29
+#define BATCH_RECORDS 15
+
+// Enough batches to wrap the ring a few times
+#define BATCHES 40000
+
+static uint8_t page_buffer[PAGE_SIZE];
+
+static double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Record r holds its own number in every byte group, so replay can check what it got
+static void make_batch(uint8_t *batch, uint32_t first_record)
+{
+    for (uint32_t i = 0; i < BATCH_RECORDS; i++)
+    {
+        uint32_t record = first_record + i;
+        for (uint32_t b = 0; b < RECORD_SIZE; b++)
+        {
+            batch[i * RECORD_SIZE + b] = (uint8_t)(record >> (8 * (b % 4)));
+        }
+    }
+}
+
+struct ReplayCheck
+{
+    uint32_t next_expected;
+    uint32_t errors;
+};
+
+static void check_batch(const MAX32664_SpoolBatch &batch, const uint8_t *records, void *context)
+{
+    ReplayCheck *check = (ReplayCheck *)context;
+    for (uint32_t i = 0; i < batch.count; i++)
+    {
+        uint32_t record = batch.first_record + i;
+        if (record != check->next_expected || records[i * RECORD_SIZE] != (uint8_t)record || records[i * RECORD_SIZE + 1] != (uint8_t)(record >> 8))
+        {
+            check->errors++;
+        }
+        check->next_expected = record + 1;
+    }
+}
+
+static FILE *open_spool(const char *path, bool truncate)
+{
+    return fopen(path, truncate ? "w+b" : "r+b");
+}
+
+static void run_policy(const char *path, const char *name, uint32_t flush_every)
+{
+    FILE *file = open_spool(path, true);
+    MAX32664_FileSpoolStorage storage(file, PAGE_SIZE, PAGE_COUNT);
+    MAX32664_Spooler spooler(&storage, page_buffer);
+    spooler.Begin();
+
+    uint8_t batch[BATCH_RECORDS * RECORD_SIZE];
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < BATCHES; i++)
+    {
+        make_batch(batch, spooler.GetNextRecord());
+        spooler.Append(SpoolRecord_RawFifo, batch, RECORD_SIZE, BATCH_RECORDS, i * 150);
+        if (flush_every > 0 && (i + 1) % flush_every == 0)
+        {
+            spooler.Flush();
+        }
+    }
+    spooler.Flush();
+    double append_seconds = seconds_since(start);
+
+    MAX32664_SpoolStats stats;
+    spooler.GetStats(stats);
+    printf("%-22s append %7.1f MB/s  write amplification %5.2f  page writes %6u (rewrites %6u)\n",
+           name, stats.bytes_appended / append_seconds / 1e6, (double)stats.bytes_written / stats.bytes_appended,
+           stats.pages_written, stats.page_rewrites);
+
+    // Everything still in the ring
+    ReplayCheck check = {spooler.GetFirstRecord(), 0};
+    start = std::chrono::steady_clock::now();
+    uint32_t replayed = spooler.Replay(spooler.GetFirstRecord(), spooler.GetNextRecord() - 1, check_batch, &check);
+    double replay_seconds = seconds_since(start);
+
+    // A range in the middle, as after a short outage
+    uint32_t range_first = spooler.GetNextRecord() - 5000;
+    ReplayCheck range_check = {range_first, 0};
+    start = std::chrono::steady_clock::now();
+    uint32_t range_replayed = spooler.Replay(range_first, range_first + 999, check_batch, &range_check);
+    double range_seconds = seconds_since(start);
+
+    printf("%-22s replay %7.1f MB/s (%u records, %u errors)  range of %u in %.0f us (%u errors)\n",
+           "", replayed * (double)RECORD_SIZE / replay_seconds / 1e6, replayed, check.errors,
+           range_replayed, range_seconds * 1e6, range_check.errors);
+    fclose(file);
+}
+
+static void run_recovery(const char *path)
+{
+    uint8_t batch[BATCH_RECORDS * RECORD_SIZE];
+
+    // Write some batches, flush, and add one more that never reaches the storage
+    FILE *file = open_spool(path, true);
+    uint32_t flushed_next;
+    {
+        MAX32664_FileSpoolStorage storage(file, PAGE_SIZE, PAGE_COUNT);
+        MAX32664_Spooler spooler(&storage, page_buffer);
+        spooler.Begin();
+        for (uint32_t i = 0; i < 1000; i++)
+        {
+            make_batch(batch, spooler.GetNextRecord());
+            spooler.Append(SpoolRecord_RawFifo, batch, RECORD_SIZE, BATCH_RECORDS, i);
+        }
+        spooler.Flush();
+        flushed_next = spooler.GetNextRecord();
+        make_batch(batch, spooler.GetNextRecord());
+        spooler.Append(SpoolRecord_RawFifo, batch, RECORD_SIZE, BATCH_RECORDS, 0);
+    }
+    fclose(file);
+
+    // Restart: appending continues after the last flushed record
+    file = open_spool(path, false);
+    MAX32664_FileSpoolStorage storage(file, PAGE_SIZE, PAGE_COUNT);
+    MAX32664_Spooler spooler(&storage, page_buffer);
+    spooler.Begin();
+    bool resumed = spooler.GetNextRecord() == flushed_next;
+    make_batch(batch, spooler.GetNextRecord());
+    spooler.Append(SpoolRecord_RawFifo, batch, RECORD_SIZE, BATCH_RECORDS, 0);
+
+    ReplayCheck check = {spooler.GetFirstRecord(), 0};
+    uint32_t replayed = spooler.Replay(spooler.GetFirstRecord(), spooler.GetNextRecord() - 1, check_batch, &check);
+    printf("recovery: resumed at record %u (%s), replayed %u records, %u errors\n",
+           spooler.GetNextRecord() - BATCH_RECORDS, resumed ? "ok" : "WRONG", replayed, check.errors);
+    fclose(file);
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = (argc > 1) ? argv[1] : "spool_bench.bin";
+
+    const uint8_t check_string[] = "123456789";
+    if (MAX32664_Crc32(0, check_string, 9) != 0xCBF43926UL)
+    {
+        printf("CRC-32 check value mismatch\n");
+        return 1;
+    }
+
+    printf("%u-byte pages, %u pages, %u records of %u bytes per batch, %u batches\n",
+           PAGE_SIZE, PAGE_COUNT, BATCH_RECORDS, RECORD_SIZE, BATCHES);
+    run_policy(path, "full pages only", 0);
+    run_policy(path, "flush every 10 batches", 10);
+    run_policy(path, "flush every batch", 1);
+    run_recovery(path);
+
+    remove(path);
+    return 0;
+}
@@ -0,0 +1,68 @@
+#!/bin/sh
+# Reports the flash and RAM that the driver adds to a sketch for each set of MAX32664_Config.h
+# options, by building extras/footprint/footprint with arduino-cli and subtracting a build that
+# does not use the driver. The board cores must be installed (e.g. arduino-cli core install
+# arduino:samd arduino:avr).
+#
+# Run from the root of the library:
+#   extras/footprint/footprint.sh [fqbn...]
+#
+# Without arguments it reports a SAMD board and an AVR board. On AVR, plain const data is copied
+# to RAM at startup, so the RAM column there shows whether constant tables stay in PROGMEM.
+
+SKETCH=extras/footprint/footprint
+
+# Prints "<flash bytes> <ram bytes>" for the given compiler flags
+measure()
+{
+    output=$(arduino-cli compile --fqbn "$FQBN" --library . --build-path "$BUILD_DIR" \
+        --build-property "compiler.cpp.extra_flags=$1" "$SKETCH" 2>&1)
+    if [ $? -ne 0 ]; then
+        echo "$output" >&2
+        exit 1
+    fi
+    flash=$(echo "$output" | sed -n 's/^Sketch uses \([0-9]*\) bytes.*/\1/p')
+    ram=$(echo "$output" | sed -n 's/^Global variables use \([0-9]*\) bytes.*/\1/p')
+    echo "${flash:-0} ${ram:-0}"
+}
+
+report()
+{
+    result=$(measure "$2") || exit 1
+    set -- "$1" "$2" $result
+    printf '%-28s %8d %8d\n' "$1" $(($3 - BASE_FLASH)) $(($4 - BASE_RAM))
+}
+
+ONLY_A="-DMAX32664_ENABLE_VARIANT_D=0"
+ONLY_D="-DMAX32664_ENABLE_VARIANT_A=0"
+NO_EXTRAS="-DMAX32664_ENABLE_RAW_OUTPUT=0 -DMAX32664_ENABLE_BPT_CALIBRATION=0 -DMAX32664_ENABLE_SAMPLE_CALIBRATION=0 -DMAX32664_ENABLE_INPUT_FIFO=0"
+
+# Prints the table for the board in $FQBN
+board()
+{
+    BUILD_DIR=${TMPDIR:-/tmp}/max32664_footprint_$(echo "$FQBN" | tr ':' '_')
+    result=$(measure "-DFOOTPRINT_BASELINE") || exit 1
+    set -- $result
+    BASE_FLASH=$1
+    BASE_RAM=$2
+
+    echo "Driver footprint on $FQBN (bytes, relative to a sketch without the driver)"
+    printf '%-28s %8s %8s\n' "configuration" "flash" "ram"
+    report "all (default)" ""
+    report "all + stats + trace(32)" "-DMAX32664_ENABLE_STATS=1 -DMAX32664_TRACE_DEPTH=32"
+    report "A only" "$ONLY_A"
+    report "A only, no events" "$ONLY_A -DMAX32664_ENABLE_EVENTS=0"
+    report "A only, no input FIFO" "$ONLY_A -DMAX32664_ENABLE_INPUT_FIFO=0"
+    report "D only" "$ONLY_D"
+    report "D, no sample vectors" "$ONLY_D -DMAX32664_ENABLE_SAMPLE_CALIBRATION=0"
+    report "D estimation only" "$ONLY_D $NO_EXTRAS"
+    report "D estimation, no events" "$ONLY_D $NO_EXTRAS -DMAX32664_ENABLE_EVENTS=0"
+}
+
+if [ $# -eq 0 ]; then
+    set -- arduino:samd:mkrzero arduino:avr:mega
+fi
+for FQBN in "$@"; do
+    board || exit 1
+    echo
+done
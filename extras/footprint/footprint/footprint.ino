@@ -0,0 +1,86 @@
+// Sketch used by footprint.sh: calls everything that the configuration compiles in, so the linker
+// keeps it. Built with -DFOOTPRINT_BASELINE it does not use the driver at all.
+#include <Arduino.h>
+#include <Wire.h>
+#include <ReWire_MAX32664.h>
+#include <MAX32664_InputFeeder.h>
+
+#ifndef FOOTPRINT_BASELINE
+ReWire_MAX32664 max32664 = ReWire_MAX32664(&Wire, 5, 4);
+
+#if MAX32664_ENABLE_BPT_CALIBRATION
+uint8_t calibration_vector[CALIBVECTOR_SIZE];
+#endif
+
+#if MAX32664_ENABLE_INPUT_FIFO
+MAX32664_InputFeeder feeder(&max32664);
+
+uint16_t FeedSamples(uint8_t *samples, uint16_t max_samples, uint8_t sample_size, void *context)
+{
+    MAX32664_PackAccelSample(0, 0, 1000, samples);
+    return 1;
+}
+#endif
+
+#if MAX32664_ENABLE_EVENTS
+void OnEvent(const MAX32664_Event &event, void *context)
+{
+    Serial.println(event.type);
+}
+#endif
+#endif
+
+void setup()
+{
+    Serial.begin(115200);
+    Wire.begin();
+
+#ifndef FOOTPRINT_BASELINE
+    uint8_t device_mode;
+    max32664.Begin(device_mode);
+    max32664.ConfigureDevice();
+#if MAX32664_ENABLE_EVENTS
+    max32664.SetEventCallback(OnEvent);
+#endif
+#if MAX32664_ENABLE_BPT_CALIBRATION
+    max32664.Configure_BPTCalibrationMode();
+    max32664.Start_BPTCalibrationMode(0, 120, 80);
+    max32664.readBPTAlgoCalibData(calibration_vector);
+#endif
+#if MAX32664_ENABLE_RAW_OUTPUT
+    max32664.ConfigureBPT_RawValue();
+#endif
+#if MAX32664_ENABLE_INPUT_FIFO
+    max32664.EnableHostAccelerometer(true);
+    feeder.Begin(FeedSamples, NULL, 100);
+#endif
+#endif
+}
+
+void loop()
+{
+#ifndef FOOTPRINT_BASELINE
+    uint8_t num_samples = 0;
+    max32664.ReadNumberAvailableSamples(num_samples);
+#if MAX32664_ENABLE_VARIANT_A
+    MAX32664_Data sample;
+    max32664.ReadSample_SensorAndAlgorithm(sample);
+    Serial.println(sample.hr);
+#endif
+#if MAX32664_ENABLE_VARIANT_D
+    MAX32664_Data_VerD bpt_sample;
+    max32664.ReadSample_BPTSensorAndAlgorithm(bpt_sample);
+    Serial.println(bpt_sample.sys_bp);
+#endif
+#if MAX32664_ENABLE_RAW_OUTPUT
+    uint32_t ir[MAX32664_RAW_BATCH_MAX];
+    uint32_t red[MAX32664_RAW_BATCH_MAX];
+    max32664.ReadSamples_BPTSensor(ir, red, num_samples);
+    Serial.println(ir[0]);
+#endif
+#endif
+#if MAX32664_ENABLE_INPUT_FIFO
+    feeder.Step();
+#endif
+    delay(100);
+}
@@ -0,0 +1,496 @@
+#include "SimulatedHub.h"
+#include "ReWire_MAX32664.h"
+
+// Time one byte takes on a 400 kHz bus, including the ACK bit and some bus overhead
+#define I2C_BYTE_US 25
+
+// The IR and red values of a record are sequence number * 10 in 24 bits (the driver divides by
+// 10), so sequence numbers wrap at this value
+#define SEQUENCE_MODULO (0xFFFFFFUL / 10)
+
+// Default output FIFO interrupt threshold after a reset
+#define DEFAULT_THRESHOLD 1
+
+SimulatedHub::SimulatedHub(uint8_t hub_variant, uint32_t period_us, uint16_t capacity, uint32_t seed)
+{
+    variant = hub_variant;
+    sample_period_us = period_us;
+    fifo_capacity = capacity;
+    fifo = new uint32_t[capacity];
+    fifo_head = 0;
+    fifo_count = 0;
+    next_sequence = 0;
+    random_state = seed ? seed : 1;
+    memset(&faults, 0, sizeof(faults));
+    memset(&counters, 0, sizeof(counters));
+
+    reset_pin = 0xFF;
+    held_in_reset = false;
+    booting_until_us = 0;
+    stuck_armed = false;
+    stuck_until_us = 0;
+    next_reset_us = 0;
+    next_stuck_us = 0;
+    last_sample_us = HostMicros64();
+    watchdog_start_us = 0;
+    watchdog_limit_ms = 0;
+    reset_state();
+}
+
+SimulatedHub::~SimulatedHub()
+{
+    delete[] fifo;
+}
+
+void SimulatedHub::SetFaults(const HubFaults &hub_faults)
+{
+    faults = hub_faults;
+    uint64_t now = HostMicros64();
+    next_reset_us = now + random_interval_us(faults.resets_per_hour);
+    next_stuck_us = now + random_interval_us(faults.stuck_per_hour);
+    // The first episode is waiting from the start, so every run reaches the retry limit
+    stuck_armed = faults.stuck_per_hour > 0;
+}
+
+/// @brief Follows the reset pin: the hub is held in reset while it is low and boots when it goes high
+void SimulatedHub::OnPinWrite(uint8_t pin, uint8_t value)
+{
+    if (pin != reset_pin)
+    {
+        return;
+    }
+    if (value == LOW && !held_in_reset)
+    {
+        held_in_reset = true;
+        counters.pin_resets++;
+        reset_state();
+    }
+    else if (value == HIGH && held_in_reset)
+    {
+        held_in_reset = false;
+        booting_until_us = HostMicros64() + (uint64_t)faults.boot_ms * 1000;
+    }
+}
+
+/// @brief Makes the next bus access throw HubWatchdogExpired once limit_ms have passed
+void SimulatedHub::ArmWatchdog(uint32_t limit_ms)
+{
+    watchdog_start_us = HostMicros64();
+    watchdog_limit_ms = limit_ms;
+}
+
+/// @brief Recovers the sequence number from the IR value decoded by the driver
+/// @return false if the value cannot come from the hub (e.g. the 0xFF bytes of a short read)
+bool SimulatedHub::DecodeSequence(uint32_t ir, uint32_t &sequence)
+{
+    if (ir >= SEQUENCE_MODULO)
+    {
+        return false;
+    }
+    sequence = ir;
+    return true;
+}
+
+uint8_t SimulatedHub::Write(uint8_t i2c_address, const uint8_t *command, uint8_t command_length, const uint8_t *payload, uint16_t payload_length)
+{
+    (void)i2c_address;
+    spend_bus_time(1 + command_length + payload_length);
+    check_watchdog();
+    update();
+
+    counters.commands++;
+    pending = false;
+    uint64_t now = HostMicros64();
+    if (held_in_reset || now < booting_until_us)
+    {
+        return 2; // address NACK
+    }
+    if (random_unit() < faults.write_nack)
+    {
+        counters.nacks++;
+        return 2;
+    }
+
+    pending = true;
+    pending_family = command[0];
+    pending_index = (command_length > 1) ? command[1] : 0;
+    response_length = 0;
+
+    // A busy algorithm is noticed when the host enables it, which is the command the driver
+    // re-sends while the hub answers ERR_TRY_AGAIN. The AGC and disabling are not affected.
+    bool enables_algorithm = command[0] == MAX32664_CommandFamilyByte::EnableAlgorithm && command_length > 2 && command[1] != 0x00 && command[2] != 0;
+    if (enables_algorithm && stuck_armed)
+    {
+        start_stuck_episode(now);
+    }
+    if (enables_algorithm && now < stuck_until_us)
+    {
+        counters.try_agains++;
+        counters.busy_refusals++;
+        counters.busy_run++;
+        pending_status = MAX32664_ReadStatusByteValue::ERR_TRY_AGAIN;
+        return 0;
+    }
+    if (random_unit() < faults.try_again)
+    {
+        counters.try_agains++;
+        pending_status = MAX32664_ReadStatusByteValue::ERR_TRY_AGAIN;
+        return 0;
+    }
+
+    if (enables_algorithm)
+    {
+        counters.busy_run = 0;
+    }
+    pending_status = MAX32664_ReadStatusByteValue::SUCCESS_STATUS;
+    execute(command, command_length, payload, payload_length);
+    return 0;
+}
+
+uint16_t SimulatedHub::Read(uint8_t i2c_address, uint8_t &status_byte, uint8_t *read_buffer, uint16_t read_length)
+{
+    (void)i2c_address;
+    spend_bus_time(2 + read_length);
+    check_watchdog();
+    update();
+
+    uint64_t now = HostMicros64();
+    if (!pending || held_in_reset || now < booting_until_us)
+    {
+        status_byte = 0xFF;
+        memset(read_buffer, 0xFF, read_length);
+        return 0;
+    }
+    pending = false;
+
+    uint16_t received = read_length + 1;
+    if (random_unit() < faults.short_read)
+    {
+        counters.short_reads++;
+        received = (uint16_t)(random_unit() * (read_length + 1));
+    }
+
+    memset(read_buffer, 0, read_length);
+    bool fifo_read = pending_family == MAX32664_CommandFamilyByte::ReadOutputFIFO && pending_index == 0x01;
+    if (fifo_read && pending_status == MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        // The hub pops the records as it sends them, whether or not the host gets all the bytes
+        uint8_t size = record_size();
+        for (uint16_t i = 0; size > 0 && i < read_length / size && fifo_count > 0; i++)
+        {
+            fill_record(fifo[fifo_head], read_buffer + i * size);
+            fifo_head = (fifo_head + 1) % fifo_capacity;
+            fifo_count--;
+            if ((uint32_t)(i + 1) * size + 1 <= received)
+            {
+                counters.delivered++;
+            }
+            else
+            {
+                counters.lost_short_read++;
+            }
+        }
+    }
+    else
+    {
+        memcpy(read_buffer, response, (response_length < read_length) ? response_length : read_length);
+    }
+
+    // Bytes that were not received read as 0xFF, as with Wire
+    status_byte = (received > 0) ? pending_status : 0xFF;
+    for (uint16_t i = (received > 0) ? received - 1 : 0; i < read_length; i++)
+    {
+        read_buffer[i] = 0xFF;
+    }
+    return received;
+}
+
+void SimulatedHub::Wait(uint16_t milliseconds)
+{
+    delay(milliseconds);
+    check_watchdog();
+}
+
+double SimulatedHub::random_unit()
+{
+    // xorshift64*
+    random_state ^= random_state >> 12;
+    random_state ^= random_state << 25;
+    random_state ^= random_state >> 27;
+    return (double)((random_state * 0x2545F4914F6CDD1DULL) >> 11) / (double)(1ULL << 53);
+}
+
+/// @brief Draws the time to the next event of a Poisson process
+uint64_t SimulatedHub::random_interval_us(double per_hour)
+{
+    if (per_hour <= 0)
+    {
+        return UINT64_MAX / 2;
+    }
+    return (uint64_t)(-log(1.0 - random_unit()) * 3600e6 / per_hour);
+}
+
+void SimulatedHub::reset_state()
+{
+    counters.lost_reset += fifo_count;
+    fifo_head = 0;
+    fifo_count = 0;
+    device_mode = MAX32664_DeviceOperatingMode::ApplicationMode;
+    output_format = MAX32664_OutputModeFormat::Pause_NoData;
+    threshold = DEFAULT_THRESHOLD;
+    sensor_enabled = false;
+    algorithm_enabled = false;
+    overflow = false;
+    pending = false;
+    stuck_until_us = 0;
+    counters.busy_run = 0;
+}
+
+/// @brief Brings the hub up to the current time: spontaneous faults, then the records produced since
+///     the last update
+void SimulatedHub::update()
+{
+    uint64_t now = HostMicros64();
+
+    if (now >= next_reset_us)
+    {
+        counters.resets++;
+        reset_state();
+        booting_until_us = now + (uint64_t)faults.boot_ms * 1000;
+        next_reset_us = now + random_interval_us(faults.resets_per_hour);
+    }
+    if (now >= next_stuck_us)
+    {
+        // One episode at a time: a busy algorithm does not get busier
+        stuck_armed = stuck_armed || now >= stuck_until_us;
+        next_stuck_us = now + random_interval_us(faults.stuck_per_hour);
+    }
+
+    if (!streaming())
+    {
+        last_sample_us = now;
+        return;
+    }
+    while (now - last_sample_us >= sample_period_us)
+    {
+        last_sample_us += sample_period_us;
+        counters.generated++;
+        uint32_t sequence = next_sequence;
+        next_sequence = (next_sequence + 1) % SEQUENCE_MODULO;
+        if (fifo_count == fifo_capacity)
+        {
+            counters.lost_overflow++;
+            overflow = true;
+            continue;
+        }
+        fifo[(fifo_head + fifo_count) % fifo_capacity] = sequence;
+        fifo_count++;
+    }
+}
+
+/// @brief Starts refusing to enable an algorithm, either for a random time up to stuck_ms or, for a
+///     wedged hub, until it is reset
+void SimulatedHub::start_stuck_episode(uint64_t now)
+{
+    stuck_armed = false;
+    counters.stuck_episodes++;
+    counters.busy_run = 0;
+    if (counters.stuck_episodes == 1 || random_unit() < faults.stuck_wedged)
+    {
+        counters.wedged_episodes++;
+        stuck_until_us = UINT64_MAX;
+    }
+    else
+    {
+        stuck_until_us = now + (uint64_t)(random_unit() * faults.stuck_ms * 1000);
+    }
+}
+
+bool SimulatedHub::streaming()
+{
+    uint8_t data = output_format & 0x03;
+    return !held_in_reset && HostMicros64() >= booting_until_us && device_mode == MAX32664_DeviceOperatingMode::ApplicationMode &&
+           sensor_enabled && (data == MAX32664_OutputModeFormat::SensorData || (data != 0 && algorithm_enabled));
+}
+
+uint8_t SimulatedHub::record_size()
+{
+    uint8_t algorithm_size = (variant == MAX32664_Variant::Variant_D) ? 17 : 9;
+    uint8_t size = 0;
+    switch (output_format & 0x03)
+    {
+    case MAX32664_OutputModeFormat::SensorData:
+        size = 12;
+        break;
+    case MAX32664_OutputModeFormat::AlgorithmData:
+        size = algorithm_size;
+        break;
+    case MAX32664_OutputModeFormat::SensorData_And_AlgorithmData:
+        size = 12 + algorithm_size;
+        break;
+    default:
+        return 0;
+    }
+    // The sample counter byte
+    return (output_format & 0x04) ? size + 1 : size;
+}
+
+void SimulatedHub::fill_record(uint32_t sequence, uint8_t *record)
+{
+    uint8_t size = record_size();
+    memset(record, 0, size);
+    uint8_t *data = record;
+    if (output_format & 0x04)
+    {
+        *data++ = (uint8_t)sequence;
+    }
+
+    uint8_t format = output_format & 0x03;
+    if (format & MAX32664_OutputModeFormat::SensorData)
+    {
+        uint32_t raw = sequence * 10;
+        for (uint8_t channel = 0; channel < 2; channel++)
+        {
+            data[channel * 3] = (uint8_t)(raw >> 16);
+            data[channel * 3 + 1] = (uint8_t)(raw >> 8);
+            data[channel * 3 + 2] = (uint8_t)raw;
+        }
+        data += 12;
+    }
+    if (!(format & MAX32664_OutputModeFormat::AlgorithmData))
+    {
+        return;
+    }
+
+    if (variant == MAX32664_Variant::Variant_D)
+    {
+        const uint16_t hr = 720, spo2 = 975, r_value = 500, ibi = 833;
+        data[0] = MAX32664_BP_STATUS_SUCCESS;
+        data[1] = 100; // progress
+        data[2] = hr >> 8;
+        data[3] = hr & 0xFF;
+        data[4] = 120; // systolic
+        data[5] = 80;  // diastolic
+        data[6] = spo2 >> 8;
+        data[7] = spo2 & 0xFF;
+        data[8] = r_value >> 8;
+        data[9] = r_value & 0xFF;
+        data[10] = (sequence % 83) == 0; // pulse flag
+        data[11] = ibi >> 8;
+        data[12] = ibi & 0xFF;
+        data[13] = 95; // SpO2 confidence
+    }
+    else
+    {
+        const uint16_t hr = 720, spo2 = 980;
+        data[0] = hr >> 8;
+        data[1] = hr & 0xFF;
+        data[2] = 100; // confidence
+        data[3] = spo2 >> 8;
+        data[4] = spo2 & 0xFF;
+        data[5] = MAX32664_ALGORITHM_STATE_FINGER_DETECTED;
+        data[6] = MAX32664_ALGORITHM_STATUS_SUCCESS;
+    }
+}
+
+void SimulatedHub::execute(const uint8_t *command, uint8_t command_length, const uint8_t *payload, uint16_t payload_length)
+{
+    (void)payload;
+    (void)payload_length;
+    uint8_t value = (command_length > 2) ? command[2] : 0;
+
+    switch (pending_family)
+    {
+    case MAX32664_CommandFamilyByte::ReadSensorHubStatus:
+        response[0] = (overflow ? 0x10 : 0x00) | (fifo_count >= threshold ? 0x08 : 0x00);
+        response_length = 1;
+        overflow = false;
+        break;
+    case MAX32664_CommandFamilyByte::SetDeviceMode:
+        if (value == MAX32664_DeviceOperatingMode::Reset)
+        {
+            reset_state();
+            booting_until_us = HostMicros64() + (uint64_t)faults.boot_ms * 1000;
+        }
+        else
+        {
+            device_mode = value;
+        }
+        break;
+    case MAX32664_CommandFamilyByte::ReadDeviceMode:
+        response[0] = device_mode;
+        response_length = 1;
+        break;
+    case MAX32664_CommandFamilyByte::SetOutputMode:
+        if (pending_index == 0x00)
+        {
+            output_format = value;
+        }
+        else if (pending_index == 0x01)
+        {
+            threshold = value;
+        }
+        break;
+    case MAX32664_CommandFamilyByte::ReadOutputMode:
+        response[0] = (pending_index == 0x00) ? output_format : threshold;
+        response_length = 1;
+        break;
+    case MAX32664_CommandFamilyByte::ReadOutputFIFO:
+        if (pending_index == 0x00)
+        {
+            response[0] = (fifo_count > 0xFF) ? 0xFF : (uint8_t)fifo_count;
+            response_length = 1;
+        }
+        break;
+    case MAX32664_CommandFamilyByte::EnableSensorMode:
+        sensor_enabled = (value != 0);
+        break;
+    case MAX32664_CommandFamilyByte::EnableAlgorithm:
+        // 0x02: WHRM (MAX32664A), 0x04: BPT (MAX32664D), 0x00: AGC
+        if ((pending_index == 0x02 && variant == MAX32664_Variant::Variant_D) || (pending_index == 0x04 && variant != MAX32664_Variant::Variant_D))
+        {
+            pending_status = MAX32664_ReadStatusByteValue::ERR_UNAVAIL_CMD;
+        }
+        else if (pending_index != 0x00)
+        {
+            algorithm_enabled = (value != 0);
+        }
+        break;
+    case MAX32664_CommandFamilyByte::ReadIdentity:
+        if (pending_index == 0x03)
+        {
+            response[0] = (variant == MAX32664_Variant::Variant_D) ? 40 : 10;
+            response[1] = (variant == MAX32664_Variant::Variant_D) ? 6 : 1;
+            response[2] = 0;
+            response_length = 3;
+        }
+        else
+        {
+            response[0] = MAX32664_McuType::McuType_MAX32660;
+            response_length = 1;
+        }
+        break;
+    default:
+        // Algorithm configuration and everything else is accepted without a response
+        break;
+    }
+}
+
+void SimulatedHub::spend_bus_time(uint32_t bytes)
+{
+    HostAdvanceMicros(bytes * I2C_BYTE_US);
+}
+
+void SimulatedHub::check_watchdog()
+{
+    if (watchdog_limit_ms == 0)
+    {
+        return;
+    }
+    uint64_t elapsed_us = HostMicros64() - watchdog_start_us;
+    if (elapsed_us > (uint64_t)watchdog_limit_ms * 1000)
+    {
+        watchdog_limit_ms = 0;
+        throw HubWatchdogExpired{(uint32_t)(elapsed_us / 1000)};
+    }
+}
@@ -0,0 +1,125 @@
+#ifndef __SIMULATED_HUB_H
+#define __SIMULATED_HUB_H
+
+#include <Arduino.h>
+#include "MAX32664_Bus.h"
+
+// Faults the hub model injects. Probabilities are per command; rates are per simulated hour.
+struct HubFaults
+{
+    double write_nack;      // the hub NACKs the command (and the read that follows it)
+    double short_read;      // a read stops after a random number of bytes
+    double try_again;       // the command is answered with ERR_TRY_AGAIN and not executed
+    double stuck_per_hour;  // episodes in which enabling an algorithm is answered with ERR_TRY_AGAIN
+    uint32_t stuck_ms;      // longest episode that ends by itself (the length is uniform up to this)
+    double stuck_wedged;    // fraction of the episodes that only end when the hub is reset
+    double resets_per_hour; // spontaneous resets (brown-out, watchdog) that lose the configuration
+    uint32_t boot_ms;       // time the hub needs after a reset before it answers again
+};
+
+struct HubCounters
+{
+    uint64_t generated;       // samples the algorithm produced while streaming
+    uint64_t delivered;       // samples read out completely
+    uint64_t lost_overflow;   // samples dropped because the output FIFO was full
+    uint64_t lost_reset;      // samples left in the FIFO when the hub was reset
+    uint64_t lost_short_read; // samples popped by a read that stopped early
+    uint64_t commands;
+    uint32_t nacks;
+    uint32_t short_reads;
+    uint32_t try_agains;
+    uint32_t stuck_episodes;
+    uint32_t wedged_episodes;
+    uint32_t busy_refusals; // algorithm enables answered with ERR_TRY_AGAIN during an episode
+    uint32_t busy_run;      // refusals in a row in the current episode
+    uint32_t resets;     // spontaneous resets
+    uint32_t pin_resets; // resets through the reset pin
+};
+
+// Thrown from inside a driver call that has been running for longer than the watchdog allows
+struct HubWatchdogExpired
+{
+    uint32_t elapsed_ms;
+};
+
+/// @brief A model of a MAX32664A or MAX32664D behind a MAX32664_Bus. It produces records at a fixed
+///     rate into a bounded output FIFO while the sensor and the algorithm are enabled, answers the
+///     commands the driver sends, charges bus time to the virtual clock and injects faults.
+///
+/// The IR and red values of every record hold a sequence number, so a reader can tell lost,
+/// repeated and corrupted records apart.
+class SimulatedHub : public MAX32664_Bus
+{
+private:
+    uint8_t variant;
+    uint32_t sample_period_us;
+    uint16_t fifo_capacity;
+    uint32_t *fifo;
+    uint16_t fifo_head;
+    uint16_t fifo_count;
+    uint32_t next_sequence;
+    uint64_t random_state;
+    HubFaults faults;
+    HubCounters counters;
+
+    // Hub state, lost on reset
+    uint8_t device_mode;
+    uint8_t output_format;
+    uint8_t threshold;
+    bool sensor_enabled;
+    bool algorithm_enabled;
+    bool overflow;
+
+    uint8_t reset_pin;
+    bool held_in_reset;
+    uint64_t booting_until_us;
+    bool stuck_armed;
+    uint64_t stuck_until_us;
+    uint64_t next_reset_us;
+    uint64_t next_stuck_us;
+    uint64_t last_sample_us;
+
+    // The command being answered
+    bool pending;
+    uint8_t pending_status;
+    uint8_t pending_family;
+    uint8_t pending_index;
+    uint8_t response[4];
+    uint8_t response_length;
+
+    uint64_t watchdog_start_us;
+    uint32_t watchdog_limit_ms;
+
+    double random_unit();
+    uint64_t random_interval_us(double per_hour);
+    void reset_state();
+    void update();
+    bool streaming();
+    uint8_t record_size();
+    void fill_record(uint32_t sequence, uint8_t *record);
+    void execute(const uint8_t *command, uint8_t command_length, const uint8_t *payload, uint16_t payload_length);
+    void start_stuck_episode(uint64_t now);
+    void spend_bus_time(uint32_t bytes);
+    void check_watchdog();
+
+public:
+    SimulatedHub(uint8_t hub_variant, uint32_t period_us = 10000, uint16_t capacity = 64, uint32_t seed = 1);
+    ~SimulatedHub();
+
+    void SetFaults(const HubFaults &hub_faults);
+    void SetResetPin(uint8_t pin) { reset_pin = pin; }
+    void OnPinWrite(uint8_t pin, uint8_t value);
+
+    void ArmWatchdog(uint32_t limit_ms);
+    void DisarmWatchdog() { watchdog_limit_ms = 0; }
+
+    uint8_t GetRecordSize() { return record_size(); }
+    static bool DecodeSequence(uint32_t ir, uint32_t &sequence);
+    const HubCounters &GetCounters() { return counters; }
+
+    uint8_t Write(uint8_t i2c_address, const uint8_t *command, uint8_t command_length, const uint8_t *payload, uint16_t payload_length) override;
+    uint16_t Read(uint8_t i2c_address, uint8_t &status_byte, uint8_t *read_buffer, uint16_t read_length) override;
+    void Wait(uint16_t milliseconds) override;
+};
+
+#endif /* __SIMULATED_HUB_H */
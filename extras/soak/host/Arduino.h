@@ -0,0 +1,106 @@
+#ifndef __SOAK_HOST_ARDUINO_H
+#define __SOAK_HOST_ARDUINO_H
+
+// The part of the Arduino API that the driver uses, for running it on a host. Time is virtual:
+// it only moves when the program waits or when the simulated hub spends time on the bus, so
+// hours of operation run in seconds. The clock can be used from several threads.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+unsigned long millis();
+unsigned long micros();
+void yield();
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+// Host only: moves the virtual clock forward
+void HostAdvanceMicros(uint32_t us);
+// Host only: the virtual time in microseconds, without wrapping
+uint64_t HostMicros64();
+// Host only: every delay() and delayMicroseconds() oversleeps by up to max_us, like a busy
+// scheduler would (0 to disable)
+void HostSetDelayJitter(uint32_t max_us, uint32_t seed);
+// Host only: called on every digitalWrite(), e.g. so a simulated hub sees its reset pin
+void HostSetPinCallback(void (*callback)(uint8_t pin, uint8_t value, void *context), void *context);
+
+class Print
+{
+public:
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t value) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size)
+    {
+        size_t written = 0;
+        while (size--)
+        {
+            written += write(*buffer++);
+        }
+        return written;
+    }
+
+    size_t print(const char *text) { return write((const uint8_t *)text, strlen(text)); }
+    size_t print(char value) { return write((uint8_t)value); }
+    size_t print(unsigned long value, int base = 10)
+    {
+        char text[24];
+        snprintf(text, sizeof(text), (base == 16) ? "%lx" : "%lu", value);
+        return print(text);
+    }
+    size_t print(long value, int base = 10)
+    {
+        char text[24];
+        snprintf(text, sizeof(text), (base == 16) ? "%lx" : "%ld", value);
+        return print(text);
+    }
+    size_t print(unsigned int value, int base = 10) { return print((unsigned long)value, base); }
+    size_t print(int value, int base = 10) { return print((long)value, base); }
+    size_t print(double value, int digits = 2)
+    {
+        char text[32];
+        snprintf(text, sizeof(text), "%.*f", digits, value);
+        return print(text);
+    }
+    size_t println() { return print("\r\n"); }
+    template <typename T>
+    size_t println(T value) { return print(value) + println(); }
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    size_t readBytes(uint8_t *buffer, size_t length)
+    {
+        size_t count = 0;
+        while (count < length)
+        {
+            int value = read();
+            if (value < 0)
+            {
+                break;
+            }
+            buffer[count++] = (uint8_t)value;
+        }
+        return count;
+    }
+};
+
+#endif /* __SOAK_HOST_ARDUINO_H */
@@ -0,0 +1,51 @@
+#ifndef __SOAK_HOST_WIRE_H
+#define __SOAK_HOST_WIRE_H
+
+#include "Arduino.h"
+
+// A TwoWire with nothing attached, so MAX32664_WireBus compiles. The soak harness replaces the
+// driver's bus with a simulated hub.
+class TwoWire : public Stream
+{
+public:
+    void begin() {}
+    void beginTransmission(uint8_t address) { (void)address; }
+    uint8_t endTransmission(bool stop = true)
+    {
+        (void)stop;
+        return 2; // address NACK
+    }
+    uint8_t requestFrom(int address, int quantity)
+    {
+        (void)address;
+        (void)quantity;
+        return 0;
+    }
+    uint8_t requestFrom(uint8_t address, uint8_t quantity, uint32_t internal_address, uint8_t internal_size, uint8_t stop)
+    {
+        (void)address;
+        (void)quantity;
+        (void)internal_address;
+        (void)internal_size;
+        (void)stop;
+        return 0;
+    }
+
+    size_t write(uint8_t value) override
+    {
+        (void)value;
+        return 1;
+    }
+    size_t write(const uint8_t *buffer, size_t size) override
+    {
+        (void)buffer;
+        return size;
+    }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+};
+
+extern TwoWire Wire;
+
+#endif /* __SOAK_HOST_WIRE_H */
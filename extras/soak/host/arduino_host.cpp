@@ -0,0 +1,96 @@
+#include "Arduino.h"
+#include "Wire.h"
+#include <atomic>
+#include <mutex>
+
+TwoWire Wire;
+
+// The clock is read and advanced from several threads in the threaded tests
+static std::atomic<uint64_t> now_us(0);
+static std::mutex jitter_mutex;
+static uint32_t jitter_max_us = 0;
+static uint32_t jitter_state = 1;
+static void (*pin_callback)(uint8_t pin, uint8_t value, void *context) = NULL;
+static void *pin_context = NULL;
+
+static uint32_t jitter()
+{
+    std::lock_guard<std::mutex> lock(jitter_mutex);
+    if (jitter_max_us == 0)
+    {
+        return 0;
+    }
+    // xorshift32
+    jitter_state ^= jitter_state << 13;
+    jitter_state ^= jitter_state >> 17;
+    jitter_state ^= jitter_state << 5;
+    return jitter_state % (jitter_max_us + 1);
+}
+
+void delay(unsigned long ms)
+{
+    now_us += (uint64_t)ms * 1000 + jitter();
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    now_us += us + jitter();
+}
+
+unsigned long millis()
+{
+    return (unsigned long)(uint32_t)(now_us / 1000);
+}
+
+unsigned long micros()
+{
+    return (unsigned long)(uint32_t)now_us;
+}
+
+void yield()
+{
+    // Nothing else runs on the virtual clock
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+    (void)pin;
+    (void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+    if (pin_callback != NULL)
+    {
+        pin_callback(pin, value, pin_context);
+    }
+}
+
+int digitalRead(uint8_t pin)
+{
+    (void)pin;
+    return HIGH;
+}
+
+void HostAdvanceMicros(uint32_t us)
+{
+    now_us += us;
+}
+
+uint64_t HostMicros64()
+{
+    return now_us;
+}
+
+void HostSetDelayJitter(uint32_t max_us, uint32_t seed)
+{
+    std::lock_guard<std::mutex> lock(jitter_mutex);
+    jitter_max_us = max_us;
+    jitter_state = (seed != 0) ? seed : 1;
+}
+
+void HostSetPinCallback(void (*callback)(uint8_t pin, uint8_t value, void *context), void *context)
+{
+    pin_callback = callback;
+    pin_context = context;
+}
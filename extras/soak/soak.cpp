@@ -0,0 +1,497 @@
+// Soak test: runs the driver for simulated hours against a model of the hub that injects bus
+// faults, busy periods, spontaneous resets and clock jitter, and reports what reached the
+// application. Time is virtual, so a day of operation takes seconds. Build from the repository
+// root with:
+//
+//   g++ -O2 -std=gnu++17 -DMAX32664_ENABLE_STATS=1 -Iextras/soak/host -Isrc -o soak
+//       extras/soak/soak.cpp extras/soak/SimulatedHub.cpp extras/soak/host/arduino_host.cpp
+//       src/ReWire_MAX32664.cpp src/MAX32664_Bus.cpp src/MAX32664_BatchDecode.cpp
+//       src/MAX32664_Threading.cpp -lpthread
+//
+// and run e.g. ./soak --variant=d --hours=24 (./soak --help lists the options). The exit code is
+// 0 when the run stays within --max-drop and --max-recovery-ms, no driver call hangs, no record
+// read with SUCCESS_STATUS is corrupt and, on the MAX32664D, the configuration retried a busy hub
+// and gave up at MAX32664_MAX_RETRIES on a wedged one, so it can gate changes;
+// extras/soak/soak.sh runs both variants that way.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ReWire_MAX32664.h"
+#include "SimulatedHub.h"
+
+#define MFIO_PIN 5
+#define RESET_PIN 4
+
+struct SoakOptions
+{
+    double hours;
+    uint8_t variant;
+    uint32_t seed;
+    double rate_hz;
+    uint32_t fifo;
+    uint32_t poll_ms;
+    uint32_t jitter_us;
+    HubFaults faults;
+    double stalls_per_hour; // the application is busy and does not poll
+    uint32_t stall_ms;
+    uint32_t hang_ms;          // a single driver call that takes longer than this is a hang
+    uint32_t idle_ms;          // no sample for this long while configured: reconfigure the hub
+    uint32_t outage_ms;        // a delivery gap longer than this counts as an outage
+    double max_drop;           // percent
+    uint32_t max_recovery_ms;
+};
+
+struct SoakResults
+{
+    uint64_t good;       // samples with the expected content
+    uint64_t missing;    // sequence numbers that never arrived
+    uint64_t duplicates; // sequence numbers that went backwards
+    uint64_t corrupt;    // records read with SUCCESS_STATUS whose content is wrong
+    uint64_t read_errors;
+    uint32_t configures;
+    uint32_t configure_failures;
+    uint32_t retry_limit_hits; // configures that gave up after MAX32664_MAX_RETRIES refusals
+    uint32_t reconfigures; // the hub stopped delivering and was restarted
+    uint32_t hangs;
+    uint32_t longest_call_ms;
+    uint32_t outages;
+    uint64_t outage_total_ms;
+    uint32_t longest_outage_ms;
+    uint32_t stalls;
+};
+
+static SimulatedHub *hub = NULL;
+static SoakOptions options;
+static SoakResults results;
+static uint64_t random_state = 88172645463325252ULL;
+
+static void usage()
+{
+    printf("usage: soak [options]\n"
+           "  --hours=H              simulated time (default 8)\n"
+           "  --variant=a|d          hub variant (default d)\n"
+           "  --seed=N               random seed (default 1)\n"
+           "  --rate=HZ              record rate of the hub (default 100)\n"
+           "  --fifo=N               output FIFO depth in records (default 64)\n"
+           "  --poll-ms=MS           time between polls (default 50)\n"
+           "  --jitter-us=US         every delay oversleeps by up to US (default 2000)\n"
+           "  --nack=P               probability that a command is NACKed (default 0.001)\n"
+           "  --short=P              probability that a read stops early (default 0.001)\n"
+           "  --try-again=P          probability of ERR_TRY_AGAIN (default 0.002)\n"
+           "  --stuck-per-hour=N     episodes in which the hub refuses to enable an algorithm with\n"
+           "                         ERR_TRY_AGAIN; the first one starts at the first configuration\n"
+           "                         and is wedged (default 2)\n"
+           "  --stuck-ms=MS          longest episode that ends by itself (default 2000)\n"
+           "  --stuck-wedged=P       fraction of episodes that last until the hub is reset (default 0.5)\n"
+           "  --resets-per-hour=N    spontaneous hub resets (default 1)\n"
+           "  --boot-ms=MS           time the hub takes to boot (default 300)\n"
+           "  --stalls-per-hour=N    periods in which the application does not poll (default 6)\n"
+           "  --stall-ms=MS          length of a stall (default 400)\n"
+           "  --hang-ms=MS           longest acceptable driver call (default 30000)\n"
+           "  --idle-ms=MS           reconfigure after this long without a sample (default 2000)\n"
+           "  --outage-ms=MS         delivery gaps longer than this are outages (default 1000)\n"
+           "  --max-drop=PERCENT     fail above this drop rate (default 1)\n"
+           "  --max-recovery-ms=MS   fail if an outage lasts longer (default 15000)\n");
+}
+
+static bool option(const char *arg, const char *name, const char *&value)
+{
+    size_t length = strlen(name);
+    if (strncmp(arg, name, length) != 0 || arg[length] != '=')
+    {
+        return false;
+    }
+    value = arg + length + 1;
+    return true;
+}
+
+static bool parse_options(int argc, char **argv)
+{
+    options.hours = 8;
+    options.variant = MAX32664_Variant::Variant_D;
+    options.seed = 1;
+    options.rate_hz = 100;
+    options.fifo = 64;
+    options.poll_ms = 50;
+    options.jitter_us = 2000;
+    options.faults.write_nack = 0.001;
+    options.faults.short_read = 0.001;
+    options.faults.try_again = 0.002;
+    options.faults.stuck_per_hour = 2;
+    options.faults.stuck_ms = 2000;
+    options.faults.stuck_wedged = 0.5;
+    options.faults.resets_per_hour = 1;
+    options.faults.boot_ms = 300;
+    options.stalls_per_hour = 6;
+    options.stall_ms = 400;
+    options.hang_ms = 30000;
+    options.idle_ms = 2000;
+    options.outage_ms = 1000;
+    options.max_drop = 1.0;
+    options.max_recovery_ms = 15000;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value;
+        if (option(arg, "--hours", value))
+            options.hours = atof(value);
+        else if (option(arg, "--variant", value))
+            options.variant = (value[0] == 'a' || value[0] == 'A') ? MAX32664_Variant::Variant_A : MAX32664_Variant::Variant_D;
+        else if (option(arg, "--seed", value))
+            options.seed = strtoul(value, NULL, 0);
+        else if (option(arg, "--rate", value))
+            options.rate_hz = atof(value);
+        else if (option(arg, "--fifo", value))
+            options.fifo = strtoul(value, NULL, 0);
+        else if (option(arg, "--poll-ms", value))
+            options.poll_ms = strtoul(value, NULL, 0);
+        else if (option(arg, "--jitter-us", value))
+            options.jitter_us = strtoul(value, NULL, 0);
+        else if (option(arg, "--nack", value))
+            options.faults.write_nack = atof(value);
+        else if (option(arg, "--short", value))
+            options.faults.short_read = atof(value);
+        else if (option(arg, "--try-again", value))
+            options.faults.try_again = atof(value);
+        else if (option(arg, "--stuck-per-hour", value))
+            options.faults.stuck_per_hour = atof(value);
+        else if (option(arg, "--stuck-ms", value))
+            options.faults.stuck_ms = strtoul(value, NULL, 0);
+        else if (option(arg, "--stuck-wedged", value))
+            options.faults.stuck_wedged = atof(value);
+        else if (option(arg, "--resets-per-hour", value))
+            options.faults.resets_per_hour = atof(value);
+        else if (option(arg, "--boot-ms", value))
+            options.faults.boot_ms = strtoul(value, NULL, 0);
+        else if (option(arg, "--stalls-per-hour", value))
+            options.stalls_per_hour = atof(value);
+        else if (option(arg, "--stall-ms", value))
+            options.stall_ms = strtoul(value, NULL, 0);
+        else if (option(arg, "--hang-ms", value))
+            options.hang_ms = strtoul(value, NULL, 0);
+        else if (option(arg, "--idle-ms", value))
+            options.idle_ms = strtoul(value, NULL, 0);
+        else if (option(arg, "--outage-ms", value))
+            options.outage_ms = strtoul(value, NULL, 0);
+        else if (option(arg, "--max-drop", value))
+            options.max_drop = atof(value);
+        else if (option(arg, "--max-recovery-ms", value))
+            options.max_recovery_ms = strtoul(value, NULL, 0);
+        else
+        {
+            usage();
+            return false;
+        }
+    }
+    if (options.hours <= 0 || options.rate_hz <= 0 || options.fifo == 0 || options.fifo > 0xFFFF)
+    {
+        usage();
+        return false;
+    }
+    return true;
+}
+
+static double random_unit()
+{
+    random_state ^= random_state >> 12;
+    random_state ^= random_state << 25;
+    random_state ^= random_state >> 27;
+    return (double)((random_state * 0x2545F4914F6CDD1DULL) >> 11) / (double)(1ULL << 53);
+}
+
+static void on_pin_write(uint8_t pin, uint8_t value, void *context)
+{
+    ((SimulatedHub *)context)->OnPinWrite(pin, value);
+}
+
+/// @brief Reads one record in the layout of the variant
+/// @return the status byte; sequence and valid describe the record when it is SUCCESS_STATUS
+static uint8_t read_record(ReWire_MAX32664 &driver, uint32_t &sequence, bool &valid)
+{
+    uint8_t status_byte;
+    uint32_t ir, red;
+    bool content_ok;
+    if (options.variant == MAX32664_Variant::Variant_A)
+    {
+        MAX32664_Data sample;
+        status_byte = driver.ReadSample_SensorAndAlgorithm(sample);
+        ir = sample.ir;
+        red = sample.red;
+        content_ok = sample.hr == 72 && sample.spo2 == 98 && sample.algorithm_state == MAX32664_ALGORITHM_STATE_FINGER_DETECTED;
+    }
+    else
+    {
+        MAX32664_Data_VerD sample;
+        status_byte = driver.ReadSample_BPTSensorAndAlgorithm(sample);
+        ir = sample.ir;
+        red = sample.red;
+        content_ok = sample.hr == 72.0f && sample.sys_bp == 120 && sample.dia_bp == 80 && sample.spo2 == 97.5f && sample.r_value == 0.5f && sample.spo2_conf == 95;
+    }
+    valid = content_ok && ir == red && SimulatedHub::DecodeSequence(ir, sequence);
+    return status_byte;
+}
+
+int main(int argc, char **argv)
+{
+    if (!parse_options(argc, argv))
+    {
+        return 2;
+    }
+    random_state ^= (uint64_t)options.seed * 0x9E3779B97F4A7C15ULL;
+
+    SimulatedHub simulated_hub(options.variant, (uint32_t)(1e6 / options.rate_hz), (uint16_t)options.fifo, options.seed);
+    hub = &simulated_hub;
+    hub->SetFaults(options.faults);
+    hub->SetResetPin(RESET_PIN);
+    HostSetPinCallback(on_pin_write, hub);
+    HostSetDelayJitter(options.jitter_us, options.seed);
+
+    ReWire_MAX32664 driver(&Wire, MFIO_PIN, RESET_PIN);
+    driver.SetBus(hub);
+
+    const uint64_t start_us = HostMicros64();
+    const uint64_t end_us = start_us + (uint64_t)(options.hours * 3600e6);
+    const uint64_t sequence_modulo = 0xFFFFFFUL / 10;
+    clock_t wall_start = clock();
+
+    bool configured = false;
+    bool have_sequence = false;
+    uint32_t expected_sequence = 0;
+    uint32_t consecutive_errors = 0;
+    uint64_t last_good_us = start_us;
+    uint64_t configured_at_us = start_us;
+    uint64_t next_stall_us = start_us + (uint64_t)(-log(1.0 - random_unit()) * 3600e6 / options.stalls_per_hour);
+    uint64_t next_report_us = start_us + 3600000000ULL;
+
+    while (HostMicros64() < end_us)
+    {
+        uint64_t call_start_us = HostMicros64();
+        hub->ArmWatchdog(options.hang_ms);
+        try
+        {
+            if (!configured)
+            {
+                uint8_t device_mode = 0xFF;
+                uint8_t status_byte = driver.Restart(device_mode);
+                if (status_byte == MAX32664_ReadStatusByteValue::SUCCESS_STATUS && device_mode == MAX32664_DeviceOperatingMode::ApplicationMode)
+                {
+                    status_byte = driver.ConfigureDevice();
+                }
+                results.configures++;
+                if (status_byte == MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+                {
+                    configured = true;
+                    consecutive_errors = 0;
+                    configured_at_us = HostMicros64();
+                }
+                else
+                {
+                    results.configure_failures++;
+                    if (status_byte == MAX32664_ReadStatusByteValue::ERR_TRY_AGAIN && hub->GetCounters().busy_run > MAX32664_MAX_RETRIES)
+                    {
+                        results.retry_limit_hits++;
+                    }
+                    delay(1000);
+                }
+            }
+            else
+            {
+                uint8_t hub_status = 0;
+                uint8_t num_samples = 0;
+                uint8_t status_byte = driver.ReadSensorHubStatus(hub_status);
+                if (status_byte == MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+                {
+                    status_byte = driver.ReadNumberAvailableSamples(num_samples);
+                }
+                if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+                {
+                    // A failed read leaves the count undefined (0xFF after a NACK)
+                    results.read_errors++;
+                    consecutive_errors++;
+                    num_samples = 0;
+                }
+
+                for (uint8_t i = 0; i < num_samples; i++)
+                {
+                    uint32_t sequence = 0;
+                    bool valid = false;
+                    status_byte = read_record(driver, sequence, valid);
+                    if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+                    {
+                        results.read_errors++;
+                        consecutive_errors++;
+                        continue;
+                    }
+                    if (!valid)
+                    {
+                        results.corrupt++;
+                        continue;
+                    }
+
+                    consecutive_errors = 0;
+                    if (have_sequence && sequence != expected_sequence)
+                    {
+                        uint32_t distance = (uint32_t)((sequence + sequence_modulo - expected_sequence) % sequence_modulo);
+                        if (distance > sequence_modulo / 2)
+                        {
+                            results.duplicates++;
+                            continue;
+                        }
+                        results.missing += distance;
+                    }
+                    have_sequence = true;
+                    expected_sequence = (uint32_t)((sequence + 1) % sequence_modulo);
+                    results.good++;
+
+                    uint64_t now = HostMicros64();
+                    uint32_t gap_ms = (uint32_t)((now - last_good_us) / 1000);
+                    if (gap_ms > options.outage_ms)
+                    {
+                        results.outages++;
+                        results.outage_total_ms += gap_ms;
+                        if (gap_ms > results.longest_outage_ms)
+                        {
+                            results.longest_outage_ms = gap_ms;
+                        }
+                    }
+                    last_good_us = now;
+                }
+
+                // A hub that keeps failing, or that has silently lost its configuration (a reset
+                // the application did not see), is restarted
+                uint64_t now = HostMicros64();
+                uint64_t since_us = (last_good_us > configured_at_us) ? last_good_us : configured_at_us;
+                if (consecutive_errors >= 5 || now - since_us > (uint64_t)options.idle_ms * 1000)
+                {
+                    configured = false;
+                    results.reconfigures++;
+                }
+            }
+        }
+        catch (const HubWatchdogExpired &expired)
+        {
+            results.hangs++;
+            fprintf(stderr, "hang: a driver call was still running after %lu ms (at %.3f h)\n",
+                    (unsigned long)expired.elapsed_ms, (HostMicros64() - start_us) / 3600e6);
+            configured = false;
+        }
+        hub->DisarmWatchdog();
+
+        uint32_t call_ms = (uint32_t)((HostMicros64() - call_start_us) / 1000);
+        if (call_ms > results.longest_call_ms)
+        {
+            results.longest_call_ms = call_ms;
+        }
+
+        if (configured)
+        {
+            delay(options.poll_ms);
+        }
+        if (options.stalls_per_hour > 0 && HostMicros64() >= next_stall_us)
+        {
+            results.stalls++;
+            delay(options.stall_ms);
+            next_stall_us = HostMicros64() + (uint64_t)(-log(1.0 - random_unit()) * 3600e6 / options.stalls_per_hour);
+        }
+
+        if (HostMicros64() >= next_report_us)
+        {
+            const HubCounters &counters = hub->GetCounters();
+            printf("hour %3.0f: %llu samples, %.3f%% dropped, %lu reconfigures, %lu hangs\n",
+                   (next_report_us - start_us) / 3600e6, (unsigned long long)results.good,
+                   counters.generated ? 100.0 * (counters.generated - results.good) / counters.generated : 0.0,
+                   (unsigned long)results.reconfigures, (unsigned long)results.hangs);
+            next_report_us += 3600000000ULL;
+        }
+    }
+
+    double seconds = (HostMicros64() - start_us) / 1e6;
+    double wall_seconds = (double)(clock() - wall_start) / CLOCKS_PER_SEC;
+    const HubCounters &counters = hub->GetCounters();
+    MAX32664_Stats stats;
+    driver.GetStats(stats);
+    uint32_t transactions = 0;
+    for (uint8_t i = 0; i < StatsFamily_Count; i++)
+    {
+        transactions += stats.family[i].transactions;
+    }
+
+    // Anything the hub produced that did not reach the application counts as dropped, whatever
+    // the reason (overflow, reset, short read, corruption or records still in the FIFO)
+    uint64_t dropped = (counters.generated > results.good) ? counters.generated - results.good : 0;
+    double drop_rate = counters.generated ? 100.0 * dropped / counters.generated : 100.0;
+    double mean_outage_ms = results.outages ? (double)results.outage_total_ms / results.outages : 0.0;
+
+    printf("\nMAX32664%c soak: %.1f simulated hours in %.1f s (%.0fx), seed %lu\n",
+           options.variant == MAX32664_Variant::Variant_A ? 'A' : 'D', seconds / 3600, wall_seconds,
+           wall_seconds > 0 ? seconds / wall_seconds : 0.0, (unsigned long)options.seed);
+    printf("  throughput       %.2f samples/s sustained (hub rate %.2f/s)\n", results.good / seconds, options.rate_hz);
+    printf("  samples          %llu generated, %llu delivered, %.4f%% dropped\n",
+           (unsigned long long)counters.generated, (unsigned long long)results.good, drop_rate);
+    printf("    lost in hub    %llu FIFO overflow, %llu reset, %llu short read\n",
+           (unsigned long long)counters.lost_overflow, (unsigned long long)counters.lost_reset, (unsigned long long)counters.lost_short_read);
+    printf("    seen by app    %llu missing, %llu corrupt, %llu duplicate, %llu read errors\n",
+           (unsigned long long)results.missing, (unsigned long long)results.corrupt, (unsigned long long)results.duplicates,
+           (unsigned long long)results.read_errors);
+    printf("  recovery         %lu outages > %lu ms, mean %.0f ms, longest %lu ms\n",
+           (unsigned long)results.outages, (unsigned long)options.outage_ms, mean_outage_ms, (unsigned long)results.longest_outage_ms);
+    printf("  restarts         %lu configures (%lu failed), %lu after the hub stopped delivering\n",
+           (unsigned long)results.configures, (unsigned long)results.configure_failures, (unsigned long)results.reconfigures);
+    printf("  hangs            %lu (longest driver call %lu ms, limit %lu ms)\n",
+           (unsigned long)results.hangs, (unsigned long)results.longest_call_ms, (unsigned long)options.hang_ms);
+    printf("  faults injected  %lu NACKs, %lu short reads, %lu ERR_TRY_AGAIN, %lu resets, %lu stalls\n",
+           (unsigned long)counters.nacks, (unsigned long)counters.short_reads, (unsigned long)counters.try_agains,
+           (unsigned long)counters.resets, (unsigned long)results.stalls);
+    printf("  busy hub         %lu stuck episodes (%lu wedged), %lu refused enables, %lu configures gave up at the retry limit\n",
+           (unsigned long)counters.stuck_episodes, (unsigned long)counters.wedged_episodes, (unsigned long)counters.busy_refusals,
+           (unsigned long)results.retry_limit_hits);
+    printf("  driver           %lu transactions, %lu retries, %lu try again, %lu short reads, %lu write errors, %lu FIFO overflows\n",
+           (unsigned long)transactions, (unsigned long)stats.retries, (unsigned long)stats.try_again, (unsigned long)stats.short_reads,
+           (unsigned long)stats.write_errors, (unsigned long)stats.fifo_out_overflows);
+
+    bool pass = true;
+    if (results.hangs > 0)
+    {
+        printf("FAIL: %lu driver calls hung\n", (unsigned long)results.hangs);
+        pass = false;
+    }
+    if (drop_rate > options.max_drop)
+    {
+        printf("FAIL: drop rate %.4f%% is above %.4f%%\n", drop_rate, options.max_drop);
+        pass = false;
+    }
+    if (results.longest_outage_ms > options.max_recovery_ms)
+    {
+        printf("FAIL: recovery took %lu ms, limit %lu ms\n", (unsigned long)results.longest_outage_ms, (unsigned long)options.max_recovery_ms);
+        pass = false;
+    }
+    // Every record read with SUCCESS_STATUS must decode to the content the hub model wrote
+    if (results.corrupt > 0)
+    {
+        printf("FAIL: %llu records were read with SUCCESS_STATUS but decoded wrong\n", (unsigned long long)results.corrupt);
+        pass = false;
+    }
+    // Only the MAX32664D configuration re-sends the algorithm enable while the hub is busy. A run
+    // with stuck episodes must have retried, and given up at the limit on a wedged hub.
+    if (options.variant == MAX32664_Variant::Variant_D && options.faults.stuck_per_hour > 0)
+    {
+        if (stats.retries == 0)
+        {
+            printf("FAIL: the hub was busy but the driver never retried\n");
+            pass = false;
+        }
+        if (results.retry_limit_hits == 0)
+        {
+            printf("FAIL: no configuration gave up at MAX32664_MAX_RETRIES\n");
+            pass = false;
+        }
+    }
+    if (pass)
+    {
+        printf("PASS\n");
+    }
+    return pass ? 0 : 1;
+}
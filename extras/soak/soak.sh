@@ -0,0 +1,23 @@
+#!/bin/sh
+# Builds the soak test and runs it for both hub variants with the default fault mix. Fails when a
+# driver call hangs, too many samples are dropped, a record decodes wrong, recovery takes too
+# long or, on the MAX32664D, the bounded ERR_TRY_AGAIN retries were not exercised, so it can gate
+# changes to the driver. Extra arguments are passed to every run (e.g. --hours=24 --seed=7).
+#
+# Run from the root of the library:
+#   extras/soak/soak.sh [soak options]
+
+CXX=${CXX:-g++}
+BUILD_DIR=${TMPDIR:-/tmp}/max32664_soak
+mkdir -p "$BUILD_DIR" || exit 1
+
+$CXX -O2 -std=gnu++17 -DMAX32664_ENABLE_STATS=1 -Iextras/soak/host -Isrc -o "$BUILD_DIR/soak" \
+    extras/soak/soak.cpp extras/soak/SimulatedHub.cpp extras/soak/host/arduino_host.cpp \
+    src/ReWire_MAX32664.cpp src/MAX32664_Bus.cpp src/MAX32664_BatchDecode.cpp \
+    src/MAX32664_Threading.cpp -lpthread || exit 1
+
+status=0
+for variant in a d; do
+    "$BUILD_DIR/soak" --variant=$variant "$@" || status=1
+done
+exit $status
@@ -0,0 +1,343 @@
+// Threaded test of MAX32664_Acquisition and MAX32664_SpscQueue on the host. Two drivers share one
+// bus mutex through MAX32664_LockedBus and each runs an acquisition thread against a mock hub,
+// while a third thread sends commands between LockDriver() and UnlockDriver(). The mock checks
+// that no other transaction is on the bus while it answers, and every record carries a sequence
+// number, so the consumer can tell lost and reordered samples apart. Build from the repository
+// root with:
+//
+//   g++ -O2 -std=gnu++17 -Iextras/soak/host -Isrc -o acquisition_test
+//       extras/tests/acquisition_test.cpp extras/soak/host/arduino_host.cpp
+//       src/ReWire_MAX32664.cpp src/MAX32664_Bus.cpp src/MAX32664_BatchDecode.cpp
+//       src/MAX32664_Threading.cpp src/MAX32664_Acquisition.cpp -lpthread
+//
+// and run ./acquisition_test. The exit code is 0 when every check passes. Adding
+// -fsanitize=thread also checks the test for data races.
+
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "ReWire_MAX32664.h"
+#include "MAX32664_Acquisition.h"
+
+#define RECORD_SIZE 21
+#define QUEUE_TEST_ELEMENTS 2000000
+#define RUN_MS 1500
+#define CONSUMER_PAUSE_MS 300
+
+static uint32_t failures = 0;
+
+static void check(bool condition, const char *what)
+{
+    printf("  %-60s %s\n", what, condition ? "ok" : "FAILED");
+    failures += condition ? 0 : 1;
+}
+
+/// @brief What the hubs on one physical bus see: a transaction that starts while another one is
+///     still on the bus means the bus mutex was not held
+struct BusMonitor
+{
+    std::atomic<int> active;
+    std::atomic<uint32_t> transactions;
+    std::atomic<uint32_t> overlaps;
+
+    BusMonitor() : active(0), transactions(0), overlaps(0) {}
+
+    void enter()
+    {
+        transactions++;
+        if (active.fetch_add(1) != 0)
+        {
+            overlaps++;
+        }
+        // Stay on the bus long enough for an unlocked transaction to run into this one
+        std::this_thread::sleep_for(std::chrono::microseconds(20));
+    }
+
+    void leave() { active.fetch_sub(1); }
+};
+
+/// @brief A MAX32664A that produces a few sensor + algorithm records every time the host asks
+///     how many are available. The IR and red values of each record hold its sequence number.
+class MockHub : public MAX32664_Bus
+{
+private:
+    BusMonitor *monitor;
+    uint8_t family;
+    uint8_t index;
+    uint32_t queries;
+    uint32_t available;
+    uint32_t next_sequence;
+
+public:
+    uint32_t delivered;
+    uint32_t unexpected; // commands the mock does not know, or reads of the wrong length
+
+    MockHub(BusMonitor *bus_monitor)
+    {
+        monitor = bus_monitor;
+        family = 0;
+        index = 0;
+        queries = 0;
+        available = 0;
+        next_sequence = 0;
+        delivered = 0;
+        unexpected = 0;
+    }
+
+    uint8_t Write(uint8_t i2c_address, const uint8_t *command, uint8_t command_length, const uint8_t *payload, uint16_t payload_length) override
+    {
+        (void)i2c_address;
+        (void)payload;
+        (void)payload_length;
+        monitor->enter();
+        family = command[0];
+        index = (command_length > 1) ? command[1] : 0;
+        monitor->leave();
+        return 0;
+    }
+
+    uint16_t Read(uint8_t i2c_address, uint8_t &status_byte, uint8_t *read_buffer, uint16_t read_length) override
+    {
+        (void)i2c_address;
+        monitor->enter();
+        status_byte = MAX32664_ReadStatusByteValue::SUCCESS_STATUS;
+        memset(read_buffer, 0, read_length);
+
+        if (family == MAX32664_CommandFamilyByte::ReadOutputFIFO && index == 0x00)
+        {
+            available += 1 + (queries++ % 4);
+            read_buffer[0] = (available < 0xFF) ? available : 0xFF;
+        }
+        else if (family == MAX32664_CommandFamilyByte::ReadOutputFIFO && index == 0x01 && read_length == RECORD_SIZE && available > 0)
+        {
+            // The driver divides IR and red by 10
+            uint32_t raw = next_sequence++ * 10;
+            read_buffer[0] = read_buffer[3] = raw >> 16;
+            read_buffer[1] = read_buffer[4] = raw >> 8;
+            read_buffer[2] = read_buffer[5] = raw;
+            available--;
+            delivered++;
+        }
+        else if (family == MAX32664_CommandFamilyByte::ReadIdentity && index == 0x03 && read_length == 3)
+        {
+            read_buffer[0] = 10;
+            read_buffer[1] = 1;
+            read_buffer[2] = 0;
+        }
+        else if (family != MAX32664_CommandFamilyByte::ReadSensorHubStatus)
+        {
+            status_byte = MAX32664_ReadStatusByteValue::ERR_UNAVAIL_CMD;
+            unexpected++;
+        }
+
+        monitor->leave();
+        return read_length + 1;
+    }
+
+    void Wait(uint16_t milliseconds) override
+    {
+        // Command delays run ten times faster than on the hub, the virtual clock at full speed
+        HostAdvanceMicros(milliseconds * 1000UL);
+        std::this_thread::sleep_for(std::chrono::microseconds(milliseconds * 100UL));
+    }
+};
+
+/// @brief Checks what one consumer takes out of an acquisition queue
+struct ConsumerCheck
+{
+    uint32_t popped;
+    uint32_t skipped;   // sequence numbers jumped over, must match GetDropped()
+    uint32_t reordered; // sequence numbers that went backwards or repeated
+    uint32_t time_reversals;
+    uint32_t next_sequence;
+    uint32_t last_time_ms;
+
+    ConsumerCheck() : popped(0), skipped(0), reordered(0), time_reversals(0), next_sequence(0), last_time_ms(0) {}
+
+    void drain(MAX32664_Acquisition &acquisition)
+    {
+        MAX32664_AcquiredSample sample;
+        while (acquisition.Pop(sample))
+        {
+            popped++;
+            uint32_t sequence = sample.data.ir;
+            if (sequence < next_sequence || sample.data.red != sequence)
+            {
+                reordered++;
+                continue;
+            }
+            skipped += sequence - next_sequence;
+            next_sequence = sequence + 1;
+            time_reversals += (sample.time_ms < last_time_ms) ? 1 : 0;
+            last_time_ms = sample.time_ms;
+        }
+    }
+};
+
+struct QueueElement
+{
+    uint32_t sequence;
+    uint32_t inverse; // ~sequence, to catch an element read while it is being written
+};
+
+static void test_queue()
+{
+    printf("SPSC queue, %d elements through 8 slots\n", QUEUE_TEST_ELEMENTS);
+    MAX32664_SpscQueue<QueueElement, 8> queue;
+
+    std::thread producer([&queue]()
+                         {
+                             for (uint32_t i = 0; i < QUEUE_TEST_ELEMENTS; i++)
+                             {
+                                 QueueElement element = {i, ~i};
+                                 while (!queue.Push(element))
+                                 {
+                                     std::this_thread::yield();
+                                 }
+                             } });
+
+    uint32_t expected = 0;
+    uint32_t out_of_order = 0;
+    uint32_t torn = 0;
+    while (expected < QUEUE_TEST_ELEMENTS)
+    {
+        QueueElement element;
+        if (!queue.Pop(element))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        torn += (element.inverse != ~element.sequence) ? 1 : 0;
+        out_of_order += (element.sequence != expected) ? 1 : 0;
+        expected = element.sequence + 1;
+    }
+    producer.join();
+
+    QueueElement element;
+    check(out_of_order == 0, "every element arrives once and in order");
+    check(torn == 0, "no element is read half-written");
+    check(!queue.Pop(element) && queue.Size() == 0, "the queue is empty at the end");
+}
+
+static void test_locked_acquisition()
+{
+    printf("Two acquisition threads on a locked bus, a command thread and a slow consumer\n");
+    MAX32664_Mutex bus_mutex;
+    BusMonitor monitor;
+    MockHub hub_1(&monitor);
+    MockHub hub_2(&monitor);
+    MAX32664_LockedBus bus_1(&hub_1, &bus_mutex);
+    MAX32664_LockedBus bus_2(&hub_2, &bus_mutex);
+    ReWire_MAX32664 driver_1;
+    ReWire_MAX32664 driver_2;
+    driver_1.SetBus(&bus_1);
+    driver_2.SetBus(&bus_2);
+    MAX32664_Acquisition acquisition_1(&driver_1);
+    MAX32664_Acquisition acquisition_2(&driver_2);
+
+    std::atomic<bool> commanding(true);
+    std::atomic<uint32_t> commands(0);
+    std::atomic<uint32_t> command_errors(0);
+    std::thread commander([&]()
+                          {
+                              while (commanding)
+                              {
+                                  uint8_t major = 0, minor = 0, revision = 0;
+                                  acquisition_1.LockDriver();
+                                  uint8_t status_byte = driver_1.ReadSensorHubVersion(major, minor, revision);
+                                  acquisition_1.UnlockDriver();
+                                  commands++;
+                                  if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS || major != 10 || minor != 1)
+                                  {
+                                      command_errors++;
+                                  }
+                                  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                              } });
+
+    check(acquisition_1.Start(1) && acquisition_2.Start(1), "both acquisition threads start");
+
+    ConsumerCheck consumer_1;
+    ConsumerCheck consumer_2;
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed_ms = [&start]()
+    { return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count(); };
+    bool paused = false;
+    while (elapsed_ms() < RUN_MS)
+    {
+        if (!paused && elapsed_ms() > RUN_MS / 2)
+        {
+            // Fall behind so the queues overflow
+            paused = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(CONSUMER_PAUSE_MS));
+        }
+        consumer_1.drain(acquisition_1);
+        consumer_2.drain(acquisition_2);
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+
+    commanding = false;
+    commander.join();
+    acquisition_1.Stop();
+    acquisition_2.Stop();
+    consumer_1.drain(acquisition_1);
+    consumer_2.drain(acquisition_2);
+
+    printf("  %u + %u records, %u + %u dropped, %u commands, %u bus transactions\n",
+           (unsigned)consumer_1.popped, (unsigned)consumer_2.popped, (unsigned)acquisition_1.GetDropped(),
+           (unsigned)acquisition_2.GetDropped(), (unsigned)commands, (unsigned)monitor.transactions);
+    check(monitor.overlaps == 0, "no transaction overlaps another one on the bus");
+    check(hub_1.unexpected == 0 && hub_2.unexpected == 0, "every command reaches the hub intact");
+    check(commands > 0 && command_errors == 0, "commands between LockDriver() and UnlockDriver() succeed");
+    check(!acquisition_1.IsRunning() && !acquisition_2.IsRunning(), "Stop() ends both threads");
+    check(consumer_1.popped > 0 && consumer_2.popped > 0, "both consumers receive records");
+    check(consumer_1.reordered == 0 && consumer_2.reordered == 0, "no record is repeated or reordered");
+    check(consumer_1.popped + acquisition_1.GetDropped() == hub_1.delivered &&
+              consumer_2.popped + acquisition_2.GetDropped() == hub_2.delivered,
+          "every record read from a hub is popped or counted as dropped");
+    check(consumer_1.skipped == acquisition_1.GetDropped() && consumer_2.skipped == acquisition_2.GetDropped(),
+          "the only gaps in the sequence are the dropped records");
+    check(acquisition_1.GetDropped() > 0, "the consumer pause overflows the queue");
+    check(consumer_1.time_reversals == 0 && consumer_2.time_reversals == 0, "sample timestamps never go backwards");
+}
+
+static void test_unlocked_control()
+{
+    // Without MAX32664_LockedBus the monitor has to see overlaps, otherwise the check above
+    // proves nothing
+    printf("Control: two acquisition threads on an unlocked bus\n");
+    BusMonitor monitor;
+    MockHub hub_1(&monitor);
+    MockHub hub_2(&monitor);
+    ReWire_MAX32664 driver_1;
+    ReWire_MAX32664 driver_2;
+    driver_1.SetBus(&hub_1);
+    driver_2.SetBus(&hub_2);
+    MAX32664_Acquisition acquisition_1(&driver_1);
+    MAX32664_Acquisition acquisition_2(&driver_2);
+
+    acquisition_1.Start(0);
+    acquisition_2.Start(0);
+    ConsumerCheck consumer_1;
+    ConsumerCheck consumer_2;
+    for (int i = 0; i < 500 && monitor.overlaps == 0; i++)
+    {
+        consumer_1.drain(acquisition_1);
+        consumer_2.drain(acquisition_2);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    acquisition_1.Stop();
+    acquisition_2.Stop();
+
+    check(monitor.overlaps > 0, "the bus monitor detects unlocked transactions");
+}
+
+int main()
+{
+    test_queue();
+    test_locked_acquisition();
+    test_unlocked_control();
+
+    printf("%s\n", (failures == 0) ? "PASS" : "FAIL");
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,120 @@
+// Golden replay test of the MAX32664D sensor + algorithm decoder. A short capture of two FIFO reads
+// is stored below byte for byte; it is fed to the driver through MAX32664_ReplayBus and every
+// decoded field is compared against the values the hub encoded. HR and SpO2 are sent in tenths
+// and R in thousandths, so the golden values have non-zero fractions that an integer division
+// would drop. Build from the repository root with:
+//
+//   g++ -O2 -std=gnu++17 -Iextras/soak/host -Isrc -o replay_golden_test
+//       extras/tests/replay_golden_test.cpp extras/soak/host/arduino_host.cpp
+//       src/ReWire_MAX32664.cpp src/MAX32664_Bus.cpp src/MAX32664_BatchDecode.cpp
+//       src/MAX32664_Capture.cpp src/MAX32664_Threading.cpp -lpthread
+//
+// and run ./replay_golden_test. The exit code is 0 when every check passes.
+
+#include <stdio.h>
+#include <math.h>
+#include "ReWire_MAX32664.h"
+#include "MAX32664_Capture.h"
+
+static uint32_t failures = 0;
+
+static void check(bool condition, const char *what)
+{
+    printf("  %-60s %s\n", what, condition ? "ok" : "FAILED");
+    failures += condition ? 0 : 1;
+}
+
+static bool near(float value, float expected)
+{
+    return fabsf(value - expected) < 1e-4f;
+}
+
+// Capture file version 1: a write of the ReadOutputFIFO command, the command delay and a
+// 29-byte read (30 with the status byte), twice. The time deltas are left at zero.
+static const uint8_t golden_capture[] = {
+    'M', '3', '2', 'C', MAX32664_CAPTURE_VERSION,
+
+    // First record
+    'W', 0, 0, 0, 0, 3, 0, /* endTransmission */ 0x00, 0x12, 0x01,
+    'D', 0, 0, 0, 0, 2, 0, MAX32664_COMMAND_DELAY, 0,
+    'R', 0, 0, 0, 0, 32, 0, /* requested */ 30, 0, /* status */ 0x00,
+    0x01, 0xE2, 0x40,                   // IR 123456
+    0x00, 0xFD, 0xE8,                   // red 65000
+    0, 0, 0, 0, 0, 0,                   // unused LED channels
+    0x02,                               // bp_status
+    100,                                // progress
+    0x02, 0xD5,                         // HR 725 = 72.5 bpm
+    121, 79,                            // systolic, diastolic
+    0x03, 0xCD,                         // SpO2 973 = 97.3 %
+    0x02, 0x14,                         // R 532 = 0.532
+    1,                                  // pulse flag
+    0x03, 0x2C,                         // IBI 812
+    95, 1, 2, 0,                        // SpO2 confidence, BPT report, SpO2 report, end
+
+    // Second record
+    'W', 0, 0, 0, 0, 3, 0, 0x00, 0x12, 0x01,
+    'D', 0, 0, 0, 0, 2, 0, MAX32664_COMMAND_DELAY, 0,
+    'R', 0, 0, 0, 0, 32, 0, 30, 0, 0x00,
+    0x01, 0xE2, 0x4A,                   // IR 123466
+    0x00, 0xFD, 0xF2,                   // red 65010
+    0, 0, 0, 0, 0, 0,
+    0x02,
+    100,
+    0x02, 0xE4,                         // HR 740 = 74.0 bpm
+    118, 77,
+    0x03, 0xD9,                         // SpO2 985 = 98.5 %
+    0x03, 0x27,                         // R 807 = 0.807
+    0,
+    0x03, 0x20,                         // IBI 800
+    97, 1, 2, 0};
+
+/// @brief Reads the capture back from the array above, as a file on an SD card would be read
+class GoldenStream : public Stream
+{
+private:
+    size_t position;
+
+public:
+    GoldenStream() : position(0) {}
+
+    int available() override { return sizeof(golden_capture) - position; }
+    int read() override { return (position < sizeof(golden_capture)) ? golden_capture[position++] : -1; }
+    int peek() override { return (position < sizeof(golden_capture)) ? golden_capture[position] : -1; }
+    size_t write(uint8_t) override { return 0; }
+};
+
+int main()
+{
+    printf("Replaying the golden MAX32664D capture\n");
+    GoldenStream capture;
+    MAX32664_ReplayBus replay(&capture);
+    ReWire_MAX32664 driver;
+    driver.SetBus(&replay);
+    check(replay.Begin(), "the capture header is accepted");
+
+    MAX32664_Data_VerD first;
+    check(driver.ReadSample_BPTSensorAndAlgorithm(first) == MAX32664_ReadStatusByteValue::SUCCESS_STATUS, "the first record is read");
+    check(first.ir == 12345 && first.red == 6500, "IR and red of the first record");
+    check(first.bp_status == 2 && first.progress == 100, "BP status and progress of the first record");
+    check(near(first.hr, 72.5f), "HR keeps its tenths (72.5)");
+    check(first.sys_bp == 121 && first.dia_bp == 79, "systolic and diastolic of the first record");
+    check(near(first.spo2, 97.3f), "SpO2 keeps its tenths (97.3)");
+    check(near(first.r_value, 0.532f), "R keeps its thousandths (0.532)");
+    check(first.pulse_flag == 1 && first.ibi == 812.0f, "pulse flag and IBI of the first record");
+    check(first.spo2_conf == 95 && first.bpt_report == 1 && first.spo2_report == 2, "confidence and reports of the first record");
+
+    MAX32664_Data_VerD second;
+    check(driver.ReadSample_BPTSensorAndAlgorithm(second) == MAX32664_ReadStatusByteValue::SUCCESS_STATUS, "the second record is read");
+    check(second.ir == 12346 && second.red == 6501, "IR and red of the second record");
+    check(near(second.hr, 74.0f) && near(second.spo2, 98.5f), "HR and SpO2 of the second record");
+    check(near(second.r_value, 0.807f), "R of the second record (0.807)");
+    check(second.sys_bp == 118 && second.dia_bp == 77 && second.ibi == 800.0f, "BP and IBI of the second record");
+
+    check(replay.GetMismatches() == 0, "the driver sends the recorded commands");
+    MAX32664_Data_VerD past_end;
+    check(driver.ReadSample_BPTSensorAndAlgorithm(past_end) != MAX32664_ReadStatusByteValue::SUCCESS_STATUS && replay.IsFinished(),
+          "a read past the end of the capture fails");
+
+    printf("%s\n", (failures == 0) ? "PASS" : "FAIL");
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,159 @@
+#include "MAX32664_Acquisition.h"
+
+#if MAX32664_HAS_THREADS
+
+#if !defined(ESP32)
+#include <chrono>
+#endif
+
+MAX32664_Acquisition::MAX32664_Acquisition(ReWire_MAX32664 *driver)
+    : dropped(0), last_status(MAX32664_ReadStatusByteValue::SUCCESS_STATUS), running(false)
+{
+    max32664 = driver;
+    poll_interval_ms = 20;
+#if defined(ESP32)
+    task = NULL;
+    task_done = true;
+#endif
+}
+
+MAX32664_Acquisition::~MAX32664_Acquisition()
+{
+    Stop();
+}
+
+/// @brief Starts the acquisition task. The hub must already be configured.
+/// @param poll_interval the time between two polls of the output FIFO, in milliseconds
+/// @return false if the task is already running or could not be created
+bool MAX32664_Acquisition::Start(uint32_t poll_interval)
+{
+    if (running)
+    {
+        return false;
+    }
+    poll_interval_ms = poll_interval;
+    running = true;
+
+#if defined(ESP32)
+    task_done = false;
+    if (xTaskCreate(task_main, "max32664", MAX32664_ACQUISITION_STACK_SIZE, this, MAX32664_ACQUISITION_PRIORITY, &task) != pdPASS)
+    {
+        running = false;
+        task_done = true;
+        return false;
+    }
+#else
+    thread = std::thread(&MAX32664_Acquisition::run, this);
+#endif
+    return true;
+}
+
+/// @brief Stops the acquisition task and waits for it to finish its current poll
+void MAX32664_Acquisition::Stop()
+{
+    running = false;
+#if defined(ESP32)
+    while (!task_done)
+    {
+        vTaskDelay(1);
+    }
+    task = NULL;
+#else
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+#endif
+}
+
+/// @brief Drains the output FIFO once into the queue. The acquisition task calls this every
+///     poll interval; call it yourself instead of Start() to acquire from your own task.
+/// @return the status of the last command
+uint8_t MAX32664_Acquisition::Poll()
+{
+    driver_mutex.Lock();
+
+    bool bpt = max32664->GetCapabilities().has_bpt;
+    uint8_t hub_status;
+    uint8_t num_samples = 0;
+    uint8_t status_byte = max32664->ReadSensorHubStatus(hub_status);
+    if (status_byte == MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        status_byte = max32664->ReadNumberAvailableSamples(num_samples);
+    }
+
+    for (uint8_t i = 0; status_byte == MAX32664_ReadStatusByteValue::SUCCESS_STATUS && i < num_samples; i++)
+    {
+        MAX32664_AcquiredSample sample;
+        status_byte = read_sample(sample, bpt);
+        if (status_byte == MAX32664_ReadStatusByteValue::SUCCESS_STATUS && !queue.Push(sample))
+        {
+            dropped++;
+        }
+    }
+
+    driver_mutex.Unlock();
+    last_status = status_byte;
+    return status_byte;
+}
+
+/// @brief Takes the oldest published sample (from a single consumer thread)
+/// @param sample receives the sample
+/// @return false if no sample is waiting
+bool MAX32664_Acquisition::Pop(MAX32664_AcquiredSample &sample)
+{
+    return queue.Pop(sample);
+}
+
+uint8_t MAX32664_Acquisition::read_sample(MAX32664_AcquiredSample &sample, bool bpt)
+{
+    sample.time_ms = millis();
+    sample.bpt = bpt;
+    if (!bpt)
+    {
+#if MAX32664_ENABLE_VARIANT_A
+        return max32664->ReadSample_SensorAndAlgorithm(sample.data);
+#else
+        return MAX32664_ReadStatusByteValue::ERR_UNAVAIL_FUNC;
+#endif
+    }
+
+#if MAX32664_ENABLE_VARIANT_D
+    uint8_t status_byte = max32664->ReadSample_BPTSensorAndAlgorithm(sample.bpt_data);
+#if MAX32664_ENABLE_RAW_OUTPUT
+    if (status_byte == MAX32664_ReadStatusByteValue::ERR_RECORD_MISMATCH)
+    {
+        // The hub was configured for raw data (ConfigureBPT_RawValue())
+        status_byte = max32664->ReadSample_BPTSensor(sample.bpt_data);
+    }
+#endif
+    return status_byte;
+#else
+    return MAX32664_ReadStatusByteValue::ERR_UNAVAIL_FUNC;
+#endif
+}
+
+void MAX32664_Acquisition::run()
+{
+    while (running)
+    {
+        Poll();
+#if defined(ESP32)
+        vTaskDelay(pdMS_TO_TICKS(poll_interval_ms));
+#else
+        std::this_thread::sleep_for(std::chrono::milliseconds(poll_interval_ms));
+#endif
+    }
+}
+
+#if defined(ESP32)
+void MAX32664_Acquisition::task_main(void *parameter)
+{
+    MAX32664_Acquisition *acquisition = (MAX32664_Acquisition *)parameter;
+    acquisition->run();
+    acquisition->task_done = true;
+    vTaskDelete(NULL);
+}
+#endif
+
+#endif
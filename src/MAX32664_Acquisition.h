@@ -0,0 +1,85 @@
+#ifndef __MAX32664_ACQUISITION_H
+#define __MAX32664_ACQUISITION_H
+
+#include <Arduino.h>
+#include "ReWire_MAX32664.h"
+#include "MAX32664_Threading.h"
+
+#if MAX32664_HAS_THREADS
+
+#if !defined(ESP32)
+#include <thread>
+#endif
+
+// Number of samples the acquisition task can publish before the consumer has to catch up (a
+// power of two; one slot is kept free)
+#ifndef MAX32664_ACQUISITION_QUEUE_DEPTH
+#define MAX32664_ACQUISITION_QUEUE_DEPTH 64
+#endif
+
+// Stack size (bytes) and priority of the FreeRTOS acquisition task
+#ifndef MAX32664_ACQUISITION_STACK_SIZE
+#define MAX32664_ACQUISITION_STACK_SIZE 4096
+#endif
+#ifndef MAX32664_ACQUISITION_PRIORITY
+#define MAX32664_ACQUISITION_PRIORITY 5
+#endif
+
+struct MAX32664_AcquiredSample
+{
+    uint32_t time_ms; // millis() when the sample was read
+    bool bpt;         // true: bpt_data is valid (MAX32664D), false: data is valid (MAX32664A)
+    union
+    {
+        MAX32664_Data data;
+        MAX32664_Data_VerD bpt_data;
+    };
+};
+
+/// @brief Reads samples from the hub on a background thread (a FreeRTOS task on ESP32) and
+///     publishes them through a lock-free single-producer single-consumer queue.
+///
+/// While the task runs it owns the driver. Other threads that need to send commands to the hub
+/// must do so between LockDriver() and UnlockDriver().
+class MAX32664_Acquisition
+{
+private:
+    ReWire_MAX32664 *max32664;
+    MAX32664_Mutex driver_mutex;
+    MAX32664_SpscQueue<MAX32664_AcquiredSample, MAX32664_ACQUISITION_QUEUE_DEPTH> queue;
+    std::atomic<uint32_t> dropped;
+    std::atomic<uint8_t> last_status;
+    std::atomic<bool> running;
+    uint32_t poll_interval_ms;
+#if defined(ESP32)
+    TaskHandle_t task;
+    std::atomic<bool> task_done;
+    static void task_main(void *parameter);
+#else
+    std::thread thread;
+#endif
+
+    void run();
+    uint8_t read_sample(MAX32664_AcquiredSample &sample, bool bpt);
+
+public:
+    MAX32664_Acquisition(ReWire_MAX32664 *driver);
+    ~MAX32664_Acquisition();
+
+    bool Start(uint32_t poll_interval = 20);
+    void Stop();
+    bool IsRunning() { return running; }
+    uint8_t Poll();
+
+    bool Pop(MAX32664_AcquiredSample &sample);
+    size_t Available() { return queue.Size(); }
+    uint32_t GetDropped() { return dropped; }
+    uint8_t GetLastStatus() { return last_status; }
+
+    void LockDriver() { driver_mutex.Lock(); }
+    void UnlockDriver() { driver_mutex.Unlock(); }
+};
+
+#endif
+
+#endif /* __MAX32664_ACQUISITION_H */
@@ -0,0 +1,201 @@
+#include "MAX32664_BatchDecode.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define BATCH_DECODE_AVX2
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#define BATCH_DECODE_SSSE3
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define BATCH_DECODE_NEON
+#endif
+
+// Every vector path works the same way, four records at a time per 128 bits:
+//   1. Load each record into its own register. The last record of a group is loaded 4 bytes
+//      early so the loads never read past the end of the group.
+//   2. Byte-shuffle the 24-bit big-endian IR and red values into little-endian 32-bit lanes 0
+//      and 1 (lanes 2 and 3 are cleared).
+//   3. Interleave the four registers into one register of IR values and one of red values.
+//   4. Divide by 10 exactly with a 32x32->64 bit multiply by 0xCCCCCCCD and a shift by 35.
+
+static inline uint32_t decode_24bit(const uint8_t *bytes)
+{
+    return (((uint32_t)bytes[0]) << 16) | (((uint32_t)bytes[1]) << 8) | ((uint32_t)bytes[2]);
+}
+
+void MAX32664_DecodeRawBatch_Scalar(const uint8_t *records, size_t count, uint32_t *ir, uint32_t *red)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const uint8_t *record = records + i * MAX32664_RAW_RECORD_SIZE;
+        ir[i] = decode_24bit(record) / 10;
+        red[i] = decode_24bit(record + 3) / 10;
+    }
+}
+
+#if defined(BATCH_DECODE_AVX2) || defined(BATCH_DECODE_SSSE3)
+
+static inline __m128i shuffle_mask()
+{
+    return _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+}
+
+// For a record loaded 4 bytes early
+static inline __m128i shuffle_mask_offset()
+{
+    return _mm_setr_epi8(6, 5, 4, -1, 9, 8, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+}
+
+static inline __m128i load_record(const uint8_t *record)
+{
+    return _mm_loadu_si128((const __m128i *)record);
+}
+
+#endif
+
+#if defined(BATCH_DECODE_AVX2)
+
+static inline __m256i divide_by_10(__m256i values)
+{
+    const __m256i magic = _mm256_set1_epi32((int)0xCCCCCCCD);
+    __m256i even = _mm256_srli_epi64(_mm256_mul_epu32(values, magic), 35);
+    __m256i odd = _mm256_srli_epi64(_mm256_mul_epu32(_mm256_srli_epi64(values, 32), magic), 35);
+    return _mm256_or_si256(even, _mm256_slli_epi64(odd, 32));
+}
+
+static inline __m256i load_record_pair(const uint8_t *low, const uint8_t *high)
+{
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(load_record(low)), load_record(high), 1);
+}
+
+void MAX32664_DecodeRawBatch(const uint8_t *records, size_t count, uint32_t *ir, uint32_t *red)
+{
+    const __m256i mask = _mm256_broadcastsi128_si256(shuffle_mask());
+    const __m256i mask_last = _mm256_inserti128_si256(mask, shuffle_mask_offset(), 1);
+
+    // Eight records (96 bytes) per iteration: records k and k + 4 share a register
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const uint8_t *p = records + i * MAX32664_RAW_RECORD_SIZE;
+        __m256i s0 = _mm256_shuffle_epi8(load_record_pair(p + 0, p + 48), mask);
+        __m256i s1 = _mm256_shuffle_epi8(load_record_pair(p + 12, p + 60), mask);
+        __m256i s2 = _mm256_shuffle_epi8(load_record_pair(p + 24, p + 72), mask);
+        __m256i s3 = _mm256_shuffle_epi8(load_record_pair(p + 36, p + 80), mask_last);
+
+        __m256 t01 = _mm256_castsi256_ps(_mm256_unpacklo_epi64(s0, s1));
+        __m256 t23 = _mm256_castsi256_ps(_mm256_unpacklo_epi64(s2, s3));
+        __m256i ir_values = _mm256_castps_si256(_mm256_shuffle_ps(t01, t23, _MM_SHUFFLE(2, 0, 2, 0)));
+        __m256i red_values = _mm256_castps_si256(_mm256_shuffle_ps(t01, t23, _MM_SHUFFLE(3, 1, 3, 1)));
+
+        _mm256_storeu_si256((__m256i *)(ir + i), divide_by_10(ir_values));
+        _mm256_storeu_si256((__m256i *)(red + i), divide_by_10(red_values));
+    }
+
+    MAX32664_DecodeRawBatch_Scalar(records + i * MAX32664_RAW_RECORD_SIZE, count - i, ir + i, red + i);
+}
+
+const char *MAX32664_DecodeRawBatch_Implementation()
+{
+    return "avx2";
+}
+
+#elif defined(BATCH_DECODE_SSSE3)
+
+static inline __m128i divide_by_10(__m128i values)
+{
+    const __m128i magic = _mm_set1_epi32((int)0xCCCCCCCD);
+    __m128i even = _mm_srli_epi64(_mm_mul_epu32(values, magic), 35);
+    __m128i odd = _mm_srli_epi64(_mm_mul_epu32(_mm_srli_epi64(values, 32), magic), 35);
+    return _mm_or_si128(even, _mm_slli_epi64(odd, 32));
+}
+
+void MAX32664_DecodeRawBatch(const uint8_t *records, size_t count, uint32_t *ir, uint32_t *red)
+{
+    const __m128i mask = shuffle_mask();
+    const __m128i mask_last = shuffle_mask_offset();
+
+    // Four records (48 bytes) per iteration
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const uint8_t *p = records + i * MAX32664_RAW_RECORD_SIZE;
+        __m128i s0 = _mm_shuffle_epi8(load_record(p + 0), mask);
+        __m128i s1 = _mm_shuffle_epi8(load_record(p + 12), mask);
+        __m128i s2 = _mm_shuffle_epi8(load_record(p + 24), mask);
+        __m128i s3 = _mm_shuffle_epi8(load_record(p + 32), mask_last);
+
+        __m128 t01 = _mm_castsi128_ps(_mm_unpacklo_epi64(s0, s1));
+        __m128 t23 = _mm_castsi128_ps(_mm_unpacklo_epi64(s2, s3));
+        __m128i ir_values = _mm_castps_si128(_mm_shuffle_ps(t01, t23, _MM_SHUFFLE(2, 0, 2, 0)));
+        __m128i red_values = _mm_castps_si128(_mm_shuffle_ps(t01, t23, _MM_SHUFFLE(3, 1, 3, 1)));
+
+        _mm_storeu_si128((__m128i *)(ir + i), divide_by_10(ir_values));
+        _mm_storeu_si128((__m128i *)(red + i), divide_by_10(red_values));
+    }
+
+    MAX32664_DecodeRawBatch_Scalar(records + i * MAX32664_RAW_RECORD_SIZE, count - i, ir + i, red + i);
+}
+
+const char *MAX32664_DecodeRawBatch_Implementation()
+{
+    return "ssse3";
+}
+
+#elif defined(BATCH_DECODE_NEON)
+
+static inline uint32x4_t divide_by_10(uint32x4_t values)
+{
+    const uint32x4_t magic = vdupq_n_u32(0xCCCCCCCD);
+    uint32x2_t low = vmovn_u64(vshrq_n_u64(vmull_u32(vget_low_u32(values), vget_low_u32(magic)), 35));
+    uint32x2_t high = vmovn_u64(vshrq_n_u64(vmull_high_u32(values, magic), 35));
+    return vcombine_u32(low, high);
+}
+
+void MAX32664_DecodeRawBatch(const uint8_t *records, size_t count, uint32_t *ir, uint32_t *red)
+{
+    // Indices outside 0-15 select zero in a table lookup
+    static const uint8_t mask_bytes[16] = {2, 1, 0, 0xFF, 5, 4, 3, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    static const uint8_t mask_last_bytes[16] = {6, 5, 4, 0xFF, 9, 8, 7, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    const uint8x16_t mask = vld1q_u8(mask_bytes);
+    const uint8x16_t mask_last = vld1q_u8(mask_last_bytes);
+
+    // Four records (48 bytes) per iteration
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const uint8_t *p = records + i * MAX32664_RAW_RECORD_SIZE;
+        uint32x4_t s0 = vreinterpretq_u32_u8(vqtbl1q_u8(vld1q_u8(p + 0), mask));
+        uint32x4_t s1 = vreinterpretq_u32_u8(vqtbl1q_u8(vld1q_u8(p + 12), mask));
+        uint32x4_t s2 = vreinterpretq_u32_u8(vqtbl1q_u8(vld1q_u8(p + 24), mask));
+        uint32x4_t s3 = vreinterpretq_u32_u8(vqtbl1q_u8(vld1q_u8(p + 32), mask_last));
+
+        uint32x4_t t01 = vcombine_u32(vget_low_u32(s0), vget_low_u32(s1));
+        uint32x4_t t23 = vcombine_u32(vget_low_u32(s2), vget_low_u32(s3));
+
+        vst1q_u32(ir + i, divide_by_10(vuzp1q_u32(t01, t23)));
+        vst1q_u32(red + i, divide_by_10(vuzp2q_u32(t01, t23)));
+    }
+
+    MAX32664_DecodeRawBatch_Scalar(records + i * MAX32664_RAW_RECORD_SIZE, count - i, ir + i, red + i);
+}
+
+const char *MAX32664_DecodeRawBatch_Implementation()
+{
+    return "neon";
+}
+
+#else
+
+void MAX32664_DecodeRawBatch(const uint8_t *records, size_t count, uint32_t *ir, uint32_t *red)
+{
+    MAX32664_DecodeRawBatch_Scalar(records, count, ir, red);
+}
+
+const char *MAX32664_DecodeRawBatch_Implementation()
+{
+    return "scalar";
+}
+
+#endif
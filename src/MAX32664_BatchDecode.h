@@ -0,0 +1,29 @@
+#ifndef __MAX32664_BATCHDECODE_H
+#define __MAX32664_BATCHDECODE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Size of one output FIFO record in SensorData mode (MAX30101 without accelerometer): four
+// 24-bit big-endian LED channels, IR first and red second.
+#define MAX32664_RAW_RECORD_SIZE 12
+
+/// @brief Decodes packed SensorData records into separate IR and red buffers, with the same
+///     scaling as ReadSample_BPTSensor() (the raw counts divided by 10).
+///
+/// Uses AVX2, SSSE3 or AArch64 NEON when the library is compiled for a target that has them
+/// (e.g. -march=native on a gateway), and a portable loop otherwise.
+/// @param records count records of MAX32664_RAW_RECORD_SIZE bytes each
+/// @param count the number of records
+/// @param ir receives count IR values
+/// @param red receives count red values
+void MAX32664_DecodeRawBatch(const uint8_t *records, size_t count, uint32_t *ir, uint32_t *red);
+
+/// @brief The portable version of MAX32664_DecodeRawBatch(), always available as a reference
+void MAX32664_DecodeRawBatch_Scalar(const uint8_t *records, size_t count, uint32_t *ir, uint32_t *red);
+
+/// @brief Returns the name of the implementation MAX32664_DecodeRawBatch() uses
+///     ("avx2", "ssse3", "neon" or "scalar")
+const char *MAX32664_DecodeRawBatch_Implementation();
+
+#endif /* __MAX32664_BATCHDECODE_H */
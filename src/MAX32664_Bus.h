@@ -0,0 +1,104 @@
+#ifndef __MAX32664_BUS_H
+#define __MAX32664_BUS_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "MAX32664_Threading.h"
+
+/// @brief The transport used by ReWire_MAX32664 to talk to the hub.
+///
+/// Every MAX32664 transaction has the same shape: the host writes a command (family byte,
+/// index byte and optional write bytes), waits for the hub to process it (CMD_DELAY), and then
+/// reads back a status byte followed by the response bytes. A bus implements the two bus phases
+/// and the wait in between, so the driver can be pointed at something other than a TwoWire
+/// instance (a capture file, a replay of one, a simulated hub...).
+class MAX32664_Bus
+{
+public:
+    virtual ~MAX32664_Bus() {}
+
+    /// @brief Writes a command to the hub
+    /// @param i2c_address the I2C address of the hub
+    /// @param command the family byte, index byte and (optionally) the first write byte
+    /// @param command_length the number of bytes in command
+    /// @param payload any additional write bytes (may be NULL)
+    /// @param payload_length the number of bytes in payload
+    /// @return 0 on success, otherwise an endTransmission() style error code
+    virtual uint8_t Write(uint8_t i2c_address, const uint8_t *command, uint8_t command_length, const uint8_t *payload, uint16_t payload_length) = 0;
+
+    /// @brief Reads the response of the last command from the hub
+    /// @param i2c_address the I2C address of the hub
+    /// @param status_byte the status byte sent by the hub
+    /// @param read_buffer the buffer to hold the response bytes
+    /// @param read_length the number of response bytes to read (not counting the status byte)
+    /// @return the number of bytes actually received, including the status byte
+    virtual uint16_t Read(uint8_t i2c_address, uint8_t &status_byte, uint8_t *read_buffer, uint16_t read_length) = 0;
+
+    /// @brief Waits for the hub to finish processing the last command
+    /// @param milliseconds the command delay
+    virtual void Wait(uint16_t milliseconds) { delay(milliseconds); }
+};
+
+/// @brief The default bus: the hub is attached to a TwoWire instance
+class MAX32664_WireBus : public MAX32664_Bus
+{
+private:
+    TwoWire *wire_instance;
+
+public:
+    MAX32664_WireBus(TwoWire *i2c_instance = &Wire);
+
+    void SetWire(TwoWire *i2c_instance);
+    TwoWire *GetWire() { return wire_instance; }
+
+    uint8_t Write(uint8_t i2c_address, const uint8_t *command, uint8_t command_length, const uint8_t *payload, uint16_t payload_length) override;
+    uint16_t Read(uint8_t i2c_address, uint8_t &status_byte, uint8_t *read_buffer, uint16_t read_length) override;
+};
+
+/// @brief Passes everything through to another bus while measuring how much of it there was
+class MAX32664_MeteredBus : public MAX32664_Bus
+{
+private:
+    MAX32664_Bus *inner_bus;
+
+public:
+    uint32_t transactions;  // number of writes
+    uint32_t bytes_written; // bytes written, including the family and index bytes
+    uint32_t bytes_read;    // bytes received, including the status bytes
+    uint32_t bus_us;        // time spent in writes and reads
+    uint32_t wait_ms;       // time spent waiting for the hub to process commands
+
+    MAX32664_MeteredBus(MAX32664_Bus *bus = NULL);
+
+    void SetInnerBus(MAX32664_Bus *bus) { inner_bus = bus; }
+    MAX32664_Bus *GetInnerBus() { return inner_bus; }
+    void Reset();
+
+    uint8_t Write(uint8_t i2c_address, const uint8_t *command, uint8_t command_length, const uint8_t *payload, uint16_t payload_length) override;
+    uint16_t Read(uint8_t i2c_address, uint8_t &status_byte, uint8_t *read_buffer, uint16_t read_length) override;
+    void Wait(uint16_t milliseconds) override;
+};
+
+/// @brief Passes everything through to another bus, holding a mutex only while data is on the wire.
+///
+/// Give every driver on the same physical bus a locked bus with the same mutex. The mutex is taken
+/// for the write and again for the read of each command, and is free while the hub processes the
+/// command, so other devices can use the bus during the MAX32664's command delays.
+class MAX32664_LockedBus : public MAX32664_Bus
+{
+private:
+    MAX32664_Bus *inner_bus;
+    MAX32664_Mutex *bus_mutex;
+
+public:
+    MAX32664_LockedBus(MAX32664_Bus *bus, MAX32664_Mutex *mutex);
+
+    void SetInnerBus(MAX32664_Bus *bus) { inner_bus = bus; }
+    MAX32664_Bus *GetInnerBus() { return inner_bus; }
+
+    uint8_t Write(uint8_t i2c_address, const uint8_t *command, uint8_t command_length, const uint8_t *payload, uint16_t payload_length) override;
+    uint16_t Read(uint8_t i2c_address, uint8_t &status_byte, uint8_t *read_buffer, uint16_t read_length) override;
+    void Wait(uint16_t milliseconds) override;
+};
+
+#endif /* __MAX32664_BUS_H */
@@ -0,0 +1,297 @@
+#include "MAX32664_Calibration.h"
+
+#if MAX32664_ENABLE_BPT_CALIBRATION
+
+// How often the output FIFO is checked while a point is being calibrated
+#define CALIBRATION_POLL_INTERVAL 40
+
+// Value of MAX32664_Data_VerD::progress on the record that completes a point (with bp_status 2)
+#define CALIBRATION_PROGRESS_COMPLETE 100
+
+MAX32664_CalibrationSession::MAX32664_CalibrationSession(ReWire_MAX32664 *driver)
+{
+    max32664 = driver;
+    original_bus = NULL;
+    references = NULL;
+    vectors = NULL;
+    point_count = 0;
+    current_index = 0;
+    state = CalibrationState_Idle;
+    status = MAX32664_ReadStatusByteValue::SUCCESS_STATUS;
+    timeout_ms = 120000;
+    point_start_ms = 0;
+    fresh_record_seen = false;
+    memset(points, 0, sizeof(points));
+    memset(&overhead, 0, sizeof(overhead));
+}
+
+/// @brief Sets how long a single point may take before the session fails
+/// @param point_timeout the timeout per point, in milliseconds (the hub needs about a minute)
+void MAX32664_CalibrationSession::SetTimeout(uint32_t point_timeout)
+{
+    timeout_ms = point_timeout;
+}
+
+/// @brief Prepares a calibration. Nothing is sent to the hub until the first Step(). A session
+///     that is still running is aborted first.
+/// @param point_references the reference values, indexed by cal_index
+/// @param count the number of points, 1 to MAX32664_CALIBRATION_POINTS
+/// @param calibration_vectors receives the vector of each point, count * CALIBVECTOR_SIZE bytes
+///     indexed by cal_index. Store them with the user profile and load them before estimating.
+/// @param first_index the first cal_index to calibrate, to resume an interrupted session
+/// @return ERR_INPUT_VALUE if the arguments are out of range, otherwise SUCCESS_STATUS
+uint8_t MAX32664_CalibrationSession::Begin(const MAX32664_CalibrationReference *point_references, uint8_t count, uint8_t *calibration_vectors, uint8_t first_index)
+{
+    if (count == 0 || count > MAX32664_CALIBRATION_POINTS || first_index >= count)
+    {
+        return MAX32664_ReadStatusByteValue::ERR_INPUT_VALUE;
+    }
+
+    // The driver must have its own bus back before it is metered again
+    Abort();
+
+    references = point_references;
+    vectors = calibration_vectors;
+    point_count = count;
+    current_index = first_index;
+    status = MAX32664_ReadStatusByteValue::SUCCESS_STATUS;
+    memset(points, 0, sizeof(points));
+    memset(&overhead, 0, sizeof(overhead));
+
+    // Meter everything the driver does during the session
+    original_bus = max32664->GetBus();
+    metered_bus.SetInnerBus(original_bus);
+    metered_bus.Reset();
+    max32664->SetBus(&metered_bus);
+
+    state = CalibrationState_Configure;
+    return status;
+}
+
+/// @brief Does the next piece of work of the session. Only the Configure and Arm steps block for
+///     the hub's configuration delays; Collect reads whatever is in the FIFO and returns.
+/// @return the state of the session after the step
+MAX32664_CalibrationState MAX32664_CalibrationSession::Step()
+{
+    switch (state)
+    {
+    case CalibrationState_Configure:
+        configure();
+        break;
+    case CalibrationState_Arm:
+        arm();
+        break;
+    case CalibrationState_Collect:
+        collect();
+        break;
+    case CalibrationState_ReadVector:
+        read_vector();
+        break;
+    default:
+        break;
+    }
+    return state;
+}
+
+/// @brief Runs the whole session, polling the FIFO every CALIBRATION_POLL_INTERVAL milliseconds
+/// @return the status of the session (see GetStatus())
+uint8_t MAX32664_CalibrationSession::Run()
+{
+    while (state != CalibrationState_Done && state != CalibrationState_Failed && state != CalibrationState_Idle)
+    {
+        if (Step() == CalibrationState_Collect)
+        {
+            delay(CALIBRATION_POLL_INTERVAL);
+        }
+    }
+    return status;
+}
+
+/// @brief Stops the session, turning off the AFE and the algorithm. Begin() with the current
+///     cal_index as first_index resumes it.
+void MAX32664_CalibrationSession::Abort()
+{
+    if (state == CalibrationState_Collect || state == CalibrationState_ReadVector)
+    {
+        finish_point();
+    }
+    if (state != CalibrationState_Idle && state != CalibrationState_Done && state != CalibrationState_Failed)
+    {
+        finish(CalibrationState_Failed, MAX32664_ReadStatusByteValue::SUCCESS_STATUS);
+    }
+}
+
+/// @brief Returns what the calibration of a point did and cost
+/// @param cal_index the point
+/// @param result receives the result
+/// @return false if cal_index is out of range
+bool MAX32664_CalibrationSession::GetPointResult(uint8_t cal_index, MAX32664_CalibrationPointResult &result)
+{
+    if (cal_index >= MAX32664_CALIBRATION_POINTS)
+    {
+        return false;
+    }
+    result = points[cal_index];
+    return true;
+}
+
+void MAX32664_CalibrationSession::configure()
+{
+    // Date and time, output mode, FIFO threshold, AGC and AFE: sent once for all points
+    uint32_t start_ms = millis();
+    uint8_t status_byte = max32664->Configure_BPTCalibrationMode();
+    add_overhead(start_ms);
+    if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        finish(CalibrationState_Failed, status_byte);
+        return;
+    }
+    state = CalibrationState_Arm;
+}
+
+void MAX32664_CalibrationSession::arm()
+{
+    metered_bus.Reset();
+    point_start_ms = millis();
+    fresh_record_seen = false;
+
+    MAX32664_CalibrationPointResult &point = points[current_index];
+    memset(&point, 0, sizeof(point));
+
+    const MAX32664_CalibrationReference &reference = references[current_index];
+    point.status_byte = max32664->Start_BPTCalibrationMode(current_index, reference.systolic, reference.diastolic);
+    if (point.status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        finish_point();
+        finish(CalibrationState_Failed, point.status_byte);
+        return;
+    }
+    state = CalibrationState_Collect;
+}
+
+void MAX32664_CalibrationSession::collect()
+{
+    MAX32664_CalibrationPointResult &point = points[current_index];
+
+    uint8_t num_samples = 0;
+    uint8_t status_byte = max32664->ReadNumberAvailableSamples(num_samples);
+
+    // Read one record at a time and stop at the completion record
+    for (uint8_t i = 0; status_byte == MAX32664_ReadStatusByteValue::SUCCESS_STATUS && i < num_samples; i++)
+    {
+        MAX32664_Data_VerD sample;
+        status_byte = max32664->ReadSample_BPTSensorAndAlgorithm(sample);
+        if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+        {
+            break;
+        }
+        if (point.samples_read < 0xFFFF)
+        {
+            point.samples_read++;
+        }
+        point.bp_status = sample.bp_status;
+        point.progress = sample.progress;
+
+        // The FIFO can still hold the completion records of the previous point: only accept a
+        // completion after this point has reported progress below 100 %.
+        if (sample.progress < CALIBRATION_PROGRESS_COMPLETE)
+        {
+            fresh_record_seen = true;
+        }
+
+        if (fresh_record_seen && is_calibration_error(sample.bp_status))
+        {
+            finish_point();
+            finish(CalibrationState_Failed, MAX32664_ReadStatusByteValue::SUCCESS_STATUS);
+            return;
+        }
+
+        if (fresh_record_seen && sample.progress >= CALIBRATION_PROGRESS_COMPLETE && sample.bp_status == MAX32664_BP_STATUS_SUCCESS)
+        {
+            state = CalibrationState_ReadVector;
+            return;
+        }
+    }
+
+    point.status_byte = status_byte;
+    if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        finish_point();
+        finish(CalibrationState_Failed, status_byte);
+    }
+    else if ((uint32_t)(millis() - point_start_ms) >= timeout_ms)
+    {
+        // The user should be asked to restart the calibration of this cal_index
+        finish_point();
+        finish(CalibrationState_Failed, MAX32664_ReadStatusByteValue::SUCCESS_STATUS);
+    }
+}
+
+void MAX32664_CalibrationSession::read_vector()
+{
+    MAX32664_CalibrationPointResult &point = points[current_index];
+    point.status_byte = max32664->readBPTAlgoCalibData(vectors + (uint16_t)current_index * CALIBVECTOR_SIZE);
+    point.complete = (point.status_byte == MAX32664_ReadStatusByteValue::SUCCESS_STATUS);
+    finish_point();
+
+    if (!point.complete)
+    {
+        finish(CalibrationState_Failed, point.status_byte);
+        return;
+    }
+
+    // The AFE keeps streaming: the next point only needs its reference values
+    current_index++;
+    if (current_index >= point_count)
+    {
+        finish(CalibrationState_Done, MAX32664_ReadStatusByteValue::SUCCESS_STATUS);
+        return;
+    }
+    state = CalibrationState_Arm;
+}
+
+/// @brief Records the time and bus traffic of the current point
+void MAX32664_CalibrationSession::finish_point()
+{
+    MAX32664_CalibrationPointResult &point = points[current_index];
+    point.wall_ms = millis() - point_start_ms;
+    point.transactions = metered_bus.transactions;
+    point.bytes = metered_bus.bytes_written + metered_bus.bytes_read;
+    point.bus_us = metered_bus.bus_us;
+    point.wait_ms = metered_bus.wait_ms;
+}
+
+/// @brief Adds the bus traffic since the meter was last reset to the session overhead
+void MAX32664_CalibrationSession::add_overhead(uint32_t start_ms)
+{
+    overhead.wall_ms += millis() - start_ms;
+    overhead.transactions += metered_bus.transactions;
+    overhead.bytes += metered_bus.bytes_written + metered_bus.bytes_read;
+    overhead.bus_us += metered_bus.bus_us;
+    overhead.wait_ms += metered_bus.wait_ms;
+    metered_bus.Reset();
+}
+
+/// @brief Ends the session (steps 4.1 and 4.2) and gives the driver its bus back
+void MAX32664_CalibrationSession::finish(MAX32664_CalibrationState final_state, uint8_t status_byte)
+{
+    // The traffic of the current point is already in its result
+    metered_bus.Reset();
+    uint32_t start_ms = millis();
+    max32664->EnableSensor(false);
+    max32664->EnableBPT_Algorithm(0x00);
+    add_overhead(start_ms);
+    max32664->SetBus(original_bus);
+
+    state = final_state;
+    status = status_byte;
+}
+
+/// @brief Checks for the bp_status values that mean the calibration of the point failed
+bool MAX32664_CalibrationSession::is_calibration_error(uint8_t bp_status)
+{
+    // 7: subject initialization failure, 9 to 15: problems with the calibration references
+    return bp_status == 7 || (bp_status >= 9 && bp_status <= 15);
+}
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef __MAX32664_CALIBRATION_H
+#define __MAX32664_CALIBRATION_H
+
+#include <Arduino.h>
+#include "ReWire_MAX32664.h"
+
+#if MAX32664_ENABLE_BPT_CALIBRATION
+
+enum MAX32664_CalibrationState
+{
+    CalibrationState_Idle = 0x00,       // Begin() has not been called
+    CalibrationState_Configure = 0x01,  // configure the hub and start the AFE (once per session)
+    CalibrationState_Arm = 0x02,        // send the reference values of the next point and enable the algorithm
+    CalibrationState_Collect = 0x03,    // read samples until the point is complete
+    CalibrationState_ReadVector = 0x04, // read the calibration vector of the point
+    CalibrationState_Done = 0x05,       // all points are calibrated, the AFE and the algorithm are off
+    // GetStatus() is the status byte of the failed command. If it is SUCCESS_STATUS, the bp_status of
+    // the point shows why the hub rejected it, or the point timed out.
+    CalibrationState_Failed = 0x06
+};
+
+struct MAX32664_CalibrationReference
+{
+    uint8_t systolic;  // mmHg, from a medically approved device
+    uint8_t diastolic; // mmHg
+};
+
+struct MAX32664_CalibrationPointResult
+{
+    bool complete;         // progress reached 100 % with bp_status 2, and the vector was read
+    uint8_t status_byte;   // status of the last command of the point
+    uint8_t bp_status;     // bp_status of the last record read
+    uint8_t progress;      // progress of the last record read
+    uint32_t wall_ms;      // from arming the point until its vector was read
+    uint16_t samples_read; // records drained from the output FIFO
+    uint32_t transactions; // commands sent
+    uint32_t bytes;        // bytes written and read
+    uint32_t bus_us;       // time spent transferring data on the bus
+    uint32_t wait_ms;      // time spent waiting for the hub to process commands
+};
+
+struct MAX32664_CalibrationCost
+{
+    uint32_t wall_ms;      // time spent configuring the hub and shutting it down
+    uint32_t transactions; // commands sent
+    uint32_t bytes;        // bytes written and read
+    uint32_t bus_us;       // time spent transferring data on the bus
+    uint32_t wait_ms;      // time spent waiting for the hub to process commands
+};
+
+/// @brief Runs a multi-point MAX32664D user calibration (firmware 40.5.0 or later) as a
+///     resumable state machine.
+///
+/// The hub is configured and the AFE is started once. Each point then only sends its reference
+/// values and re-enables the algorithm in calibration mode (steps 1.16 and 1.17 of Table 2 in the
+/// MAX32664D Quick Start Guide), reads records one at a time until the completion record and
+/// reads the calibration vector. Records left over from the previous point are not mistaken for
+/// the completion of the next one.
+class MAX32664_CalibrationSession
+{
+private:
+    ReWire_MAX32664 *max32664;
+    MAX32664_MeteredBus metered_bus;
+    MAX32664_Bus *original_bus;
+    const MAX32664_CalibrationReference *references;
+    uint8_t *vectors;
+    uint8_t point_count;
+    uint8_t current_index;
+    MAX32664_CalibrationState state;
+    uint8_t status;
+    uint32_t timeout_ms;
+    uint32_t point_start_ms;
+    bool fresh_record_seen;
+    MAX32664_CalibrationPointResult points[MAX32664_CALIBRATION_POINTS];
+    MAX32664_CalibrationCost overhead;
+
+    void configure();
+    void arm();
+    void collect();
+    void read_vector();
+    void finish_point();
+    void add_overhead(uint32_t start_ms);
+    void finish(MAX32664_CalibrationState final_state, uint8_t status_byte);
+    bool is_calibration_error(uint8_t bp_status);
+
+public:
+    MAX32664_CalibrationSession(ReWire_MAX32664 *driver);
+
+    void SetTimeout(uint32_t point_timeout);
+    uint8_t Begin(const MAX32664_CalibrationReference *point_references, uint8_t count, uint8_t *calibration_vectors, uint8_t first_index = 0);
+    MAX32664_CalibrationState Step();
+    uint8_t Run();
+    void Abort();
+
+    MAX32664_CalibrationState GetState() { return state; }
+    uint8_t GetStatus() { return status; }
+    uint8_t GetCurrentIndex() { return current_index; }
+    bool GetPointResult(uint8_t cal_index, MAX32664_CalibrationPointResult &result);
+    void GetOverhead(MAX32664_CalibrationCost &cost) { cost = overhead; }
+};
+
+#endif
+
+#endif /* __MAX32664_CALIBRATION_H */
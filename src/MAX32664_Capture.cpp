@@ -0,0 +1,282 @@
+#include "MAX32664_Capture.h"
+#include "ReWire_MAX32664.h"
+
+MAX32664_CaptureBus::MAX32664_CaptureBus(MAX32664_Bus *bus, Print *capture_output)
+{
+    inner_bus = bus;
+    output = capture_output;
+    last_record_us = 0;
+    bytes_captured = 0;
+    output_error = false;
+}
+
+/// @brief Writes the capture file header and starts the capture clock
+void MAX32664_CaptureBus::Begin()
+{
+    uint8_t header[5] = {'M', '3', '2', 'C', MAX32664_CAPTURE_VERSION};
+    bytes_captured = 0;
+    output_error = false;
+    write_bytes(header, 5);
+    last_record_us = micros();
+}
+
+uint8_t MAX32664_CaptureBus::Write(uint8_t i2c_address, const uint8_t *command, uint8_t command_length, const uint8_t *payload, uint16_t payload_length)
+{
+    uint8_t result = inner_bus->Write(i2c_address, command, command_length, payload, payload_length);
+
+    write_record_header(MAX32664_CAPTURE_RECORD_WRITE, 1 + command_length + payload_length);
+    write_bytes(&result, 1);
+    write_bytes(command, command_length);
+    write_bytes(payload, payload_length);
+
+    return result;
+}
+
+uint16_t MAX32664_CaptureBus::Read(uint8_t i2c_address, uint8_t &status_byte, uint8_t *read_buffer, uint16_t read_length)
+{
+    uint16_t received = inner_bus->Read(i2c_address, status_byte, read_buffer, read_length);
+
+    // Only the bytes the hub actually sent are recorded, so short reads replay as short reads.
+    uint16_t data_length = (received > read_length) ? read_length : ((received > 0) ? received - 1 : 0);
+    uint16_t record_length = 2 + ((received > 0) ? 1 + data_length : 0);
+
+    write_record_header(MAX32664_CAPTURE_RECORD_READ, record_length);
+    write_uint16(read_length + 1);
+    if (received > 0)
+    {
+        write_bytes(&status_byte, 1);
+        write_bytes(read_buffer, data_length);
+    }
+
+    return received;
+}
+
+void MAX32664_CaptureBus::Wait(uint16_t milliseconds)
+{
+    write_record_header(MAX32664_CAPTURE_RECORD_WAIT, 2);
+    write_uint16(milliseconds);
+
+    inner_bus->Wait(milliseconds);
+}
+
+void MAX32664_CaptureBus::write_record_header(uint8_t tag, uint16_t length)
+{
+    uint32_t now = micros();
+    uint32_t delta = now - last_record_us;
+    last_record_us = now;
+
+    uint8_t header[7] = {tag,
+                         (uint8_t)(delta & 0xFF), (uint8_t)((delta >> 8) & 0xFF), (uint8_t)((delta >> 16) & 0xFF), (uint8_t)((delta >> 24) & 0xFF),
+                         (uint8_t)(length & 0xFF), (uint8_t)((length >> 8) & 0xFF)};
+    write_bytes(header, 7);
+}
+
+void MAX32664_CaptureBus::write_bytes(const uint8_t *buffer, uint16_t length)
+{
+    if (length == 0)
+    {
+        return;
+    }
+
+    size_t written = output->write(buffer, length);
+    bytes_captured += written;
+    if (written != length)
+    {
+        output_error = true;
+    }
+}
+
+void MAX32664_CaptureBus::write_uint16(uint16_t value)
+{
+    uint8_t buffer[2] = {(uint8_t)(value & 0xFF), (uint8_t)((value >> 8) & 0xFF)};
+    write_bytes(buffer, 2);
+}
+
+MAX32664_ReplayBus::MAX32664_ReplayBus(Stream *capture_input, MAX32664_ReplaySpeed speed)
+{
+    input = capture_input;
+    replay_speed = speed;
+    replay_start_us = 0;
+    recorded_time_us = 0;
+    mismatches = 0;
+    finished = false;
+}
+
+/// @brief Checks the capture file header and starts the replay clock
+/// @return true if the input is a capture file this version can replay
+bool MAX32664_ReplayBus::Begin()
+{
+    uint8_t header[5] = {0};
+    finished = (input->readBytes(header, 5) != 5);
+    if (finished || header[0] != 'M' || header[1] != '3' || header[2] != '2' || header[3] != 'C' || header[4] != MAX32664_CAPTURE_VERSION)
+    {
+        finished = true;
+        return false;
+    }
+
+    mismatches = 0;
+    recorded_time_us = 0;
+    replay_start_us = micros();
+    return true;
+}
+
+uint8_t MAX32664_ReplayBus::Write(uint8_t i2c_address, const uint8_t *command, uint8_t command_length, const uint8_t *payload, uint16_t payload_length)
+{
+    // The address is not recorded, a replay answers on any address
+    (void)i2c_address;
+    uint16_t length;
+    if (!next_record(MAX32664_CAPTURE_RECORD_WRITE, length) || length == 0)
+    {
+        // 4 = "other error" in endTransmission() terms
+        return 4;
+    }
+
+    uint8_t result = read_uint8();
+    uint16_t recorded_length = length - 1;
+    if (recorded_length != command_length + payload_length)
+    {
+        mismatches++;
+        skip(recorded_length);
+        return result;
+    }
+
+    // Compare the recorded command with the one the driver is sending now
+    bool match = true;
+    for (uint16_t i = 0; i < recorded_length; ++i)
+    {
+        uint8_t expected = (i < command_length) ? command[i] : payload[i - command_length];
+        if (read_uint8() != expected)
+        {
+            match = false;
+        }
+    }
+    if (!match)
+    {
+        mismatches++;
+    }
+
+    return result;
+}
+
+uint16_t MAX32664_ReplayBus::Read(uint8_t i2c_address, uint8_t &status_byte, uint8_t *read_buffer, uint16_t read_length)
+{
+    (void)i2c_address;
+    uint16_t length;
+    if (!next_record(MAX32664_CAPTURE_RECORD_READ, length) || length < 2)
+    {
+        status_byte = MAX32664_ReadStatusByteValue::ERR_UNKNOWN;
+        memset(read_buffer, 0xFF, read_length);
+        return 0;
+    }
+
+    uint16_t requested = read_uint16();
+    uint16_t received = length - 2;
+    if (requested != read_length + 1)
+    {
+        mismatches++;
+    }
+
+    // Anything the hub did not send reads back as 0xFF, the same as an exhausted Wire buffer
+    status_byte = (received > 0) ? read_uint8() : (uint8_t)MAX32664_ReadStatusByteValue::ERR_UNKNOWN;
+    for (uint16_t i = 0; i < read_length; ++i)
+    {
+        read_buffer[i] = (i + 1 < received) ? read_uint8() : 0xFF;
+    }
+    if (received > read_length + 1)
+    {
+        skip(received - (read_length + 1));
+    }
+
+    return received;
+}
+
+void MAX32664_ReplayBus::Wait(uint16_t milliseconds)
+{
+    // The recorded delay is applied by the pacing in next_record(), so the record only needs
+    // to be consumed here.
+    (void)milliseconds;
+    uint16_t length;
+    if (next_record(MAX32664_CAPTURE_RECORD_WAIT, length))
+    {
+        skip(length);
+    }
+}
+
+/// @brief Moves to the next record of the given type. Wait records are skipped when looking
+///     for a read or a write, so replays still line up if the caller changed a command delay.
+/// @param expected_tag the type of record the driver is asking for
+/// @param length set to the length of the record's data
+/// @return true if the next record has the expected type
+bool MAX32664_ReplayBus::next_record(uint8_t expected_tag, uint16_t &length)
+{
+    while (!finished)
+    {
+        int tag = input->peek();
+        if (tag < 0)
+        {
+            finished = true;
+            break;
+        }
+        if (tag != expected_tag && !(tag == MAX32664_CAPTURE_RECORD_WAIT && expected_tag != MAX32664_CAPTURE_RECORD_WAIT))
+        {
+            // Leave the record where it is so the replay can recover on the next call
+            mismatches++;
+            return false;
+        }
+
+        input->read();
+        recorded_time_us += read_uint32();
+        length = read_uint16();
+
+        if (replay_speed == ReplayRealTime)
+        {
+            while ((uint32_t)(micros() - replay_start_us) < recorded_time_us)
+            {
+                // Wait until this record is due, letting other tasks run (and the ESP32 task
+                // watchdog be fed) during long gaps
+                yield();
+            }
+        }
+
+        if (tag == expected_tag)
+        {
+            return true;
+        }
+        skip(length);
+    }
+
+    return false;
+}
+
+uint8_t MAX32664_ReplayBus::read_uint8()
+{
+    int value = input->read();
+    if (value < 0)
+    {
+        finished = true;
+        return 0xFF;
+    }
+    return (uint8_t)value;
+}
+
+uint16_t MAX32664_ReplayBus::read_uint16()
+{
+    uint16_t value = read_uint8();
+    value |= ((uint16_t)read_uint8()) << 8;
+    return value;
+}
+
+uint32_t MAX32664_ReplayBus::read_uint32()
+{
+    uint32_t value = read_uint16();
+    value |= ((uint32_t)read_uint16()) << 16;
+    return value;
+}
+
+void MAX32664_ReplayBus::skip(uint16_t length)
+{
+    for (uint16_t i = 0; i < length; ++i)
+    {
+        read_uint8();
+    }
+}
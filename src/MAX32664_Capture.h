@@ -0,0 +1,90 @@
+#ifndef __MAX32664_CAPTURE_H
+#define __MAX32664_CAPTURE_H
+
+#include <Arduino.h>
+#include "MAX32664_Bus.h"
+
+// Capture file format (all multi-byte values are little-endian):
+//
+//   Header:  'M' '3' '2' 'C' <version>
+//   Record:  <tag> <delta_us:uint32> <length:uint16> <data[length]>
+//
+//   delta_us is the time since the previous record (or since the capture started).
+//   'W' write: data = endTransmission result, command bytes, payload bytes
+//   'R' read:  data = requested length (uint16, status byte included), received bytes
+//   'D' wait:  data = command delay in milliseconds (uint16)
+#define MAX32664_CAPTURE_VERSION 1
+#define MAX32664_CAPTURE_RECORD_WRITE 'W'
+#define MAX32664_CAPTURE_RECORD_READ 'R'
+#define MAX32664_CAPTURE_RECORD_WAIT 'D'
+
+enum MAX32664_ReplaySpeed
+{
+    // Honour the recorded timing (command delays and the gaps between transactions)
+    ReplayRealTime = 0x00,
+    // Return every response as soon as it is asked for
+    ReplayMaximumSpeed = 0x01
+};
+
+/// @brief Records every transaction that passes through another bus into a capture file.
+///     Hook it in with ReWire_MAX32664::SetBus() and hand it anything that implements
+///     Print (an SD card File, a Serial port, a RAM buffer...).
+class MAX32664_CaptureBus : public MAX32664_Bus
+{
+private:
+    MAX32664_Bus *inner_bus;
+    Print *output;
+    uint32_t last_record_us;
+    uint32_t bytes_captured;
+    bool output_error;
+
+    void write_record_header(uint8_t tag, uint16_t length);
+    void write_bytes(const uint8_t *buffer, uint16_t length);
+    void write_uint16(uint16_t value);
+
+public:
+    MAX32664_CaptureBus(MAX32664_Bus *bus, Print *capture_output);
+
+    void Begin();
+    uint32_t GetBytesCaptured() { return bytes_captured; }
+    bool HasOutputError() { return output_error; }
+
+    uint8_t Write(uint8_t i2c_address, const uint8_t *command, uint8_t command_length, const uint8_t *payload, uint16_t payload_length) override;
+    uint16_t Read(uint8_t i2c_address, uint8_t &status_byte, uint8_t *read_buffer, uint16_t read_length) override;
+    void Wait(uint16_t milliseconds) override;
+};
+
+/// @brief Feeds a capture file back through the driver in place of the hub.
+///
+/// Writes issued by the driver are compared against the recorded ones; any difference is
+/// counted as a mismatch, which means the code under test no longer issues the same command
+/// sequence as the code that made the capture.
+class MAX32664_ReplayBus : public MAX32664_Bus
+{
+private:
+    Stream *input;
+    MAX32664_ReplaySpeed replay_speed;
+    uint32_t replay_start_us;
+    uint32_t recorded_time_us;
+    uint32_t mismatches;
+    bool finished;
+
+    bool next_record(uint8_t expected_tag, uint16_t &length);
+    uint8_t read_uint8();
+    uint16_t read_uint16();
+    uint32_t read_uint32();
+    void skip(uint16_t length);
+
+public:
+    MAX32664_ReplayBus(Stream *capture_input, MAX32664_ReplaySpeed speed = ReplayMaximumSpeed);
+
+    bool Begin();
+    uint32_t GetMismatches() { return mismatches; }
+    bool IsFinished() { return finished; }
+
+    uint8_t Write(uint8_t i2c_address, const uint8_t *command, uint8_t command_length, const uint8_t *payload, uint16_t payload_length) override;
+    uint16_t Read(uint8_t i2c_address, uint8_t &status_byte, uint8_t *read_buffer, uint16_t read_length) override;
+    void Wait(uint16_t milliseconds) override;
+};
+
+#endif /* __MAX32664_CAPTURE_H */
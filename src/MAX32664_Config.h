@@ -0,0 +1,86 @@
+#ifndef __MAX32664_CONFIG_H
+#define __MAX32664_CONFIG_H
+
+// Compile-time selection of what the driver supports. Every option can be overridden with a
+// compiler flag, e.g. -DMAX32664_ENABLE_VARIANT_D=0 in the build_flags of a PlatformIO project,
+// or with arduino-cli:
+//   --build-property "compiler.cpp.extra_flags=-DMAX32664_ENABLE_VARIANT_D=0"
+// Code that is left out is not compiled at all, so calling it is a compile error rather than a
+// runtime one. extras/footprint/footprint.sh reports the flash and RAM used by each configuration.
+
+// MAX32664A: HR/SpO2 records (ConfigureDevice_SensorAndAlgorithm(), ReadSample_SensorAndAlgorithm()
+// and MAX32664_SpotCheck)
+#ifndef MAX32664_ENABLE_VARIANT_A
+#define MAX32664_ENABLE_VARIANT_A 1
+#endif
+
+// MAX32664D: blood pressure trending records (ConfigureBPT_SensorAndAlgorithm(),
+// ReadSample_BPTSensorAndAlgorithm() and its float decoding)
+#ifndef MAX32664_ENABLE_VARIANT_D
+#define MAX32664_ENABLE_VARIANT_D 1
+#endif
+
+// Raw PPG output of the MAX32664D (ConfigureBPT_RawValue(), ReadSample_BPTSensor() and
+// ReadSamples_BPTSensor())
+#ifndef MAX32664_ENABLE_RAW_OUTPUT
+#define MAX32664_ENABLE_RAW_OUTPUT MAX32664_ENABLE_VARIANT_D
+#endif
+
+// MAX32664D user calibration (Configure_BPTCalibrationMode(), Start_BPTCalibrationMode(),
+// readBPTAlgoCalibData() and MAX32664_CalibrationSession)
+#ifndef MAX32664_ENABLE_BPT_CALIBRATION
+#define MAX32664_ENABLE_BPT_CALIBRATION MAX32664_ENABLE_VARIANT_D
+#endif
+
+// The five sample calibration vectors (2.5 KB of flash, in PROGMEM) that
+// ConfigureBPT_SensorAndAlgorithm() loads when it is not given the vectors of the user. Each one
+// is copied to a 512-byte stack buffer while it is sent. Production builds that always pass their
+// own vectors can leave them out.
+#ifndef MAX32664_ENABLE_SAMPLE_CALIBRATION
+#define MAX32664_ENABLE_SAMPLE_CALIBRATION MAX32664_ENABLE_VARIANT_D
+#endif
+
+// Input FIFO commands (ReadInputFifo*(), WriteInputFifo(), EnableHostAccelerometer()) and
+// MAX32664_InputFeeder, which feeds host-supplied samples to the algorithm
+#ifndef MAX32664_ENABLE_INPUT_FIFO
+#define MAX32664_ENABLE_INPUT_FIFO 1
+#endif
+
+// SetEventCallback() and the events raised while samples are read
+#ifndef MAX32664_ENABLE_EVENTS
+#define MAX32664_ENABLE_EVENTS 1
+#endif
+
+// Set to 1 (e.g. with -DMAX32664_ENABLE_STATS=1) to collect the counters returned by GetStats().
+// When 0, the counters are compiled out and GetStats() always reports zeros.
+#ifndef MAX32664_ENABLE_STATS
+#define MAX32664_ENABLE_STATS 0
+#endif
+
+// Number of transactions kept in the trace buffer (a power of two, e.g. -DMAX32664_TRACE_DEPTH=64).
+// When 0, tracing is compiled out and GetTrace() always returns no records.
+#ifndef MAX32664_TRACE_DEPTH
+#define MAX32664_TRACE_DEPTH 0
+#endif
+
+// Default SpO2 calibration coefficients that ConfigureBPT_SensorAndAlgorithm() loads into the
+// hub and MAX32664_PpgPipeline uses on the host: SpO2 = A * R^2 + B * R + C
+#ifndef MAX32664_SPO2_COEF_A
+#define MAX32664_SPO2_COEF_A 1.5958422f
+#endif
+#ifndef MAX32664_SPO2_COEF_B
+#define MAX32664_SPO2_COEF_B -34.659664f
+#endif
+#ifndef MAX32664_SPO2_COEF_C
+#define MAX32664_SPO2_COEF_C 112.68987f
+#endif
+
+#if !MAX32664_ENABLE_VARIANT_A && !MAX32664_ENABLE_VARIANT_D
+#error "At least one of MAX32664_ENABLE_VARIANT_A and MAX32664_ENABLE_VARIANT_D must be set"
+#endif
+
+#if !MAX32664_ENABLE_VARIANT_D && (MAX32664_ENABLE_RAW_OUTPUT || MAX32664_ENABLE_BPT_CALIBRATION || MAX32664_ENABLE_SAMPLE_CALIBRATION)
+#error "MAX32664_ENABLE_RAW_OUTPUT, MAX32664_ENABLE_BPT_CALIBRATION and MAX32664_ENABLE_SAMPLE_CALIBRATION need MAX32664_ENABLE_VARIANT_D"
+#endif
+
+#endif /* __MAX32664_CONFIG_H */
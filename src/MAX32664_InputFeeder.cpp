@@ -0,0 +1,307 @@
+#include "MAX32664_InputFeeder.h"
+
+#if MAX32664_ENABLE_INPUT_FIFO
+
+// Hub status bits (see ReadSensorHubStatus())
+#define STATUS_FIFO_OUT_OVERFLOW 0x10
+#define STATUS_FIFO_IN_OVERFLOW 0x20
+
+MAX32664_InputFeeder::MAX32664_InputFeeder(ReWire_MAX32664 *driver)
+{
+    max32664 = driver;
+    source = NULL;
+    source_context = NULL;
+    sink = NULL;
+    sink_context = NULL;
+    sample_size = 0;
+    capacity = 0;
+    period_us = 0;
+    owed_us = 0;
+    due = 0;
+    last_us = 0;
+    exhausted = true;
+    staged = 0;
+    pending_head = 0;
+    pending_count = 0;
+    ResetStats();
+}
+
+/// @brief Reads the input FIFO geometry from the hub and starts feeding. The hub must already be
+///     configured: output mode set, host data enabled (e.g. EnableHostAccelerometer()) and the
+///     algorithm running.
+/// @param sample_source supplies the samples, in the format of the input FIFO
+/// @param context passed to sample_source
+/// @param rate_hz the rate at which the algorithm consumes samples (the sample rate of the
+///     sensor); 0 writes as fast as the input FIFO accepts them
+/// @return the status byte of the last command; ERR_RECORD_MISMATCH if the output record size is
+///     not known (hub not identified or output mode not set), ERR_DATA_FORMAT if an input sample
+///     does not fit in MAX32664_INPUT_WRITE_MAX
+uint8_t MAX32664_InputFeeder::Begin(MAX32664_FeederSource sample_source, void *context, uint16_t rate_hz)
+{
+    if (sample_source == NULL)
+    {
+        return MAX32664_ReadStatusByteValue::ERR_INPUT_VALUE;
+    }
+    if (max32664->GetSampleSize() == 0)
+    {
+        return MAX32664_ReadStatusByteValue::ERR_RECORD_MISMATCH;
+    }
+
+    uint8_t status_byte = max32664->ReadInputFifoSampleSize(sample_size);
+    if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        return status_byte;
+    }
+    if (sample_size == 0 || sample_size > MAX32664_INPUT_WRITE_MAX)
+    {
+        return MAX32664_ReadStatusByteValue::ERR_DATA_FORMAT;
+    }
+    status_byte = max32664->ReadInputFifoSize(capacity);
+    if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        return status_byte;
+    }
+
+    // Clear overflow flags left over from before
+    uint8_t hub_status;
+    status_byte = max32664->ReadSensorHubStatus(hub_status);
+    if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        return status_byte;
+    }
+
+    source = sample_source;
+    source_context = context;
+    period_us = (rate_hz > 0) ? 1000000UL / rate_hz : 0;
+    owed_us = 0;
+    due = 1; // the first sample goes out right away
+    last_us = micros();
+    exhausted = false;
+    staged = 0;
+    pending_head = 0;
+    pending_count = 0;
+    ResetStats();
+    return status_byte;
+}
+
+/// @brief Sets the function that receives the output records and their latency
+void MAX32664_InputFeeder::SetSink(MAX32664_FeederSink record_sink, void *context)
+{
+    sink = record_sink;
+    sink_context = context;
+}
+
+/// @brief Checks for FIFO overflows, drains the output FIFO and writes the samples that are due.
+///     Call it more often than the input FIFO takes to run empty at the configured rate.
+/// @return the status byte of the first command that failed, otherwise SUCCESS_STATUS
+uint8_t MAX32664_InputFeeder::Step()
+{
+    uint8_t status_byte = check_status();
+    if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        return status_byte;
+    }
+    status_byte = drain_output();
+    if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        return status_byte;
+    }
+    return feed();
+}
+
+void MAX32664_InputFeeder::GetStats(MAX32664_FeederStats &snapshot)
+{
+    snapshot = stats;
+    if (stats.paired == 0)
+    {
+        snapshot.latency_min_us = 0;
+        snapshot.latency_mean_us = 0;
+    }
+    else
+    {
+        snapshot.latency_mean_us = (float)latency_total_us / stats.paired;
+    }
+}
+
+void MAX32664_InputFeeder::ResetStats()
+{
+    memset(&stats, 0, sizeof(stats));
+    stats.latency_min_us = 0xFFFFFFFFUL;
+    latency_total_us = 0;
+}
+
+uint8_t MAX32664_InputFeeder::check_status()
+{
+    uint8_t hub_status = 0;
+    uint8_t status_byte = max32664->ReadSensorHubStatus(hub_status);
+    if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        return status_byte;
+    }
+
+    stats.fifo_in_overflows += (hub_status & STATUS_FIFO_IN_OVERFLOW) ? 1 : 0;
+    stats.fifo_out_overflows += (hub_status & STATUS_FIFO_OUT_OVERFLOW) ? 1 : 0;
+    if (hub_status & (STATUS_FIFO_IN_OVERFLOW | STATUS_FIFO_OUT_OVERFLOW))
+    {
+        // Samples or records were lost, so the ones in flight no longer line up
+        restart_pairing();
+    }
+    return status_byte;
+}
+
+uint8_t MAX32664_InputFeeder::drain_output()
+{
+    uint8_t record_size = max32664->GetSampleSize();
+    if (record_size == 0)
+    {
+        return MAX32664_ReadStatusByteValue::ERR_RECORD_MISMATCH;
+    }
+
+    uint8_t num_samples = 0;
+    uint8_t status_byte = max32664->ReadNumberAvailableSamples(num_samples);
+    if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        return status_byte;
+    }
+
+    const uint8_t per_read = MAX32664_INPUT_WRITE_MAX / record_size;
+    while (num_samples > 0)
+    {
+        uint8_t count = (num_samples < per_read) ? num_samples : per_read;
+        status_byte = max32664->ReadOutputFifo(records, count * record_size);
+        if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+        {
+            restart_pairing();
+            return status_byte;
+        }
+        uint32_t read_us = micros();
+
+        for (uint8_t i = 0; i < count; i++)
+        {
+            uint32_t latency_us = MAX32664_LATENCY_UNPAIRED;
+            if (pending_count > 0)
+            {
+                latency_us = read_us - pending[pending_head];
+                pending_head = (pending_head + 1) & (MAX32664_FEEDER_PENDING - 1);
+                pending_count--;
+                stats.paired++;
+                latency_total_us += latency_us;
+                stats.latency_min_us = (latency_us < stats.latency_min_us) ? latency_us : stats.latency_min_us;
+                stats.latency_max_us = (latency_us > stats.latency_max_us) ? latency_us : stats.latency_max_us;
+            }
+            else
+            {
+                stats.unpaired++;
+            }
+            stats.records++;
+            if (sink != NULL)
+            {
+                sink(records + i * record_size, record_size, latency_us, sink_context);
+            }
+        }
+        num_samples -= count;
+    }
+    return status_byte;
+}
+
+uint8_t MAX32664_InputFeeder::feed()
+{
+    uint32_t now = micros();
+    if (period_us > 0)
+    {
+        owed_us += now - last_us;
+        due += owed_us / period_us;
+        owed_us %= period_us;
+        // After a stall, do not try to catch up by more than a full input FIFO
+        due = (due > capacity) ? capacity : due;
+    }
+    last_us = now;
+
+    if (exhausted && staged == 0)
+    {
+        return MAX32664_ReadStatusByteValue::SUCCESS_STATUS;
+    }
+
+    uint16_t fill = 0;
+    uint8_t status_byte = max32664->ReadInputFifoCount(fill);
+    if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        return status_byte;
+    }
+    stats.fill = fill;
+    stats.max_fill = (fill > stats.max_fill) ? fill : stats.max_fill;
+
+    // Write what is due, fits in the input FIFO and can still be paired with its record
+    uint32_t allowed = (fill < capacity) ? capacity - fill : 0;
+    uint32_t pending_free = MAX32664_FEEDER_PENDING - pending_count;
+    allowed = (pending_free < allowed) ? pending_free : allowed;
+    if (period_us > 0)
+    {
+        allowed = (due < allowed) ? due : allowed;
+    }
+
+    const uint16_t per_write = MAX32664_INPUT_WRITE_MAX / sample_size;
+    while (allowed > 0)
+    {
+        if (staged == 0)
+        {
+            if (exhausted)
+            {
+                break;
+            }
+            staged = source(samples, (allowed < per_write) ? allowed : per_write, sample_size, source_context);
+            if (staged == 0)
+            {
+                exhausted = true;
+                break;
+            }
+        }
+        if (staged > allowed)
+        {
+            // Left over from a rejected write that no longer fits
+            break;
+        }
+
+        status_byte = max32664->WriteInputFifo(samples, staged * sample_size);
+        stats.writes++;
+        if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+        {
+            stats.write_errors++;
+            return status_byte;
+        }
+        uint32_t written_us = micros();
+        for (uint16_t i = 0; i < staged; i++)
+        {
+            pending[(pending_head + pending_count) & (MAX32664_FEEDER_PENDING - 1)] = written_us;
+            pending_count++;
+        }
+
+        stats.samples_written += staged;
+        allowed -= staged;
+        due -= (period_us > 0) ? staged : 0;
+        staged = 0;
+    }
+    return status_byte;
+}
+
+void MAX32664_InputFeeder::restart_pairing()
+{
+    stats.unpaired += pending_count;
+    pending_head = 0;
+    pending_count = 0;
+}
+
+/// @brief Packs an accelerometer reading into the 6-byte input FIFO format
+/// @param x, y, z acceleration in mg
+/// @param sample receives MAX32664_ACCEL_SAMPLE_SIZE bytes
+void MAX32664_PackAccelSample(int16_t x, int16_t y, int16_t z, uint8_t *sample)
+{
+    sample[0] = (uint16_t)x >> 8;
+    sample[1] = (uint16_t)x & 0xFF;
+    sample[2] = (uint16_t)y >> 8;
+    sample[3] = (uint16_t)y & 0xFF;
+    sample[4] = (uint16_t)z >> 8;
+    sample[5] = (uint16_t)z & 0xFF;
+}
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef __MAX32664_INPUT_FEEDER_H
+#define __MAX32664_INPUT_FEEDER_H
+
+#include <Arduino.h>
+#include "ReWire_MAX32664.h"
+
+#if MAX32664_ENABLE_INPUT_FIFO
+
+// Largest number of sample bytes sent in one WriteInputFifo() transaction. With the two command
+// bytes it must fit in the buffer of the I2C driver. The output FIFO is drained through a buffer
+// of the same size, so it must hold at least one output record.
+#ifndef MAX32664_INPUT_WRITE_MAX
+#define MAX32664_INPUT_WRITE_MAX (MAX32664_I2C_BUFFER_SIZE - 2)
+#endif
+
+// Number of injected samples that can wait for their output record (a power of two). The feeder
+// does not get further ahead of the algorithm than this.
+#ifndef MAX32664_FEEDER_PENDING
+#define MAX32664_FEEDER_PENDING 64
+#endif
+
+#if MAX32664_INPUT_WRITE_MAX < 30
+#error "MAX32664_INPUT_WRITE_MAX must hold an output record (30 bytes)"
+#endif
+
+// Size of a host-supplied accelerometer sample: X, Y and Z as signed 16-bit values, MSB first
+#define MAX32664_ACCEL_SAMPLE_SIZE 6
+
+// Latency passed to the sink for records that could not be paired with an injected sample
+#define MAX32664_LATENCY_UNPAIRED 0xFFFFFFFFUL
+
+/// @brief Supplies the next samples to inject
+/// @param samples where to put them, max_samples * sample_size bytes
+/// @return the number of samples copied; 0 when the data set is exhausted
+typedef uint16_t (*MAX32664_FeederSource)(uint8_t *samples, uint16_t max_samples, uint8_t sample_size, void *context);
+
+/// @brief Receives every record read from the output FIFO
+/// @param latency_us time from writing the paired input sample to reading the record, or
+///     MAX32664_LATENCY_UNPAIRED
+typedef void (*MAX32664_FeederSink)(const uint8_t *record, uint8_t record_size, uint32_t latency_us, void *context);
+
+struct MAX32664_FeederStats
+{
+    uint32_t samples_written;    // samples accepted by the hub
+    uint32_t writes;             // WriteInputFifo() transactions
+    uint32_t write_errors;       // writes the hub rejected (the samples are sent again)
+    uint32_t fifo_in_overflows;  // FifoInOvrInt seen: injected samples were lost
+    uint32_t fifo_out_overflows; // FifoOutOvrInt seen: output records were lost
+    uint16_t fill;               // samples in the input FIFO at the last check
+    uint16_t max_fill;           // highest fill seen
+    uint32_t records;            // records read from the output FIFO
+    uint32_t paired;             // records paired with an injected sample
+    uint32_t unpaired;           // records and samples whose partner was lost
+    uint32_t latency_min_us;
+    uint32_t latency_max_us;
+    float latency_mean_us;
+};
+
+/// @brief Feeds host-supplied samples (e.g. a recorded accelerometer trace) into the input FIFO of
+///     the hub at the rate of the algorithm, and pairs every injected sample with the output
+///     record it produced to measure the end-to-end latency of the algorithm.
+///
+/// Each Step() checks the hub status for FIFO overflows, drains the output FIFO and then writes
+/// as many samples as are due, fit in the input FIFO and fit in MAX32664_INPUT_WRITE_MAX, in as
+/// few transactions as possible. Pairing assumes one output record per injected sample, which
+/// holds when the samples are supplied at the sample rate of the sensor.
+class MAX32664_InputFeeder
+{
+private:
+    ReWire_MAX32664 *max32664;
+    MAX32664_FeederSource source;
+    void *source_context;
+    MAX32664_FeederSink sink;
+    void *sink_context;
+    uint8_t sample_size;
+    uint16_t capacity;
+    uint32_t period_us;
+    uint32_t owed_us;
+    uint32_t due;
+    uint32_t last_us;
+    bool exhausted;
+    uint8_t samples[MAX32664_INPUT_WRITE_MAX];
+    uint16_t staged;
+    uint8_t records[MAX32664_INPUT_WRITE_MAX];
+    uint32_t pending[MAX32664_FEEDER_PENDING];
+    uint16_t pending_head;
+    uint16_t pending_count;
+    uint64_t latency_total_us;
+    MAX32664_FeederStats stats;
+
+    uint8_t check_status();
+    uint8_t drain_output();
+    uint8_t feed();
+    void restart_pairing();
+
+public:
+    MAX32664_InputFeeder(ReWire_MAX32664 *driver);
+
+    uint8_t Begin(MAX32664_FeederSource sample_source, void *context, uint16_t rate_hz);
+    void SetSink(MAX32664_FeederSink record_sink, void *context = NULL);
+    uint8_t Step();
+    bool IsFinished() { return exhausted && staged == 0 && pending_count == 0; }
+
+    uint8_t GetSampleSize() { return sample_size; }
+    uint16_t GetCapacity() { return capacity; }
+    void GetStats(MAX32664_FeederStats &snapshot);
+    void ResetStats();
+};
+
+void MAX32664_PackAccelSample(int16_t x, int16_t y, int16_t z, uint8_t *sample);
+
+#endif
+
+#endif /* __MAX32664_INPUT_FEEDER_H */
@@ -0,0 +1,298 @@
+#include "MAX32664_PpgBank.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define PPG_LANES_AVX
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define PPG_LANES_SSE2
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PPG_LANES_NEON
+#endif
+
+#if MAX32664_PPG_BANK_ROW != 8
+#error "The vector paths of MAX32664_PpgFilterLanes() assume rows of 8 samples"
+#endif
+
+// Every path computes, for each sample of a row, the same steps as
+// MAX32664_PpgPipeline::filter_chunk(), with separate multiplies and adds:
+//   dc = dc + (x - dc) * k
+//   ac = x - dc
+//   y  = (ac - x2) * b0 - y1 * a1 - y2 * a2
+// The rows are independent in the lane direction, so a row is one AVX register or two 128-bit
+// registers, and the state stays in registers for the whole call.
+
+void MAX32664_PpgFilterLanes_Scalar(const uint32_t *raw, uint16_t count, const MAX32664_PpgLaneCoefs &coefs, MAX32664_PpgLaneState &state, float *filtered, float *dc)
+{
+    for (uint16_t n = 0; n < count; ++n)
+    {
+        for (uint8_t i = 0; i < MAX32664_PPG_BANK_ROW; ++i)
+        {
+            float x = (float)raw[i];
+            state.dc[i] = state.dc[i] + (x - state.dc[i]) * coefs.dc;
+            float ac = x - state.dc[i];
+            float y = (ac - state.x2[i]) * coefs.b0 - state.y1[i] * coefs.a1 - state.y2[i] * coefs.a2;
+            state.x2[i] = state.x1[i];
+            state.x1[i] = ac;
+            state.y2[i] = state.y1[i];
+            state.y1[i] = y;
+
+            filtered[i] = y;
+            dc[i] = state.dc[i];
+        }
+        raw += MAX32664_PPG_BANK_ROW;
+        filtered += MAX32664_PPG_BANK_ROW;
+        dc += MAX32664_PPG_BANK_ROW;
+    }
+}
+
+#if defined(PPG_LANES_AVX)
+
+void MAX32664_PpgFilterLanes(const uint32_t *raw, uint16_t count, const MAX32664_PpgLaneCoefs &coefs, MAX32664_PpgLaneState &state, float *filtered, float *dc)
+{
+    const __m256 k = _mm256_set1_ps(coefs.dc);
+    const __m256 b0 = _mm256_set1_ps(coefs.b0);
+    const __m256 a1 = _mm256_set1_ps(coefs.a1);
+    const __m256 a2 = _mm256_set1_ps(coefs.a2);
+    __m256 dc_v = _mm256_loadu_ps(state.dc);
+    __m256 x1 = _mm256_loadu_ps(state.x1);
+    __m256 x2 = _mm256_loadu_ps(state.x2);
+    __m256 y1 = _mm256_loadu_ps(state.y1);
+    __m256 y2 = _mm256_loadu_ps(state.y2);
+
+    for (uint16_t n = 0; n < count; ++n)
+    {
+        __m256 x = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i *)(raw + n * MAX32664_PPG_BANK_ROW)));
+        dc_v = _mm256_add_ps(dc_v, _mm256_mul_ps(_mm256_sub_ps(x, dc_v), k));
+        __m256 ac = _mm256_sub_ps(x, dc_v);
+        __m256 y = _mm256_sub_ps(_mm256_sub_ps(_mm256_mul_ps(_mm256_sub_ps(ac, x2), b0), _mm256_mul_ps(y1, a1)), _mm256_mul_ps(y2, a2));
+        x2 = x1;
+        x1 = ac;
+        y2 = y1;
+        y1 = y;
+
+        _mm256_storeu_ps(filtered + n * MAX32664_PPG_BANK_ROW, y);
+        _mm256_storeu_ps(dc + n * MAX32664_PPG_BANK_ROW, dc_v);
+    }
+
+    _mm256_storeu_ps(state.dc, dc_v);
+    _mm256_storeu_ps(state.x1, x1);
+    _mm256_storeu_ps(state.x2, x2);
+    _mm256_storeu_ps(state.y1, y1);
+    _mm256_storeu_ps(state.y2, y2);
+}
+
+const char *MAX32664_PpgFilterLanes_Implementation()
+{
+    return "avx";
+}
+
+#elif defined(PPG_LANES_SSE2)
+
+void MAX32664_PpgFilterLanes(const uint32_t *raw, uint16_t count, const MAX32664_PpgLaneCoefs &coefs, MAX32664_PpgLaneState &state, float *filtered, float *dc)
+{
+    const __m128 k = _mm_set1_ps(coefs.dc);
+    const __m128 b0 = _mm_set1_ps(coefs.b0);
+    const __m128 a1 = _mm_set1_ps(coefs.a1);
+    const __m128 a2 = _mm_set1_ps(coefs.a2);
+
+    // Two registers per row: the IR lanes (0) and the red lanes (1)
+    __m128 dc_v[2], x1[2], x2[2], y1[2], y2[2];
+    for (uint8_t h = 0; h < 2; ++h)
+    {
+        dc_v[h] = _mm_loadu_ps(state.dc + 4 * h);
+        x1[h] = _mm_loadu_ps(state.x1 + 4 * h);
+        x2[h] = _mm_loadu_ps(state.x2 + 4 * h);
+        y1[h] = _mm_loadu_ps(state.y1 + 4 * h);
+        y2[h] = _mm_loadu_ps(state.y2 + 4 * h);
+    }
+
+    for (uint16_t n = 0; n < count; ++n)
+    {
+        for (uint8_t h = 0; h < 2; ++h)
+        {
+            uint32_t offset = n * MAX32664_PPG_BANK_ROW + 4 * h;
+            __m128 x = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(raw + offset)));
+            dc_v[h] = _mm_add_ps(dc_v[h], _mm_mul_ps(_mm_sub_ps(x, dc_v[h]), k));
+            __m128 ac = _mm_sub_ps(x, dc_v[h]);
+            __m128 y = _mm_sub_ps(_mm_sub_ps(_mm_mul_ps(_mm_sub_ps(ac, x2[h]), b0), _mm_mul_ps(y1[h], a1)), _mm_mul_ps(y2[h], a2));
+            x2[h] = x1[h];
+            x1[h] = ac;
+            y2[h] = y1[h];
+            y1[h] = y;
+
+            _mm_storeu_ps(filtered + offset, y);
+            _mm_storeu_ps(dc + offset, dc_v[h]);
+        }
+    }
+
+    for (uint8_t h = 0; h < 2; ++h)
+    {
+        _mm_storeu_ps(state.dc + 4 * h, dc_v[h]);
+        _mm_storeu_ps(state.x1 + 4 * h, x1[h]);
+        _mm_storeu_ps(state.x2 + 4 * h, x2[h]);
+        _mm_storeu_ps(state.y1 + 4 * h, y1[h]);
+        _mm_storeu_ps(state.y2 + 4 * h, y2[h]);
+    }
+}
+
+const char *MAX32664_PpgFilterLanes_Implementation()
+{
+    return "sse2";
+}
+
+#elif defined(PPG_LANES_NEON)
+
+void MAX32664_PpgFilterLanes(const uint32_t *raw, uint16_t count, const MAX32664_PpgLaneCoefs &coefs, MAX32664_PpgLaneState &state, float *filtered, float *dc)
+{
+    const float32x4_t k = vdupq_n_f32(coefs.dc);
+    const float32x4_t b0 = vdupq_n_f32(coefs.b0);
+    const float32x4_t a1 = vdupq_n_f32(coefs.a1);
+    const float32x4_t a2 = vdupq_n_f32(coefs.a2);
+
+    // Two registers per row: the IR lanes (0) and the red lanes (1)
+    float32x4_t dc_v[2], x1[2], x2[2], y1[2], y2[2];
+    for (uint8_t h = 0; h < 2; ++h)
+    {
+        dc_v[h] = vld1q_f32(state.dc + 4 * h);
+        x1[h] = vld1q_f32(state.x1 + 4 * h);
+        x2[h] = vld1q_f32(state.x2 + 4 * h);
+        y1[h] = vld1q_f32(state.y1 + 4 * h);
+        y2[h] = vld1q_f32(state.y2 + 4 * h);
+    }
+
+    for (uint16_t n = 0; n < count; ++n)
+    {
+        for (uint8_t h = 0; h < 2; ++h)
+        {
+            uint32_t offset = n * MAX32664_PPG_BANK_ROW + 4 * h;
+            float32x4_t x = vcvtq_f32_u32(vld1q_u32(raw + offset));
+            dc_v[h] = vaddq_f32(dc_v[h], vmulq_f32(vsubq_f32(x, dc_v[h]), k));
+            float32x4_t ac = vsubq_f32(x, dc_v[h]);
+            float32x4_t y = vsubq_f32(vsubq_f32(vmulq_f32(vsubq_f32(ac, x2[h]), b0), vmulq_f32(y1[h], a1)), vmulq_f32(y2[h], a2));
+            x2[h] = x1[h];
+            x1[h] = ac;
+            y2[h] = y1[h];
+            y1[h] = y;
+
+            vst1q_f32(filtered + offset, y);
+            vst1q_f32(dc + offset, dc_v[h]);
+        }
+    }
+
+    for (uint8_t h = 0; h < 2; ++h)
+    {
+        vst1q_f32(state.dc + 4 * h, dc_v[h]);
+        vst1q_f32(state.x1 + 4 * h, x1[h]);
+        vst1q_f32(state.x2 + 4 * h, x2[h]);
+        vst1q_f32(state.y1 + 4 * h, y1[h]);
+        vst1q_f32(state.y2 + 4 * h, y2[h]);
+    }
+}
+
+const char *MAX32664_PpgFilterLanes_Implementation()
+{
+    return "neon";
+}
+
+#else
+
+void MAX32664_PpgFilterLanes(const uint32_t *raw, uint16_t count, const MAX32664_PpgLaneCoefs &coefs, MAX32664_PpgLaneState &state, float *filtered, float *dc)
+{
+    MAX32664_PpgFilterLanes_Scalar(raw, count, coefs, state, filtered, dc);
+}
+
+const char *MAX32664_PpgFilterLanes_Implementation()
+{
+    return "scalar";
+}
+
+#endif
+
+MAX32664_PpgPipelineBank::MAX32664_PpgPipelineBank(uint16_t rate)
+{
+    Reset(rate);
+}
+
+void MAX32664_PpgPipelineBank::Reset(uint16_t rate)
+{
+    for (uint8_t lane = 0; lane < MAX32664_PPG_BANK_LANES; ++lane)
+    {
+        pipelines[lane].Reset(rate);
+    }
+}
+
+/// @brief Interleaves a chunk of every lane into rows, filters it with the lane kernel and keeps
+///     the filter state in the pipelines
+void MAX32664_PpgPipelineBank::filter_chunk(const uint32_t *const ir[], const uint32_t *const red[], uint32_t offset, uint16_t count)
+{
+    MAX32664_PpgLaneState state;
+    for (uint8_t lane = 0; lane < MAX32664_PPG_BANK_LANES; ++lane)
+    {
+        MAX32664_PpgPipeline &pipeline = pipelines[lane];
+        const uint32_t *input[2] = {ir[lane] + offset, red[lane] + offset};
+        for (uint8_t c = 0; c < 2; ++c)
+        {
+            uint8_t i = c * MAX32664_PPG_BANK_LANES + lane;
+            for (uint16_t n = 0; n < count; ++n)
+            {
+                raw[n][i] = input[c][n];
+            }
+
+            // Like the pipeline, start the DC tracker at the first sample
+            state.dc[i] = (pipeline.sample_index == 0 && count > 0) ? MAX32664_PpgFloat::from_raw(input[c][0]) : pipeline.dc[c];
+            state.x1[i] = pipeline.bp_x1[c];
+            state.x2[i] = pipeline.bp_x2[c];
+            state.y1[i] = pipeline.bp_y1[c];
+            state.y2[i] = pipeline.bp_y2[c];
+        }
+    }
+
+    // Every lane has the same sample rate, so the same coefficients
+    MAX32664_PpgLaneCoefs coefs = {pipelines[0].dc_coef, pipelines[0].bp_b0, pipelines[0].bp_a1, pipelines[0].bp_a2};
+    MAX32664_PpgFilterLanes(&raw[0][0], count, coefs, state, &filtered[0][0], &chunk_dc[0][0]);
+
+    for (uint8_t lane = 0; lane < MAX32664_PPG_BANK_LANES; ++lane)
+    {
+        MAX32664_PpgPipeline &pipeline = pipelines[lane];
+        for (uint8_t c = 0; c < 2; ++c)
+        {
+            uint8_t i = c * MAX32664_PPG_BANK_LANES + lane;
+            pipeline.dc[c] = state.dc[i];
+            pipeline.bp_x1[c] = state.x1[i];
+            pipeline.bp_x2[c] = state.x2[i];
+            pipeline.bp_y1[c] = state.y1[i];
+            pipeline.bp_y2[c] = state.y2[i];
+        }
+    }
+}
+
+uint32_t MAX32664_PpgPipelineBank::Process(const uint32_t *const ir[], const uint32_t *const red[], uint32_t count, MAX32664_PpgBeat *const beats[], uint16_t max_beats, uint16_t num_beats[])
+{
+    for (uint8_t lane = 0; lane < MAX32664_PPG_BANK_LANES; ++lane)
+    {
+        num_beats[lane] = 0;
+    }
+
+    uint32_t offset = 0;
+    while (count > 0)
+    {
+        uint16_t chunk = (count < MAX32664_PPG_CHUNK_SIZE) ? count : MAX32664_PPG_CHUNK_SIZE;
+        filter_chunk(ir, red, offset, chunk);
+        for (uint8_t lane = 0; lane < MAX32664_PPG_BANK_LANES; ++lane)
+        {
+            num_beats[lane] += pipelines[lane].detect_chunk<MAX32664_PPG_BANK_LANES>(&filtered[0][lane], &chunk_dc[0][lane], chunk,
+                                                                                    beats[lane] + num_beats[lane], max_beats - num_beats[lane]);
+        }
+        offset += chunk;
+        count -= chunk;
+    }
+
+    uint32_t total = 0;
+    for (uint8_t lane = 0; lane < MAX32664_PPG_BANK_LANES; ++lane)
+    {
+        total += num_beats[lane];
+    }
+    return total;
+}
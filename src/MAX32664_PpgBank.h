@@ -0,0 +1,94 @@
+#ifndef __MAX32664_PPGBANK_H
+#define __MAX32664_PPGBANK_H
+
+#include <stdint.h>
+#include "MAX32664_PpgPipeline.h"
+
+// Number of pipelines (patients) a bank filters side by side
+#define MAX32664_PPG_BANK_LANES 4
+
+// Floats per sample row of the lane kernel: IR of every lane, then red of every lane
+#define MAX32664_PPG_BANK_ROW (2 * MAX32664_PPG_BANK_LANES)
+
+/// @brief Filter coefficients of the lane kernel (the same for every lane and channel)
+struct MAX32664_PpgLaneCoefs
+{
+    float dc;
+    float b0;
+    float a1;
+    float a2;
+};
+
+/// @brief Filter state of the lane kernel, one row each (index c * MAX32664_PPG_BANK_LANES + lane)
+struct MAX32664_PpgLaneState
+{
+    float dc[MAX32664_PPG_BANK_ROW];
+    float x1[MAX32664_PPG_BANK_ROW];
+    float x2[MAX32664_PPG_BANK_ROW];
+    float y1[MAX32664_PPG_BANK_ROW];
+    float y2[MAX32664_PPG_BANK_ROW];
+};
+
+/// @brief Runs the DC tracker and band-pass filter of MAX32664_PpgPipeline over count rows of
+///     MAX32664_PPG_BANK_ROW samples, i.e. over both channels of every lane at once.
+///
+/// Uses AVX (one row per register), SSE2 or AArch64 NEON (two registers per row) when the library
+/// is compiled for a target that has them, and a portable loop otherwise.
+/// @param raw count rows of raw samples (below 2^31)
+/// @param count the number of rows
+/// @param coefs the filter coefficients
+/// @param state the filter state, updated in place
+/// @param filtered receives count rows of band-passed samples
+/// @param dc receives count rows of DC levels
+void MAX32664_PpgFilterLanes(const uint32_t *raw, uint16_t count, const MAX32664_PpgLaneCoefs &coefs, MAX32664_PpgLaneState &state, float *filtered, float *dc);
+
+/// @brief The portable version of MAX32664_PpgFilterLanes(), always available as a reference
+void MAX32664_PpgFilterLanes_Scalar(const uint32_t *raw, uint16_t count, const MAX32664_PpgLaneCoefs &coefs, MAX32664_PpgLaneState &state, float *filtered, float *dc);
+
+/// @brief Returns the name of the implementation MAX32664_PpgFilterLanes() uses
+///     ("avx", "sse2", "neon" or "scalar")
+const char *MAX32664_PpgFilterLanes_Implementation();
+
+/// @brief MAX32664_PPG_BANK_LANES floating point pipelines, e.g. one per patient on a gateway,
+///     that process their samples in lockstep.
+///
+/// A single pipeline cannot be vectorised because its filters are recursive, but the pipelines
+/// of a bank are independent, so their filter stage runs as one vector loop over the lanes
+/// (MAX32664_PpgFilterLanes()). The beat detector then runs per lane straight from the
+/// interleaved buffers. Each lane gives the same beats as a MAX32664_PpgPipeline fed the same
+/// samples, up to float rounding.
+class MAX32664_PpgPipelineBank
+{
+private:
+    MAX32664_PpgPipeline pipelines[MAX32664_PPG_BANK_LANES];
+    uint32_t raw[MAX32664_PPG_CHUNK_SIZE][MAX32664_PPG_BANK_ROW];
+    float filtered[MAX32664_PPG_CHUNK_SIZE][MAX32664_PPG_BANK_ROW];
+    float chunk_dc[MAX32664_PPG_CHUNK_SIZE][MAX32664_PPG_BANK_ROW];
+
+    void filter_chunk(const uint32_t *const ir[], const uint32_t *const red[], uint32_t offset, uint16_t count);
+
+public:
+    MAX32664_PpgPipelineBank(uint16_t rate = 100);
+
+    /// @brief Clears every pipeline and sets them up for a sample rate
+    void Reset(uint16_t rate);
+
+    /// @brief Returns the pipeline of a lane, e.g. to set its SpO2 coefficients. The filter state
+    ///     lives in the pipeline, so a lane can also be taken out of the bank and continued alone.
+    MAX32664_PpgPipeline &GetPipeline(uint8_t lane) { return pipelines[lane]; }
+
+    /// @brief Returns how many samples after the pulse peak a beat is reported
+    uint16_t GetLatency() { return pipelines[0].GetLatency(); }
+
+    /// @brief Runs count samples of every lane through its pipeline
+    /// @param ir the IR samples of each lane
+    /// @param red the red samples of each lane
+    /// @param count the number of samples per lane
+    /// @param beats the buffer of each lane for the beats found in this batch
+    /// @param max_beats the number of beats each buffer can hold (any further beats are dropped)
+    /// @param num_beats receives the number of beats written to each buffer
+    /// @return the number of beats written in all lanes
+    uint32_t Process(const uint32_t *const ir[], const uint32_t *const red[], uint32_t count, MAX32664_PpgBeat *const beats[], uint16_t max_beats, uint16_t num_beats[]);
+};
+
+#endif /* __MAX32664_PPGBANK_H */
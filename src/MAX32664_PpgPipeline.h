@@ -0,0 +1,394 @@
+#ifndef __MAX32664_PPGPIPELINE_H
+#define __MAX32664_PPGPIPELINE_H
+
+#include <stdint.h>
+#include <math.h>
+#include "MAX32664_Config.h"
+
+// Number of samples the pipeline filters at a time before looking for beats
+#define MAX32664_PPG_CHUNK_SIZE 32
+
+// Number of interbeat intervals averaged into the heart rate
+#define MAX32664_PPG_HR_AVERAGE 4
+
+/// @brief Arithmetic for the floating point pipeline (for hosts and MCUs with an FPU)
+struct MAX32664_PpgFloat
+{
+    typedef float sample_t;
+    typedef float coef_t;
+
+    static sample_t from_raw(uint32_t raw) { return (sample_t)raw; }
+    static coef_t coef(float value) { return value; }
+    static sample_t mul(sample_t sample, coef_t coef) { return sample * coef; }
+    static float to_float(sample_t sample) { return sample; }
+};
+
+/// @brief Arithmetic for the fixed point pipeline (for MCUs without an FPU). Samples are Q4
+///     (raw values up to 2^27), coefficients are Q28 (-8 to 8), and products use a 64-bit
+///     intermediate, which is a single instruction on Cortex-M3 and up. Products are rounded to
+///     nearest so the filters are not biased towards -inf.
+struct MAX32664_PpgFixed
+{
+    typedef int32_t sample_t;
+    typedef int32_t coef_t;
+
+    static sample_t from_raw(uint32_t raw) { return (sample_t)(raw << 4); }
+    static coef_t coef(float value) { return (coef_t)lroundf(value * 268435456.0f); }
+    static sample_t mul(sample_t sample, coef_t coef) { return (sample_t)(((int64_t)sample * coef + (1 << 27)) >> 28); }
+    static float to_float(sample_t sample) { return sample / 16.0f; }
+};
+
+class MAX32664_PpgPipelineBank;
+
+struct MAX32664_PpgBeat
+{
+    uint32_t sample_index; // position of the beat (the pulse peak) in the input stream
+    uint16_t ibi_ms;       // time since the previous beat, 0 for the first beat
+    float hr;              // average over the last MAX32664_PPG_HR_AVERAGE intervals, 0 until known
+    float spo2;            // 0 if the pulse amplitude was too small to compute it
+    float r_value;         // ratio of ratios: (AC red / DC red) / (AC IR / DC IR)
+};
+
+/// @brief Turns raw IR/red samples (ConfigureBPT_RawValue() + ReadSample_BPTSensor()) into
+///     beats with heart rate, SpO2 and interbeat interval.
+///
+/// Each channel goes through a DC tracker and a 0.5 to 4 Hz band-pass filter. Beats are found as
+/// peaks of the inverted IR signal (more blood means less light) above an adaptive threshold,
+/// and are reported exactly GetLatency() samples after the peak. SpO2 comes from the ratio of
+/// ratios of the pulse amplitudes over each beat.
+///
+/// The pipeline never allocates. Samples are processed in chunks: the filter stage runs over a
+/// whole chunk one channel at a time, with the filter state in registers and no branches in the
+/// loop, then the beat detector runs over the filtered chunk. The filters are recursive, so the
+/// loop is serial in time; MAX32664_PpgPipelineBank vectorises it across several pipelines.
+template <typename Math>
+class MAX32664_PpgPipelineT
+{
+    friend class MAX32664_PpgPipelineBank;
+
+public:
+    typedef typename Math::sample_t sample_t;
+    typedef typename Math::coef_t coef_t;
+
+private:
+    enum
+    {
+        IR = 0,
+        RED = 1,
+        CHANNELS = 2
+    };
+
+    // Filter coefficients
+    coef_t dc_coef;
+    coef_t bp_b0;
+    coef_t bp_a1;
+    coef_t bp_a2;
+    coef_t envelope_decay;
+    coef_t threshold_ratio;
+
+    // Filter state, per channel
+    sample_t dc[CHANNELS];
+    sample_t bp_y1[CHANNELS];
+    sample_t bp_y2[CHANNELS];
+    sample_t bp_x1[CHANNELS];
+    sample_t bp_x2[CHANNELS];
+    sample_t filtered[MAX32664_PPG_CHUNK_SIZE][CHANNELS];
+    sample_t chunk_dc[MAX32664_PPG_CHUNK_SIZE][CHANNELS];
+
+    // Beat detector state
+    uint16_t sample_rate;
+    uint16_t lookahead;
+    uint16_t refractory;
+    uint32_t sample_index;
+    sample_t previous_pulse;
+    sample_t envelope;
+    bool has_candidate;
+    sample_t candidate_value;
+    uint32_t candidate_index;
+    bool has_last_beat;
+    uint32_t last_beat_index;
+    sample_t pulse_max[CHANNELS];
+    sample_t pulse_min[CHANNELS];
+    uint16_t ibi_history[MAX32664_PPG_HR_AVERAGE];
+    uint8_t ibi_count;
+    uint8_t ibi_next;
+
+    float spo2_a;
+    float spo2_b;
+    float spo2_c;
+
+    void filter_chunk(const uint32_t *ir, const uint32_t *red, uint16_t count)
+    {
+        const uint32_t *input[CHANNELS] = {ir, red};
+        for (uint8_t c = 0; c < CHANNELS; ++c)
+        {
+            const uint32_t *raw = input[c];
+
+            // The state lives in locals for the whole chunk so it stays in registers
+            sample_t dc_c = dc[c];
+            sample_t x1 = bp_x1[c];
+            sample_t x2 = bp_x2[c];
+            sample_t y1 = bp_y1[c];
+            sample_t y2 = bp_y2[c];
+
+            // Start the DC tracker at the first sample so the filters do not see a step from
+            // zero. The update below then leaves it unchanged for that sample.
+            if (sample_index == 0 && count > 0)
+            {
+                dc_c = Math::from_raw(raw[0]);
+            }
+
+            for (uint16_t n = 0; n < count; ++n)
+            {
+                sample_t x = Math::from_raw(raw[n]);
+
+                // DC tracker (one-pole low-pass, ~1 s time constant)
+                dc_c = dc_c + Math::mul(x - dc_c, dc_coef);
+                sample_t ac = x - dc_c;
+
+                // Band-pass biquad (b1 = 0, b2 = -b0), direct form I
+                sample_t y = Math::mul(ac - x2, bp_b0) - Math::mul(y1, bp_a1) - Math::mul(y2, bp_a2);
+                x2 = x1;
+                x1 = ac;
+                y2 = y1;
+                y1 = y;
+
+                filtered[n][c] = y;
+                chunk_dc[n][c] = dc_c;
+            }
+
+            dc[c] = dc_c;
+            bp_x1[c] = x1;
+            bp_x2[c] = x2;
+            bp_y1[c] = y1;
+            bp_y2[c] = y2;
+        }
+    }
+
+    /// @brief Runs the beat detector over a filtered chunk. Sample n of channel c is at
+    ///     [(n * CHANNELS + c) * Stride] of filtered_samples and dc_samples, so a bank can pass
+    ///     its lane-interleaved buffers without copying them.
+    template <uint8_t Stride>
+    uint16_t detect_chunk(const sample_t *filtered_samples, const sample_t *dc_samples, uint16_t count, MAX32664_PpgBeat *beats, uint16_t max_beats)
+    {
+        uint16_t num_beats = 0;
+        for (uint16_t n = 0; n < count; ++n, ++sample_index)
+        {
+            // Copied to locals, as the buffer might alias the detector state for the compiler
+            sample_t sample[CHANNELS];
+            for (uint8_t c = 0; c < CHANNELS; ++c)
+            {
+                sample[c] = filtered_samples[(n * CHANNELS + c) * Stride];
+            }
+
+            // Track the pulse amplitude of both channels over the current beat
+            for (uint8_t c = 0; c < CHANNELS; ++c)
+            {
+                if (sample[c] > pulse_max[c])
+                {
+                    pulse_max[c] = sample[c];
+                }
+                if (sample[c] < pulse_min[c])
+                {
+                    pulse_min[c] = sample[c];
+                }
+            }
+
+            // The pulse peak is a minimum of the IR light, so look for maxima of the inverse
+            sample_t pulse = -sample[IR];
+            envelope = Math::mul(envelope, envelope_decay);
+            if (pulse > envelope)
+            {
+                envelope = pulse;
+            }
+
+            // A candidate is the highest point of a rise; it becomes a beat once nothing higher
+            // has followed it for the look-ahead time.
+            if ((has_candidate && pulse > candidate_value) || (!has_candidate && pulse > previous_pulse))
+            {
+                has_candidate = true;
+                candidate_value = pulse;
+                candidate_index = sample_index;
+            }
+            previous_pulse = pulse;
+
+            if (has_candidate && sample_index - candidate_index >= lookahead)
+            {
+                bool above_threshold = candidate_value > Math::mul(envelope, threshold_ratio);
+                bool after_refractory = !has_last_beat || candidate_index - last_beat_index >= refractory;
+                if (above_threshold && after_refractory)
+                {
+                    if (num_beats < max_beats)
+                    {
+                        const sample_t *dc_sample = dc_samples + n * CHANNELS * Stride;
+                        make_beat(beats[num_beats++], dc_sample[IR * Stride], dc_sample[RED * Stride]);
+                    }
+                    has_last_beat = true;
+                    last_beat_index = candidate_index;
+                    for (uint8_t c = 0; c < CHANNELS; ++c)
+                    {
+                        pulse_max[c] = sample[c];
+                        pulse_min[c] = sample[c];
+                    }
+                }
+                has_candidate = false;
+            }
+        }
+        return num_beats;
+    }
+
+    void make_beat(MAX32664_PpgBeat &beat, sample_t beat_dc_ir, sample_t beat_dc_red)
+    {
+        beat.sample_index = candidate_index;
+        beat.ibi_ms = 0;
+        beat.hr = 0;
+        beat.spo2 = 0;
+        beat.r_value = 0;
+
+        if (has_last_beat)
+        {
+            beat.ibi_ms = (uint16_t)(((candidate_index - last_beat_index) * 1000UL) / sample_rate);
+            ibi_history[ibi_next] = beat.ibi_ms;
+            ibi_next = (ibi_next + 1) % MAX32664_PPG_HR_AVERAGE;
+            if (ibi_count < MAX32664_PPG_HR_AVERAGE)
+            {
+                ibi_count++;
+            }
+
+            uint32_t ibi_sum = 0;
+            for (uint8_t i = 0; i < ibi_count; ++i)
+            {
+                ibi_sum += ibi_history[i];
+            }
+            beat.hr = (60000.0f * ibi_count) / ibi_sum;
+        }
+
+        // Ratio of ratios (the per-beat part of the pipeline is in floating point in both variants)
+        float ac_ir = Math::to_float(pulse_max[IR] - pulse_min[IR]);
+        float ac_red = Math::to_float(pulse_max[RED] - pulse_min[RED]);
+        float dc_ir = Math::to_float(beat_dc_ir);
+        float dc_red = Math::to_float(beat_dc_red);
+        if (ac_ir > 0 && ac_red > 0 && dc_ir > 0 && dc_red > 0)
+        {
+            float r = (ac_red / dc_red) / (ac_ir / dc_ir);
+            float spo2 = spo2_a * r * r + spo2_b * r + spo2_c;
+            beat.r_value = r;
+            beat.spo2 = (spo2 < 0) ? 0 : ((spo2 > 100) ? 100 : spo2);
+        }
+    }
+
+public:
+    MAX32664_PpgPipelineT(uint16_t rate = 100)
+    {
+        SetSpo2Coefficients(MAX32664_SPO2_COEF_A, MAX32664_SPO2_COEF_B, MAX32664_SPO2_COEF_C);
+        Reset(rate);
+    }
+
+    /// @brief Clears the pipeline and sets it up for a sample rate
+    /// @param rate the sample rate of the hub, in Hz
+    void Reset(uint16_t rate)
+    {
+        const float pi = 3.14159265f;
+        const float low_cutoff = 0.5f;
+        const float high_cutoff = 4.0f;
+
+        sample_rate = rate;
+        lookahead = rate * 3 / 20;  // 150 ms
+        refractory = rate * 3 / 10; // 300 ms, i.e. up to 200 bpm
+
+        // Band-pass biquad from the RBJ audio EQ cookbook (constant 0 dB peak gain)
+        float center = sqrtf(low_cutoff * high_cutoff);
+        float w0 = 2 * pi * center / rate;
+        float alpha = sinf(w0) / (2 * (center / (high_cutoff - low_cutoff)));
+        float a0 = 1 + alpha;
+        bp_b0 = Math::coef(alpha / a0);
+        bp_a1 = Math::coef(-2 * cosf(w0) / a0);
+        bp_a2 = Math::coef((1 - alpha) / a0);
+
+        dc_coef = Math::coef(1.0f / rate);
+        envelope_decay = Math::coef(expf(-1.0f / (2.0f * rate)));
+        threshold_ratio = Math::coef(0.4f);
+
+        for (uint8_t c = 0; c < CHANNELS; ++c)
+        {
+            dc[c] = 0;
+            bp_y1[c] = 0;
+            bp_y2[c] = 0;
+            bp_x1[c] = 0;
+            bp_x2[c] = 0;
+            pulse_max[c] = 0;
+            pulse_min[c] = 0;
+        }
+        sample_index = 0;
+        previous_pulse = 0;
+        envelope = 0;
+        has_candidate = false;
+        candidate_value = 0;
+        candidate_index = 0;
+        has_last_beat = false;
+        last_beat_index = 0;
+        ibi_count = 0;
+        ibi_next = 0;
+    }
+
+    /// @brief Sets the SpO2 calibration coefficients (see loadSpo2Coefficients())
+    void SetSpo2Coefficients(float a, float b, float c)
+    {
+        spo2_a = a;
+        spo2_b = b;
+        spo2_c = c;
+    }
+
+    /// @brief Returns how many samples after the pulse peak a beat is reported
+    uint16_t GetLatency() { return lookahead; }
+
+    /// @brief Runs a batch of samples through the pipeline
+    /// @param ir the IR samples
+    /// @param red the red samples
+    /// @param count the number of samples
+    /// @param beats the buffer to hold the beats found in this batch
+    /// @param max_beats the number of beats the buffer can hold (any further beats are dropped)
+    /// @return the number of beats written to beats
+    uint16_t Process(const uint32_t *ir, const uint32_t *red, uint32_t count, MAX32664_PpgBeat *beats, uint16_t max_beats)
+    {
+        uint16_t num_beats = 0;
+        while (count > 0)
+        {
+            uint16_t chunk = (count < MAX32664_PPG_CHUNK_SIZE) ? count : MAX32664_PPG_CHUNK_SIZE;
+            filter_chunk(ir, red, chunk);
+            num_beats += detect_chunk<1>(&filtered[0][0], &chunk_dc[0][0], chunk, beats + num_beats, max_beats - num_beats);
+            ir += chunk;
+            red += chunk;
+            count -= chunk;
+        }
+        return num_beats;
+    }
+
+    /// @brief Runs a batch of decoded samples (anything with ir and red members, such as
+    ///     MAX32664_Data_VerD) through the pipeline
+    template <typename Sample>
+    uint16_t Process(const Sample *samples, uint32_t count, MAX32664_PpgBeat *beats, uint16_t max_beats)
+    {
+        uint32_t ir[MAX32664_PPG_CHUNK_SIZE];
+        uint32_t red[MAX32664_PPG_CHUNK_SIZE];
+        uint16_t num_beats = 0;
+        while (count > 0)
+        {
+            uint16_t chunk = (count < MAX32664_PPG_CHUNK_SIZE) ? count : MAX32664_PPG_CHUNK_SIZE;
+            for (uint16_t i = 0; i < chunk; ++i)
+            {
+                ir[i] = samples[i].ir;
+                red[i] = samples[i].red;
+            }
+            num_beats += Process(ir, red, chunk, beats + num_beats, max_beats - num_beats);
+            samples += chunk;
+            count -= chunk;
+        }
+        return num_beats;
+    }
+};
+
+typedef MAX32664_PpgPipelineT<MAX32664_PpgFloat> MAX32664_PpgPipeline;
+typedef MAX32664_PpgPipelineT<MAX32664_PpgFixed> MAX32664_PpgPipelineFixed;
+
+#endif /* __MAX32664_PPGPIPELINE_H */
@@ -0,0 +1,514 @@
+#include "MAX32664_Spool.h"
+#include <string.h>
+
+// Value of a segment count that marks the unused end of a page
+#define SPOOL_COUNT_ERASED 0xFFFF
+
+static void put_uint16(uint8_t *buffer, uint16_t value)
+{
+    buffer[0] = (uint8_t)value;
+    buffer[1] = (uint8_t)(value >> 8);
+}
+
+static void put_uint32(uint8_t *buffer, uint32_t value)
+{
+    buffer[0] = (uint8_t)value;
+    buffer[1] = (uint8_t)(value >> 8);
+    buffer[2] = (uint8_t)(value >> 16);
+    buffer[3] = (uint8_t)(value >> 24);
+}
+
+static uint16_t get_uint16(const uint8_t *buffer)
+{
+    return (uint16_t)(buffer[0] | (buffer[1] << 8));
+}
+
+static uint32_t get_uint32(const uint8_t *buffer)
+{
+    return ((uint32_t)buffer[0]) | ((uint32_t)buffer[1] << 8) | ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
+}
+
+/// @brief CRC-32 (the zlib/Ethernet polynomial), four bits at a time to keep the table small
+/// @param crc 0 to start, or the result of the previous call to continue
+/// @param data the bytes to add
+/// @param length the number of bytes
+/// @return the CRC of everything added so far
+uint32_t MAX32664_Crc32(uint32_t crc, const uint8_t *data, size_t length)
+{
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++)
+    {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+MAX32664_FileSpoolStorage::MAX32664_FileSpoolStorage(FILE *spool_file, uint32_t size, uint32_t count)
+{
+    file = spool_file;
+    page_size = size;
+    page_count = count;
+}
+
+bool MAX32664_FileSpoolStorage::ReadPage(uint32_t page, uint32_t offset, uint8_t *buffer, uint32_t length)
+{
+    if (fseek(file, (long)page * page_size + offset, SEEK_SET) != 0)
+    {
+        return false;
+    }
+
+    // Past the end of the file counts as erased
+    size_t received = fread(buffer, 1, length, file);
+    if (received < length)
+    {
+        if (ferror(file))
+        {
+            clearerr(file);
+            return false;
+        }
+        clearerr(file);
+        memset(buffer + received, 0xFF, length - received);
+    }
+    return true;
+}
+
+bool MAX32664_FileSpoolStorage::WritePage(uint32_t page, const uint8_t *buffer)
+{
+    if (fseek(file, (long)page * page_size, SEEK_SET) != 0)
+    {
+        return false;
+    }
+    return fwrite(buffer, 1, page_size, file) == page_size;
+}
+
+bool MAX32664_FileSpoolStorage::Sync()
+{
+    return fflush(file) == 0;
+}
+
+/// @brief Creates a spooler. Call Begin() before using it.
+/// @param spool_storage where the pages are kept
+/// @param page_buffer RAM for one page (spool_storage->GetPageSize() bytes)
+MAX32664_Spooler::MAX32664_Spooler(MAX32664_SpoolStorage *spool_storage, uint8_t *page_buffer)
+{
+    storage = spool_storage;
+    page = page_buffer;
+    page_size = 0;
+    page_count = 0;
+    head_page_seq = 0;
+    oldest_page_seq = 0;
+    page_fill = 0;
+    next_record = 0;
+    page_dirty = false;
+    page_written = false;
+    ResetStats();
+}
+
+/// @brief Finds the newest page in the storage and continues appending after its last valid
+///     segment. A page or segment that was only partly written before a power loss is dropped.
+/// @return false if the page size is too small or the storage cannot be read
+bool MAX32664_Spooler::Begin()
+{
+    page_size = storage->GetPageSize();
+    page_count = storage->GetPageCount();
+    if (page_count == 0 || page_size < MAX32664_SPOOL_PAGE_HEADER_SIZE + MAX32664_SPOOL_SEGMENT_HEADER_SIZE + 1)
+    {
+        return false;
+    }
+
+    // Pass 1: the newest page. Pass 2: the oldest page that is still part of the ring.
+    bool found = false;
+    uint32_t newest = 0;
+    uint32_t oldest = 0;
+    for (uint8_t pass = 0; pass < 2; pass++)
+    {
+        oldest = newest;
+        for (uint32_t i = 0; i < page_count; i++)
+        {
+            uint8_t header[MAX32664_SPOOL_PAGE_HEADER_SIZE];
+            if (!storage->ReadPage(i, 0, header, sizeof(header)))
+            {
+                stats.storage_errors++;
+                return false;
+            }
+
+            uint32_t page_seq = get_uint32(header + 4);
+            if (get_uint32(header) != MAX32664_SPOOL_MAGIC || page_seq % page_count != i ||
+                get_uint32(header + 12) != MAX32664_Crc32(0, header, 12))
+            {
+                continue;
+            }
+
+            if (pass == 0 && (!found || page_seq > newest))
+            {
+                newest = page_seq;
+                found = true;
+            }
+            else if (pass == 1 && page_seq <= newest && newest - page_seq < page_count && page_seq < oldest)
+            {
+                oldest = page_seq;
+            }
+        }
+    }
+
+    next_record = 0;
+    if (!found)
+    {
+        oldest_page_seq = 0;
+        start_page(0);
+        return true;
+    }
+
+    oldest_page_seq = oldest;
+    head_page_seq = newest;
+    if (!load_head_page())
+    {
+        // The newest page is unreadable: start a fresh one after it. Its records are lost, so
+        // the numbering goes on from the first record of the newest page whose header reads.
+        uint32_t page_seq = newest;
+        while (!read_page_header(page_seq, next_record) && page_seq > oldest)
+        {
+            page_seq--;
+        }
+        start_page(newest + 1);
+    }
+    return true;
+}
+
+/// @brief Appends a batch of records. Records are copied into the page buffer; full pages are
+///     written to the storage as they fill up.
+/// @param type the kind of records (MAX32664_SpoolRecordType or an application value)
+/// @param records count records of record_size bytes each
+/// @param record_size the size of one record
+/// @param count the number of records
+/// @param time_ms the time of the batch, e.g. millis() when the FIFO was drained
+/// @return false if a record does not fit in a page or the storage could not be written
+bool MAX32664_Spooler::Append(uint8_t type, const void *records, uint8_t record_size, uint16_t count, uint32_t time_ms)
+{
+    if (record_size == 0 || MAX32664_SPOOL_PAGE_HEADER_SIZE + MAX32664_SPOOL_SEGMENT_HEADER_SIZE + record_size > page_size)
+    {
+        return false;
+    }
+
+    const uint8_t *source = (const uint8_t *)records;
+    bool success = true;
+    while (count > 0)
+    {
+        uint32_t space = page_size - page_fill;
+        if (space < MAX32664_SPOOL_SEGMENT_HEADER_SIZE + record_size)
+        {
+            success &= next_page();
+            continue;
+        }
+
+        uint32_t fit = (space - MAX32664_SPOOL_SEGMENT_HEADER_SIZE) / record_size;
+        uint16_t segment_count = (fit < count) ? (uint16_t)fit : count;
+        if (segment_count == SPOOL_COUNT_ERASED)
+        {
+            segment_count--;
+        }
+        uint32_t length = (uint32_t)segment_count * record_size;
+
+        uint8_t *segment = page + page_fill;
+        put_uint16(segment, segment_count);
+        segment[2] = type;
+        segment[3] = record_size;
+        put_uint32(segment + 4, time_ms);
+        put_uint32(segment + 8, next_record);
+        memcpy(segment + MAX32664_SPOOL_SEGMENT_HEADER_SIZE, source, length);
+        put_uint32(segment + 12, MAX32664_Crc32(MAX32664_Crc32(0, segment, 12), segment + MAX32664_SPOOL_SEGMENT_HEADER_SIZE, length));
+
+        page_fill += MAX32664_SPOOL_SEGMENT_HEADER_SIZE + length;
+        page_dirty = true;
+        next_record += segment_count;
+        stats.records += segment_count;
+        stats.bytes_appended += length;
+        source += length;
+        count -= segment_count;
+    }
+
+    // Write the page as soon as another record of this size would not fit
+    if (page_size - page_fill < MAX32664_SPOOL_SEGMENT_HEADER_SIZE + record_size)
+    {
+        success &= next_page();
+    }
+    return success;
+}
+
+/// @brief Writes the page buffer if it holds records that are not in the storage yet, and syncs
+///     the storage. Call this before the device sleeps or loses power.
+/// @return false if the storage could not be written
+bool MAX32664_Spooler::Flush()
+{
+    bool success = true;
+    if (page_dirty)
+    {
+        success = write_page();
+    }
+    if (!storage->Sync())
+    {
+        stats.storage_errors++;
+        success = false;
+    }
+    stats.flushes++;
+    return success;
+}
+
+/// @brief Calls a function for every stored batch that holds records in a range, oldest first.
+///     Batches that are only partly in the range are trimmed. Pending records are flushed first.
+/// @param first_record the first record to replay (GetFirstRecord() for everything)
+/// @param last_record the last record to replay (GetNextRecord() - 1 for everything)
+/// @param callback called for each batch
+/// @param context passed unchanged to the callback
+/// @return the number of records replayed
+uint32_t MAX32664_Spooler::Replay(uint32_t first_record, uint32_t last_record, MAX32664_SpoolCallback callback, void *context)
+{
+    if (first_record > last_record || first_record >= next_record)
+    {
+        return 0;
+    }
+    Flush();
+
+    // The page buffer is free now: use it to read the pages in the range
+    uint32_t replayed = 0;
+    for (uint32_t page_seq = find_page(first_record); page_seq <= head_page_seq; page_seq++)
+    {
+        if (!load_page(page_seq))
+        {
+            continue;
+        }
+
+        uint32_t end_offset;
+        uint32_t end_record;
+        replayed += walk_segments(callback, context, first_record, last_record, end_offset, end_record);
+        if (end_record > last_record)
+        {
+            break;
+        }
+    }
+
+    // Put the page that is being appended to back into the buffer
+    if (!page_written || !load_head_page())
+    {
+        start_page(head_page_seq);
+    }
+    return replayed;
+}
+
+/// @brief Returns the number of the oldest record still in the storage or the page buffer
+uint32_t MAX32664_Spooler::GetFirstRecord()
+{
+    for (uint32_t page_seq = oldest_page_seq; page_seq < head_page_seq; page_seq++)
+    {
+        uint32_t first_record;
+        if (read_page_header(page_seq, first_record))
+        {
+            return first_record;
+        }
+    }
+    return get_uint32(page + 8);
+}
+
+void MAX32664_Spooler::ResetStats()
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+/// @brief Empties the page buffer and prepares the header of a new page
+void MAX32664_Spooler::start_page(uint32_t page_seq)
+{
+    memset(page, 0xFF, page_size);
+    put_uint32(page, MAX32664_SPOOL_MAGIC);
+    put_uint32(page + 4, page_seq);
+    put_uint32(page + 8, next_record);
+    put_uint32(page + 12, MAX32664_Crc32(0, page, 12));
+
+    head_page_seq = page_seq;
+    page_fill = MAX32664_SPOOL_PAGE_HEADER_SIZE;
+    page_dirty = false;
+    page_written = false;
+}
+
+bool MAX32664_Spooler::write_page()
+{
+    if (!storage->WritePage(head_page_seq % page_count, page))
+    {
+        stats.storage_errors++;
+        return false;
+    }
+
+    stats.bytes_written += page_size;
+    stats.pages_written++;
+    if (page_written)
+    {
+        stats.page_rewrites++;
+    }
+    page_written = true;
+    page_dirty = false;
+    return true;
+}
+
+/// @brief Writes the current page and moves on to the next one, dropping the oldest page if the
+///     ring is full
+bool MAX32664_Spooler::next_page()
+{
+    bool success = true;
+    if (page_dirty)
+    {
+        success = write_page();
+    }
+
+    start_page(head_page_seq + 1);
+    if (head_page_seq - oldest_page_seq >= page_count)
+    {
+        oldest_page_seq = head_page_seq - page_count + 1;
+        stats.pages_dropped++;
+    }
+    return success;
+}
+
+bool MAX32664_Spooler::read_page_header(uint32_t page_seq, uint32_t &first_record)
+{
+    uint8_t header[MAX32664_SPOOL_PAGE_HEADER_SIZE];
+    if (!storage->ReadPage(page_seq % page_count, 0, header, sizeof(header)))
+    {
+        stats.storage_errors++;
+        return false;
+    }
+    if (get_uint32(header) != MAX32664_SPOOL_MAGIC || get_uint32(header + 4) != page_seq ||
+        get_uint32(header + 12) != MAX32664_Crc32(0, header, 12))
+    {
+        return false;
+    }
+
+    first_record = get_uint32(header + 8);
+    return true;
+}
+
+/// @brief Reads a whole page into the page buffer and checks its header
+bool MAX32664_Spooler::load_page(uint32_t page_seq)
+{
+    if (!storage->ReadPage(page_seq % page_count, 0, page, page_size))
+    {
+        stats.storage_errors++;
+        return false;
+    }
+    if (get_uint32(page) != MAX32664_SPOOL_MAGIC || get_uint32(page + 4) != page_seq ||
+        get_uint32(page + 12) != MAX32664_Crc32(0, page, 12))
+    {
+        stats.crc_errors++;
+        return false;
+    }
+    return true;
+}
+
+/// @brief Loads the newest page to continue appending to it
+bool MAX32664_Spooler::load_head_page()
+{
+    if (!load_page(head_page_seq))
+    {
+        return false;
+    }
+
+    uint32_t end_offset;
+    uint32_t end_record;
+    walk_segments(NULL, NULL, 0, 0, end_offset, end_record);
+
+    // Anything after the last valid segment (e.g. a torn write) is discarded
+    memset(page + end_offset, 0xFF, page_size - end_offset);
+    page_fill = end_offset;
+    next_record = end_record;
+    page_dirty = false;
+    page_written = true;
+    return true;
+}
+
+/// @brief Walks the valid segments of the page in the page buffer
+/// @param callback called for the records of each segment in [first, last] (may be NULL)
+/// @param end_offset receives the offset after the last valid segment
+/// @param end_record receives the number of the record after the last valid segment
+/// @return the number of records passed to the callback
+uint32_t MAX32664_Spooler::walk_segments(MAX32664_SpoolCallback callback, void *context, uint32_t first, uint32_t last, uint32_t &end_offset, uint32_t &end_record)
+{
+    uint32_t delivered = 0;
+    uint32_t offset = MAX32664_SPOOL_PAGE_HEADER_SIZE;
+    end_record = get_uint32(page + 8);
+
+    while (offset + MAX32664_SPOOL_SEGMENT_HEADER_SIZE <= page_size)
+    {
+        const uint8_t *segment = page + offset;
+        uint16_t count = get_uint16(segment);
+        if (count == SPOOL_COUNT_ERASED)
+        {
+            break;
+        }
+
+        uint8_t record_size = segment[3];
+        uint32_t length = (uint32_t)count * record_size;
+        if (offset + MAX32664_SPOOL_SEGMENT_HEADER_SIZE + length > page_size ||
+            get_uint32(segment + 12) != MAX32664_Crc32(MAX32664_Crc32(0, segment, 12), segment + MAX32664_SPOOL_SEGMENT_HEADER_SIZE, length))
+        {
+            stats.crc_errors++;
+            break;
+        }
+
+        MAX32664_SpoolBatch batch;
+        batch.type = segment[2];
+        batch.record_size = record_size;
+        batch.count = count;
+        batch.time_ms = get_uint32(segment + 4);
+        batch.first_record = get_uint32(segment + 8);
+        end_record = batch.first_record + count;
+        offset += MAX32664_SPOOL_SEGMENT_HEADER_SIZE + length;
+
+        // Trim the batch to [first, last]
+        if (callback == NULL || end_record <= first || batch.first_record > last)
+        {
+            continue;
+        }
+        const uint8_t *records = segment + MAX32664_SPOOL_SEGMENT_HEADER_SIZE;
+        if (batch.first_record < first)
+        {
+            records += (first - batch.first_record) * record_size;
+            batch.count -= (uint16_t)(first - batch.first_record);
+            batch.first_record = first;
+        }
+        if (batch.first_record + batch.count - 1 > last)
+        {
+            batch.count = (uint16_t)(last - batch.first_record + 1);
+        }
+
+        callback(batch, records, context);
+        delivered += batch.count;
+    }
+
+    end_offset = offset;
+    return delivered;
+}
+
+/// @brief Finds the newest page whose first record is not after the given record
+uint32_t MAX32664_Spooler::find_page(uint32_t record)
+{
+    uint32_t low = oldest_page_seq;
+    uint32_t high = head_page_seq;
+    while (low < high)
+    {
+        uint32_t middle = low + (high - low + 1) / 2;
+        uint32_t first_record;
+        if (read_page_header(middle, first_record) && first_record <= record)
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle - 1;
+        }
+    }
+    return low;
+}
@@ -0,0 +1,146 @@
+#ifndef __MAX32664_SPOOL_H
+#define __MAX32664_SPOOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// Spool layout (all multi-byte values are little-endian). The store is a ring of fixed-size
+// pages, written in order and only ever appended to:
+//
+//   Page:     <magic:uint32 'M32S'> <page_seq:uint32> <first_record:uint32> <crc:uint32> <segments...>
+//   Segment:  <count:uint16> <type:uint8> <record_size:uint8> <time_ms:uint32> <first_record:uint32>
+//             <crc:uint32> <records[count * record_size]>
+//
+//   page_seq increases by one for every new page; the page is stored at page_seq % page count.
+//   Records are numbered from 0 in the order they were appended (first_record). The page crc
+//   covers the first 12 bytes of the page header; the segment crc covers the first 12 bytes of
+//   the segment header and its records. Unused space is 0xFF (erased flash).
+#define MAX32664_SPOOL_MAGIC 0x5332334DUL
+#define MAX32664_SPOOL_PAGE_HEADER_SIZE 16u
+#define MAX32664_SPOOL_SEGMENT_HEADER_SIZE 16u
+
+// Suggested values of the segment type, so a reader knows how to decode the records. The spool
+// stores records as given and does not interpret them.
+enum MAX32664_SpoolRecordType
+{
+    SpoolRecord_User = 0x00,
+    SpoolRecord_Sample = 0x01,    // MAX32664_Data
+    SpoolRecord_BptSample = 0x02, // MAX32664_Data_VerD
+    SpoolRecord_RawFifo = 0x03,   // output FIFO records as read from the hub
+    SpoolRecord_Summary = 0x04    // MAX32664_VitalsSummary
+};
+
+/// @brief Where the spool keeps its pages (flash, an SD card, a file...). A page is always written
+///     whole; for NOR flash the backend erases the page before writing it.
+class MAX32664_SpoolStorage
+{
+public:
+    virtual ~MAX32664_SpoolStorage() {}
+
+    virtual uint32_t GetPageSize() = 0;
+    virtual uint32_t GetPageCount() = 0;
+
+    /// @brief Reads part of a page. Bytes that were never written read as 0xFF.
+    /// @return false if the storage could not be read
+    virtual bool ReadPage(uint32_t page, uint32_t offset, uint8_t *buffer, uint32_t length) = 0;
+
+    /// @brief Replaces a whole page
+    /// @return false if the storage could not be written
+    virtual bool WritePage(uint32_t page, const uint8_t *buffer) = 0;
+
+    /// @brief Makes sure written pages survive a power loss
+    virtual bool Sync() { return true; }
+};
+
+/// @brief Keeps the pages in a stdio file, e.g. on a host for benchmarks, or on an ESP32 VFS
+///     partition. The file must be opened for update in binary mode ("r+b" or "w+b").
+class MAX32664_FileSpoolStorage : public MAX32664_SpoolStorage
+{
+private:
+    FILE *file;
+    uint32_t page_size;
+    uint32_t page_count;
+
+public:
+    MAX32664_FileSpoolStorage(FILE *spool_file, uint32_t size, uint32_t count);
+
+    uint32_t GetPageSize() override { return page_size; }
+    uint32_t GetPageCount() override { return page_count; }
+    bool ReadPage(uint32_t page, uint32_t offset, uint8_t *buffer, uint32_t length) override;
+    bool WritePage(uint32_t page, const uint8_t *buffer) override;
+    bool Sync() override;
+};
+
+struct MAX32664_SpoolBatch
+{
+    uint8_t type;          // MAX32664_SpoolRecordType or an application value
+    uint8_t record_size;   // bytes per record
+    uint16_t count;        // records in this batch
+    uint32_t first_record; // number of the first record
+    uint32_t time_ms;      // time given to Append()
+};
+
+typedef void (*MAX32664_SpoolCallback)(const MAX32664_SpoolBatch &batch, const uint8_t *records, void *context);
+
+struct MAX32664_SpoolStats
+{
+    uint32_t records;         // records appended
+    uint32_t bytes_appended;  // record bytes appended
+    uint32_t bytes_written;   // bytes written to the storage
+    uint32_t pages_written;   // page writes, including rewrites
+    uint32_t page_rewrites;   // writes of a page that had already been written (after a Flush())
+    uint32_t pages_dropped;   // pages overwritten because the ring was full
+    uint32_t flushes;
+    uint32_t crc_errors;      // pages or segments skipped during Begin() and Replay()
+    uint32_t storage_errors;  // failed ReadPage()/WritePage() calls
+};
+
+/// @brief Appends batches of samples to a log-structured store while the uplink is down, and
+///     replays any range of them once it is back.
+///
+/// Appends go to a page-sized RAM buffer. Only whole pages are written to the storage: when the
+/// buffer is full, or when Flush() is called. Flushing a partly filled page rewrites it later,
+/// which shows up as write amplification in GetStats(). When the ring is full the oldest page is
+/// overwritten.
+class MAX32664_Spooler
+{
+private:
+    MAX32664_SpoolStorage *storage;
+    uint8_t *page;
+    uint32_t page_size;
+    uint32_t page_count;
+    uint32_t head_page_seq;
+    uint32_t oldest_page_seq;
+    uint32_t page_fill;
+    uint32_t next_record;
+    bool page_dirty;
+    bool page_written;
+    MAX32664_SpoolStats stats;
+
+    void start_page(uint32_t page_seq);
+    bool write_page();
+    bool next_page();
+    bool read_page_header(uint32_t page_seq, uint32_t &first_record);
+    bool load_page(uint32_t page_seq);
+    bool load_head_page();
+    uint32_t walk_segments(MAX32664_SpoolCallback callback, void *context, uint32_t first, uint32_t last, uint32_t &end_offset, uint32_t &end_record);
+    uint32_t find_page(uint32_t record);
+
+public:
+    MAX32664_Spooler(MAX32664_SpoolStorage *spool_storage, uint8_t *page_buffer);
+
+    bool Begin();
+    bool Append(uint8_t type, const void *records, uint8_t record_size, uint16_t count, uint32_t time_ms);
+    bool Flush();
+    uint32_t Replay(uint32_t first_record, uint32_t last_record, MAX32664_SpoolCallback callback, void *context = NULL);
+
+    uint32_t GetFirstRecord();
+    uint32_t GetNextRecord() { return next_record; }
+    void GetStats(MAX32664_SpoolStats &snapshot) { snapshot = stats; }
+    void ResetStats();
+};
+
+uint32_t MAX32664_Crc32(uint32_t crc, const uint8_t *data, size_t length);
+
+#endif /* __MAX32664_SPOOL_H */
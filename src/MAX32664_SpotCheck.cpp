@@ -0,0 +1,189 @@
+#include "MAX32664_SpotCheck.h"
+
+#if MAX32664_ENABLE_VARIANT_A
+
+// How often the output FIFO is checked while waiting for the algorithm to converge
+#define SPOTCHECK_POLL_INTERVAL 40
+
+MAX32664_SpotCheck::MAX32664_SpotCheck(ReWire_MAX32664 *driver, MAX32664_SpotCheckSleep sleep)
+{
+    max32664 = driver;
+    sleep_mode = sleep;
+    min_confidence = 90;
+    timeout_ms = 30000;
+    interval_ms = 60000;
+    last_start_ms = 0;
+    has_measured = false;
+    configured = false;
+}
+
+/// @brief Sets how often IsDue() asks for a measurement
+/// @param interval the time between the start of two measurements, in milliseconds
+void MAX32664_SpotCheck::SetInterval(uint32_t interval)
+{
+    interval_ms = interval;
+}
+
+/// @brief Sets when a sample counts as a valid reading
+/// @param confidence the minimum heart-rate confidence, in %
+/// @param timeout how long to wait for a valid sample before giving up, in milliseconds
+void MAX32664_SpotCheck::SetValidity(uint8_t confidence, uint32_t timeout)
+{
+    min_confidence = confidence;
+    timeout_ms = timeout;
+}
+
+/// @brief Checks whether it is time for the next measurement
+/// @return true if no measurement has been taken yet, or the interval has elapsed
+bool MAX32664_SpotCheck::IsDue()
+{
+    return !has_measured || (uint32_t)(millis() - last_start_ms) >= interval_ms;
+}
+
+/// @brief Wakes the hub, reads samples until the first valid one and puts the hub back to sleep.
+/// @param result the reading and what it cost
+/// @return the status of the measurement (SUCCESS_STATUS does not mean a valid sample was found)
+uint8_t MAX32664_SpotCheck::Measure(MAX32664_SpotCheckResult &result)
+{
+    memset(&result, 0, sizeof(result));
+    last_start_ms = millis();
+    has_measured = true;
+
+    // Meter everything the driver does during this measurement
+    metered_bus.SetInnerBus(max32664->GetBus());
+    metered_bus.Reset();
+    max32664->SetBus(&metered_bus);
+
+    uint32_t start_ms = millis();
+    uint8_t status_byte = wake_up(result);
+    uint32_t settle_start_ms = millis();
+
+    while (status_byte == MAX32664_ReadStatusByteValue::SUCCESS_STATUS && !result.valid && (uint32_t)(millis() - settle_start_ms) < timeout_ms)
+    {
+        uint8_t hub_status;
+        uint8_t num_available_samples = 0;
+        uint8_t read_status = max32664->ReadSensorHubStatus(hub_status);
+        if (read_status == MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+        {
+            read_status = max32664->ReadNumberAvailableSamples(num_available_samples);
+        }
+
+        // Stop at the first valid sample. What is left in the FIFO is lost in shutdown, and is
+        // discarded by the next wake-up in SpotCheckSleep_SensorOff mode.
+        for (uint8_t i = 0; read_status == MAX32664_ReadStatusByteValue::SUCCESS_STATUS && i < num_available_samples; i++)
+        {
+            read_status = max32664->ReadSample_SensorAndAlgorithm(result.sample);
+            result.samples_read++;
+            if (read_status == MAX32664_ReadStatusByteValue::SUCCESS_STATUS && is_valid(result.sample))
+            {
+                result.valid = true;
+                result.settle_ms = millis() - settle_start_ms;
+                break;
+            }
+        }
+
+        if (!result.valid)
+        {
+            delay(SPOTCHECK_POLL_INTERVAL);
+        }
+    }
+
+    uint8_t sleep_status = Sleep();
+    result.awake_ms = millis() - start_ms;
+    result.status_byte = (status_byte == MAX32664_ReadStatusByteValue::SUCCESS_STATUS) ? sleep_status : status_byte;
+
+    max32664->SetBus(metered_bus.GetInnerBus());
+    result.bus_us = metered_bus.bus_us;
+    result.wait_ms = metered_bus.wait_ms;
+    result.transactions = metered_bus.transactions;
+    result.bytes = metered_bus.bytes_written + metered_bus.bytes_read;
+
+    return result.status_byte;
+}
+
+/// @brief Puts the hub to sleep. Measure() does this itself once it is done.
+/// @return the status of the last command
+uint8_t MAX32664_SpotCheck::Sleep()
+{
+    if (sleep_mode == SpotCheckSleep_Shutdown)
+    {
+        // Shutdown disables the hub's RAM, so the next wake-up has to configure it again
+        configured = false;
+        return max32664->SetDeviceOperatingMode(MAX32664_DeviceOperatingMode::Shutdown);
+    }
+
+    uint8_t status_byte = max32664->EnableAlgorithmMode_MaximFast(0x00);
+    if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        return status_byte;
+    }
+    return max32664->EnableSensor(false);
+}
+
+/// @brief Brings the hub back with as few commands as its sleep mode allows
+uint8_t MAX32664_SpotCheck::wake_up(MAX32664_SpotCheckResult &result)
+{
+    uint8_t status_byte;
+
+    if (configured)
+    {
+        // The FIFO survives with the AFE turned off, so it still holds the samples of the last
+        // measurement. Empty it while the AFE is off, so they are not taken for a fresh reading.
+        status_byte = discard_stale_samples(result);
+        if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+        {
+            configured = false;
+            return status_byte;
+        }
+
+        // Output mode, FIFO threshold and AGC survive with the AFE turned off, so the only
+        // commands needed are steps 1.6 and 1.7 of the configuration sequence.
+        status_byte = max32664->EnableSensor(true);
+        if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+        {
+            configured = false;
+            return status_byte;
+        }
+        return max32664->EnableAlgorithmMode_MaximFast(0x01);
+    }
+
+    // Coming out of shutdown (or the first measurement): the hub has to be reset
+    uint8_t device_mode;
+    status_byte = max32664->Restart(device_mode);
+    if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        return status_byte;
+    }
+    if (device_mode != MAX32664_DeviceOperatingMode::ApplicationMode)
+    {
+        return MAX32664_ReadStatusByteValue::ERR_INVALID_MODE;
+    }
+
+    status_byte = max32664->ConfigureDevice_SensorAndAlgorithm();
+    configured = (status_byte == MAX32664_ReadStatusByteValue::SUCCESS_STATUS) && (sleep_mode == SpotCheckSleep_SensorOff);
+    return status_byte;
+}
+
+/// @brief Reads and drops whatever is in the output FIFO
+uint8_t MAX32664_SpotCheck::discard_stale_samples(MAX32664_SpotCheckResult &result)
+{
+    uint8_t num_available_samples = 0;
+    uint8_t status_byte = max32664->ReadNumberAvailableSamples(num_available_samples);
+    for (uint8_t i = 0; status_byte == MAX32664_ReadStatusByteValue::SUCCESS_STATUS && i < num_available_samples; i++)
+    {
+        MAX32664_Data stale;
+        status_byte = max32664->ReadSample_SensorAndAlgorithm(stale);
+        result.samples_stale++;
+    }
+    return status_byte;
+}
+
+bool MAX32664_SpotCheck::is_valid(const MAX32664_Data &sample)
+{
+    return sample.algorithm_state == MAX32664_ALGORITHM_STATE_FINGER_DETECTED &&
+           sample.algorithm_status == MAX32664_ALGORITHM_STATUS_SUCCESS &&
+           sample.hr_confidence >= min_confidence &&
+           sample.spo2 > 0;
+}
+
+#endif
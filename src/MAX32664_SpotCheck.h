@@ -0,0 +1,64 @@
+#ifndef __MAX32664_SPOTCHECK_H
+#define __MAX32664_SPOTCHECK_H
+
+#include <Arduino.h>
+#include "ReWire_MAX32664.h"
+
+#if MAX32664_ENABLE_VARIANT_A
+
+enum MAX32664_SpotCheckSleep
+{
+    // Put the hub into shutdown between measurements (lowest current). The hub loses its
+    // configuration, so every measurement restarts it and configures it again.
+    SpotCheckSleep_Shutdown = 0x00,
+    // Only turn off the AFE and the algorithm. The hub keeps its configuration, so a measurement
+    // only needs to turn them back on.
+    SpotCheckSleep_SensorOff = 0x01
+};
+
+struct MAX32664_SpotCheckResult
+{
+    MAX32664_Data sample; // the first valid sample (or the last sample read, if none was valid)
+    bool valid;
+    uint8_t status_byte;    // status of the last operation
+    uint32_t awake_ms;      // from the start of the wake-up until the hub was put back to sleep
+    uint32_t settle_ms;     // from the end of the wake-up until the valid sample was read
+    uint32_t bus_us;        // time spent transferring data on the bus
+    uint32_t wait_ms;       // time spent waiting for the hub to process commands
+    uint32_t transactions;  // number of commands sent
+    uint32_t bytes;         // bytes written and read
+    uint16_t samples_read;  // samples drained from the output FIFO
+    uint16_t samples_stale; // samples left from the previous measurement, discarded at wake-up
+};
+
+/// @brief Takes occasional HR/SpO2 readings with a MAX32664A, keeping the hub asleep in between.
+class MAX32664_SpotCheck
+{
+private:
+    ReWire_MAX32664 *max32664;
+    MAX32664_MeteredBus metered_bus;
+    MAX32664_SpotCheckSleep sleep_mode;
+    uint8_t min_confidence;
+    uint32_t timeout_ms;
+    uint32_t interval_ms;
+    uint32_t last_start_ms;
+    bool has_measured;
+    bool configured;
+
+    uint8_t wake_up(MAX32664_SpotCheckResult &result);
+    uint8_t discard_stale_samples(MAX32664_SpotCheckResult &result);
+    bool is_valid(const MAX32664_Data &sample);
+
+public:
+    MAX32664_SpotCheck(ReWire_MAX32664 *driver, MAX32664_SpotCheckSleep sleep = SpotCheckSleep_Shutdown);
+
+    void SetInterval(uint32_t interval);
+    void SetValidity(uint8_t confidence, uint32_t timeout);
+    bool IsDue();
+    uint8_t Measure(MAX32664_SpotCheckResult &result);
+    uint8_t Sleep();
+};
+
+#endif
+
+#endif /* __MAX32664_SPOTCHECK_H */
@@ -0,0 +1,64 @@
+#include "MAX32664_Threading.h"
+
+#if defined(ESP32)
+
+MAX32664_Mutex::MAX32664_Mutex()
+{
+    handle = xSemaphoreCreateMutex();
+}
+
+MAX32664_Mutex::~MAX32664_Mutex()
+{
+    vSemaphoreDelete(handle);
+}
+
+void MAX32664_Mutex::Lock()
+{
+    xSemaphoreTake(handle, portMAX_DELAY);
+}
+
+void MAX32664_Mutex::Unlock()
+{
+    xSemaphoreGive(handle);
+}
+
+#elif MAX32664_HAS_THREADS
+
+MAX32664_Mutex::MAX32664_Mutex()
+{
+}
+
+MAX32664_Mutex::~MAX32664_Mutex()
+{
+}
+
+void MAX32664_Mutex::Lock()
+{
+    handle.lock();
+}
+
+void MAX32664_Mutex::Unlock()
+{
+    handle.unlock();
+}
+
+#else
+
+// Single-threaded targets: there is nothing to lock against
+MAX32664_Mutex::MAX32664_Mutex()
+{
+}
+
+MAX32664_Mutex::~MAX32664_Mutex()
+{
+}
+
+void MAX32664_Mutex::Lock()
+{
+}
+
+void MAX32664_Mutex::Unlock()
+{
+}
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef __MAX32664_THREADING_H
+#define __MAX32664_THREADING_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Threads are available on ESP32 (FreeRTOS tasks) and on hosts that build the library without
+// the Arduino core (std::thread, e.g. for tests against a mock bus). Elsewhere the mutex does
+// nothing and MAX32664_Acquisition is not available.
+#if defined(ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#define MAX32664_HAS_THREADS 1
+#elif !defined(ARDUINO)
+#include <mutex>
+#define MAX32664_HAS_THREADS 1
+#else
+#define MAX32664_HAS_THREADS 0
+#endif
+
+#if MAX32664_HAS_THREADS
+#include <atomic>
+#endif
+
+/// @brief A mutex that works the same on FreeRTOS and on the host
+class MAX32664_Mutex
+{
+private:
+#if defined(ESP32)
+    SemaphoreHandle_t handle;
+#elif MAX32664_HAS_THREADS
+    std::mutex handle;
+#endif
+
+public:
+    MAX32664_Mutex();
+    ~MAX32664_Mutex();
+
+    void Lock();
+    void Unlock();
+
+    MAX32664_Mutex(const MAX32664_Mutex &) = delete;
+    MAX32664_Mutex &operator=(const MAX32664_Mutex &) = delete;
+};
+
+#if MAX32664_HAS_THREADS
+
+/// @brief A lock-free queue for exactly one producer thread and one consumer thread.
+/// @tparam T the element type (copied in and out)
+/// @tparam Capacity the number of slots, a power of two. One slot is always kept free.
+template <typename T, size_t Capacity>
+class MAX32664_SpscQueue
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+private:
+    T slots[Capacity];
+    std::atomic<size_t> head; // next slot to write, only changed by the producer
+    std::atomic<size_t> tail; // next slot to read, only changed by the consumer
+
+public:
+    MAX32664_SpscQueue() : head(0), tail(0) {}
+
+    /// @brief Adds an element (producer only)
+    /// @return false if the queue is full
+    bool Push(const T &element)
+    {
+        size_t current_head = head.load(std::memory_order_relaxed);
+        size_t next_head = (current_head + 1) & (Capacity - 1);
+        if (next_head == tail.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        slots[current_head] = element;
+        head.store(next_head, std::memory_order_release);
+        return true;
+    }
+
+    /// @brief Removes the oldest element (consumer only)
+    /// @return false if the queue is empty
+    bool Pop(T &element)
+    {
+        size_t current_tail = tail.load(std::memory_order_relaxed);
+        if (current_tail == head.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        element = slots[current_tail];
+        tail.store((current_tail + 1) & (Capacity - 1), std::memory_order_release);
+        return true;
+    }
+
+    /// @brief Returns the number of queued elements (exact only when called by one of the two threads
+    ///     while the other is idle)
+    size_t Size() const
+    {
+        return (head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire)) & (Capacity - 1);
+    }
+};
+
+#endif
+
+#endif /* __MAX32664_THREADING_H */
@@ -0,0 +1,332 @@
+#include "MAX32664_Vitals.h"
+
+// Histogram start and bin width of each vital sign. Values outside the histogram still count
+// towards min/max/mean and fall into the first or last bin for the median.
+#define VITALS_HR_START 30.0f     // 30 to 222 bpm
+#define VITALS_HR_WIDTH 3.0f
+#define VITALS_SPO2_START 70.0f   // 70 to 102 %
+#define VITALS_SPO2_WIDTH 0.5f
+#define VITALS_IBI_START 250.0f   // 250 to 2170 ms
+#define VITALS_IBI_WIDTH 30.0f
+#define VITALS_SYS_START 80.0f    // 80 to 208 mmHg
+#define VITALS_SYS_WIDTH 2.0f
+#define VITALS_DIA_START 40.0f    // 40 to 168 mmHg
+#define VITALS_DIA_WIDTH 2.0f
+
+MAX32664_VitalMetric::MAX32664_VitalMetric(float start, float width)
+{
+    bin_start = start;
+    bin_width = width;
+    Reset();
+}
+
+void MAX32664_VitalMetric::Reset()
+{
+    memset(bins, 0, sizeof(bins));
+    count = 0;
+    min = 0;
+    max = 0;
+    weighted_sum = 0;
+    weight_sum = 0;
+}
+
+/// @brief Adds one value to the window
+/// @param value the value of the vital sign
+/// @param weight the weight of the value in the mean
+void MAX32664_VitalMetric::Add(float value, float weight)
+{
+    if (count == 0xFFFF)
+    {
+        return;
+    }
+
+    if (count == 0 || value < min)
+    {
+        min = value;
+    }
+    if (count == 0 || value > max)
+    {
+        max = value;
+    }
+    count++;
+    weighted_sum += value * weight;
+    weight_sum += weight;
+
+    int bin = (int)((value - bin_start) / bin_width);
+    if (bin < 0)
+    {
+        bin = 0;
+    }
+    else if (bin >= MAX32664_VITALS_BINS)
+    {
+        bin = MAX32664_VITALS_BINS - 1;
+    }
+    bins[bin]++;
+}
+
+/// @brief Computes the statistics of the values added since the last Reset()
+/// @param stats receives the statistics
+void MAX32664_VitalMetric::Summarize(MAX32664_VitalStats &stats)
+{
+    memset(&stats, 0, sizeof(stats));
+    if (count == 0)
+    {
+        return;
+    }
+
+    stats.count = count;
+    stats.min = min;
+    stats.max = max;
+    stats.mean = (weight_sum > 0) ? weighted_sum / weight_sum : 0;
+
+    // Find the bin holding the middle value and interpolate within it
+    float middle = count / 2.0f;
+    uint16_t below = 0;
+    for (int i = 0; i < MAX32664_VITALS_BINS; i++)
+    {
+        if (below + bins[i] >= middle)
+        {
+            float median = bin_start + (i + (middle - below) / bins[i]) * bin_width;
+            stats.median = (median < min) ? min : ((median > max) ? max : median);
+            return;
+        }
+        below += bins[i];
+    }
+}
+
+/// @brief Creates an aggregator
+/// @param window the length of a window, in milliseconds
+MAX32664_VitalsAggregator::MAX32664_VitalsAggregator(uint32_t window)
+    : hr(VITALS_HR_START, VITALS_HR_WIDTH),
+      spo2(VITALS_SPO2_START, VITALS_SPO2_WIDTH),
+      ibi(VITALS_IBI_START, VITALS_IBI_WIDTH),
+      sys_bp(VITALS_SYS_START, VITALS_SYS_WIDTH),
+      dia_bp(VITALS_DIA_START, VITALS_DIA_WIDTH)
+{
+    window_ms = window;
+    min_confidence = 90;
+    weighting = false;
+    report_flags = false;
+    Reset();
+}
+
+/// @brief Sets the length of the windows. Takes effect at the next window.
+/// @param window the length of a window, in milliseconds
+void MAX32664_VitalsAggregator::SetWindow(uint32_t window)
+{
+    window_ms = window;
+}
+
+/// @brief Sets the confidence below which samples are dropped (hr_confidence on the MAX32664A,
+///     spo2_conf for the SpO2 of the MAX32664D)
+/// @param confidence the minimum confidence, in %
+void MAX32664_VitalsAggregator::SetMinConfidence(uint8_t confidence)
+{
+    min_confidence = confidence;
+}
+
+/// @brief Weights the mean of each vital sign by the confidence of its samples, instead of
+///     weighting every accepted sample the same
+/// @param enable true to weight by confidence
+void MAX32664_VitalsAggregator::SetWeighting(bool enable)
+{
+    weighting = enable;
+}
+
+/// @brief Only counts the SpO2 and BP of a MAX32664D sample when its spo2_report or bpt_report
+///     flag says the estimate was updated, so each estimate is counted once instead of once per
+///     sample. The flags need firmware 40.5.0 or later.
+/// @param enable true to use the report flags
+void MAX32664_VitalsAggregator::SetReportFlags(bool enable)
+{
+    report_flags = enable;
+}
+
+/// @brief Discards the current window and the last summary
+void MAX32664_VitalsAggregator::Reset()
+{
+    hr.Reset();
+    spo2.Reset();
+    ibi.Reset();
+    sys_bp.Reset();
+    dia_bp.Reset();
+    memset(&summary, 0, sizeof(summary));
+    window_start_ms = 0;
+    samples = 0;
+    rejected = 0;
+    window_open = false;
+}
+
+/// @brief Adds a MAX32664A sample (ReadSample_SensorAndAlgorithm()). The sample is only used
+///     if the finger is detected, the algorithm succeeded and hr_confidence is high enough.
+/// @param sample the sample
+/// @param now_ms the time the sample was read, e.g. millis()
+/// @return true if the sample started a new window, and the summary of the previous window is
+///     available from GetSummary()
+bool MAX32664_VitalsAggregator::AddSample(const MAX32664_Data &sample, uint32_t now_ms)
+{
+    bool closed = advance(now_ms);
+    if (samples < 0xFFFF)
+    {
+        samples++;
+    }
+
+    if (sample.algorithm_state != MAX32664_ALGORITHM_STATE_FINGER_DETECTED ||
+        sample.algorithm_status != MAX32664_ALGORITHM_STATUS_SUCCESS ||
+        sample.hr_confidence < min_confidence)
+    {
+        reject();
+        return closed;
+    }
+
+    float sample_weight = weight(sample.hr_confidence);
+    bool used = false;
+    if (sample.hr > 0)
+    {
+        hr.Add(sample.hr, sample_weight);
+        used = true;
+    }
+    if (sample.spo2 > 0)
+    {
+        spo2.Add(sample.spo2, sample_weight);
+        used = true;
+    }
+    if (sample.interbeat_interval > 0)
+    {
+        ibi.Add(sample.interbeat_interval, sample_weight);
+        used = true;
+    }
+
+    if (!used)
+    {
+        reject();
+    }
+    return closed;
+}
+
+/// @brief Adds a MAX32664D sample (ReadSample_BPTSensorAndAlgorithm()). HR and IBI are used
+///     while an estimation is running or has succeeded, IBI only on the sample that flags the
+///     beat, SpO2 if spo2_conf is high enough and BP only once the estimation succeeded.
+/// @param sample the sample
+/// @param now_ms the time the sample was read, e.g. millis()
+/// @return true if the sample started a new window, and the summary of the previous window is
+///     available from GetSummary()
+bool MAX32664_VitalsAggregator::AddSample(const MAX32664_Data_VerD &sample, uint32_t now_ms)
+{
+    bool closed = advance(now_ms);
+    if (samples < 0xFFFF)
+    {
+        samples++;
+    }
+
+    bool used = false;
+    bool has_signal = sample.bp_status == MAX32664_BP_STATUS_IN_PROGRESS || sample.bp_status == MAX32664_BP_STATUS_SUCCESS;
+    if (has_signal && sample.hr > 0)
+    {
+        hr.Add(sample.hr, 1.0f);
+        used = true;
+    }
+    if (has_signal && sample.pulse_flag && sample.ibi > 0)
+    {
+        ibi.Add(sample.ibi, 1.0f);
+        used = true;
+    }
+    if (sample.spo2 > 0 && sample.spo2_conf >= min_confidence && (!report_flags || sample.spo2_report))
+    {
+        spo2.Add(sample.spo2, weight(sample.spo2_conf));
+        used = true;
+    }
+    if (sample.bp_status == MAX32664_BP_STATUS_SUCCESS && sample.sys_bp > 0 && sample.dia_bp > 0 && (!report_flags || sample.bpt_report))
+    {
+        sys_bp.Add(sample.sys_bp, 1.0f);
+        dia_bp.Add(sample.dia_bp, 1.0f);
+        used = true;
+    }
+
+    if (!used)
+    {
+        reject();
+    }
+    return closed;
+}
+
+/// @brief Closes the current window if it has ended, without adding a sample. Call this when
+///     no samples arrive (e.g. the hub is asleep) so summaries are still produced on time.
+/// @param now_ms the current time, e.g. millis()
+/// @return true if a window was closed, and its summary is available from GetSummary()
+bool MAX32664_VitalsAggregator::Update(uint32_t now_ms)
+{
+    if (!window_open || (uint32_t)(now_ms - window_start_ms) < window_ms)
+    {
+        return false;
+    }
+
+    close_window();
+    return true;
+}
+
+/// @brief Returns the summary of the last closed window
+/// @param window_summary receives the summary
+void MAX32664_VitalsAggregator::GetSummary(MAX32664_VitalsSummary &window_summary)
+{
+    window_summary = summary;
+}
+
+/// @brief Opens the window the given time falls into, closing the current one if it has ended
+bool MAX32664_VitalsAggregator::advance(uint32_t now_ms)
+{
+    if (!window_open)
+    {
+        window_start_ms = now_ms;
+        window_open = true;
+        return false;
+    }
+
+    uint32_t elapsed = now_ms - window_start_ms;
+    if (elapsed < window_ms)
+    {
+        return false;
+    }
+
+    close_window();
+
+    // Keep the windows on the same grid unless samples stopped for more than a window
+    window_start_ms = (elapsed < 2 * window_ms) ? window_start_ms + window_ms : now_ms;
+    window_open = true;
+    return true;
+}
+
+void MAX32664_VitalsAggregator::close_window()
+{
+    summary.start_ms = window_start_ms;
+    summary.duration_ms = window_ms;
+    summary.samples = samples;
+    summary.rejected = rejected;
+    hr.Summarize(summary.hr);
+    spo2.Summarize(summary.spo2);
+    ibi.Summarize(summary.ibi);
+    sys_bp.Summarize(summary.sys_bp);
+    dia_bp.Summarize(summary.dia_bp);
+
+    hr.Reset();
+    spo2.Reset();
+    ibi.Reset();
+    sys_bp.Reset();
+    dia_bp.Reset();
+    samples = 0;
+    rejected = 0;
+    window_open = false;
+}
+
+void MAX32664_VitalsAggregator::reject()
+{
+    if (rejected < 0xFFFF)
+    {
+        rejected++;
+    }
+}
+
+float MAX32664_VitalsAggregator::weight(uint8_t confidence)
+{
+    return weighting ? confidence / 100.0f : 1.0f;
+}
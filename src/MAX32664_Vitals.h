@@ -0,0 +1,96 @@
+#ifndef __MAX32664_VITALS_H
+#define __MAX32664_VITALS_H
+
+#include <Arduino.h>
+#include "ReWire_MAX32664.h"
+
+// Number of histogram bins each vital sign uses for its median. The median is exact to within
+// one bin; MAX32664_Vitals.cpp sets the range and bin width of each vital sign.
+#define MAX32664_VITALS_BINS 64
+
+struct MAX32664_VitalStats
+{
+    uint16_t count; // accepted samples, 0 if the other fields are not valid
+    float min;
+    float max;
+    float mean;   // weighted by confidence if SetWeighting() is on
+    float median; // to within one histogram bin
+};
+
+struct MAX32664_VitalsSummary
+{
+    uint32_t start_ms;    // start of the window
+    uint32_t duration_ms; // length of the window
+    uint16_t samples;     // samples added to the window
+    uint16_t rejected;    // samples that did not contribute to any vital sign
+    MAX32664_VitalStats hr;     // bpm
+    MAX32664_VitalStats spo2;   // %
+    MAX32664_VitalStats ibi;    // ms
+    MAX32664_VitalStats sys_bp; // mmHg, MAX32664D only
+    MAX32664_VitalStats dia_bp; // mmHg, MAX32664D only
+};
+
+/// @brief Running statistics of one vital sign over a window. Adding a value is O(1); the median
+///     comes from a fixed histogram and is only computed when the window is summarized.
+class MAX32664_VitalMetric
+{
+private:
+    float bin_start;
+    float bin_width;
+    uint16_t bins[MAX32664_VITALS_BINS];
+    uint16_t count;
+    float min;
+    float max;
+    float weighted_sum;
+    float weight_sum;
+
+public:
+    MAX32664_VitalMetric(float start, float width);
+
+    void Reset();
+    void Add(float value, float weight);
+    void Summarize(MAX32664_VitalStats &stats);
+};
+
+/// @brief Reduces the stream of MAX32664A or MAX32664D samples to one summary per window
+///     (min/max/mean/median of HR, SpO2, IBI and BP), dropping samples the algorithm does not
+///     consider valid.
+class MAX32664_VitalsAggregator
+{
+private:
+    MAX32664_VitalMetric hr;
+    MAX32664_VitalMetric spo2;
+    MAX32664_VitalMetric ibi;
+    MAX32664_VitalMetric sys_bp;
+    MAX32664_VitalMetric dia_bp;
+    MAX32664_VitalsSummary summary;
+    uint32_t window_ms;
+    uint32_t window_start_ms;
+    uint16_t samples;
+    uint16_t rejected;
+    uint8_t min_confidence;
+    bool weighting;
+    bool report_flags;
+    bool window_open;
+
+    bool advance(uint32_t now_ms);
+    void close_window();
+    void reject();
+    float weight(uint8_t confidence);
+
+public:
+    MAX32664_VitalsAggregator(uint32_t window = 1000);
+
+    void SetWindow(uint32_t window);
+    void SetMinConfidence(uint8_t confidence);
+    void SetWeighting(bool enable);
+    void SetReportFlags(bool enable);
+    void Reset();
+
+    bool AddSample(const MAX32664_Data &sample, uint32_t now_ms);
+    bool AddSample(const MAX32664_Data_VerD &sample, uint32_t now_ms);
+    bool Update(uint32_t now_ms);
+    void GetSummary(MAX32664_VitalsSummary &window_summary);
+};
+
+#endif /* __MAX32664_VITALS_H */
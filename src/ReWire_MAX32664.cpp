@@ -1,21 +1,100 @@
 #include "ReWire_MAX32664.h"
 
+#if MAX32664_ENABLE_STATS
+#define MAX32664_STAT(statement) statement
+#else
+#define MAX32664_STAT(statement)
+#endif
+
+// Value of output_format while the hub's output mode is not known (e.g. right after a reset)
+#define OUTPUT_FORMAT_UNKNOWN 0xFF
+
+#if MAX32664_TRACE_DEPTH > 0
+static_assert((MAX32664_TRACE_DEPTH & (MAX32664_TRACE_DEPTH - 1)) == 0, "MAX32664_TRACE_DEPTH must be a power of two");
+#endif
+
+#if MAX32664_ENABLE_STATS
+static uint8_t stats_family(uint8_t family_byte)
+{
+    switch (family_byte)
+    {
+    case MAX32664_CommandFamilyByte::ReadSensorHubStatus:
+        return StatsFamily_Status;
+    case MAX32664_CommandFamilyByte::SetDeviceMode:
+    case MAX32664_CommandFamilyByte::ReadDeviceMode:
+        return StatsFamily_DeviceMode;
+    case MAX32664_CommandFamilyByte::SetOutputMode:
+    case MAX32664_CommandFamilyByte::ReadOutputMode:
+        return StatsFamily_OutputMode;
+    case MAX32664_CommandFamilyByte::ReadOutputFIFO:
+        return StatsFamily_OutputFifo;
+    case MAX32664_CommandFamilyByte::ReadInputFIFO:
+    case MAX32664_CommandFamilyByte::WriteInputFIFO:
+        return StatsFamily_InputFifo;
+    case MAX32664_CommandFamilyByte::WriteRegister:
+    case MAX32664_CommandFamilyByte::ReadRegister:
+    case MAX32664_CommandFamilyByte::GetAttributesOfAFE:
+    case MAX32664_CommandFamilyByte::DumpRegisters:
+    case MAX32664_CommandFamilyByte::EnableSensorMode:
+    case MAX32664_CommandFamilyByte::ReadSensorMode:
+    case MAX32664_CommandFamilyByte::WriteSensorConfiguration:
+    case MAX32664_CommandFamilyByte::ReadSensorConfiguration:
+        return StatsFamily_Sensor;
+    case MAX32664_CommandFamilyByte::SetAlgorithmConfiguration:
+    case MAX32664_CommandFamilyByte::GetAlgorithmConfiguration:
+    case MAX32664_CommandFamilyByte::EnableAlgorithm:
+        return StatsFamily_Algorithm;
+    case MAX32664_CommandFamilyByte::ReadIdentity:
+        return StatsFamily_Identity;
+    default:
+        return StatsFamily_Other;
+    }
+}
+#endif
+
+#if MAX32664_ENABLE_SAMPLE_CALIBRATION
+#ifndef PROGMEM
+// Cores without a separate program memory space (and host builds)
+#define PROGMEM
+#define memcpy_P memcpy
+#endif
+
 // calib vector sample from https://github.com/Protocentral/protocentral-pulse-express/
-uint8_t calibVector[5][CALIBVECTOR_SIZE] = {
+// (PROGMEM, because AVR copies plain const data to RAM at startup; a vector is copied to the
+// stack only while it is sent)
+static const uint8_t calibVector[MAX32664_CALIBRATION_POINTS][CALIBVECTOR_SIZE] PROGMEM = {
     {0x21, 0xB4, 0x34, 0x01, 0x34, 0xFC, 0x01, 0x00, 0x78, 0x00, 0x00, 0x00, 0x50, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0x4A, 0xB8, 0x17, 0xDC, 0x20, 0x8C, 0xE4, 0xFD, 0x3F, 0xF4, 0x3C, 0x90, 0xAE, 0x4D, 0x75, 0x00, 0x00, 0x00, 0x00, 0xF0, 0x1B, 0x45, 0xBC, 0xFE, 0x80, 0xE4, 0x3D, 0x71, 0x8D, 0x9D, 0x3E, 0xED, 0x14, 0x07, 0x3F, 0x6D, 0x59, 0x38, 0x3F, 0x23, 0x66, 0x59, 0x3F, 0x29, 0x4B, 0x68, 0x3F, 0x14, 0xF0, 0x6B, 0x3F, 0x74, 0x27, 0x6E, 0x3F, 0x99, 0xB5, 0x72, 0x3F, 0xE8, 0xFD, 0x76, 0x3F, 0x3D, 0x1A, 0x7B, 0x7F, 0x87, 0xC3, 0x56, 0xE2, 0x30, 0xAB, 0x5A, 0x75, 0x58, 0x6F, 0xC5, 0x3A, 0xF2, 0x8E, 0x3A, 0x3F, 0x9D, 0xAC, 0x2B, 0x3F, 0xC5, 0x2C, 0x22, 0x3F, 0xE4, 0x53, 0x1D, 0x3F, 0xFE, 0xEF, 0x1B, 0x3F, 0x04, 0x20, 0x1B, 0x3F, 0xCD, 0xFC, 0x17, 0x3F, 0x57, 0x70, 0x12, 0x3F, 0x15, 0x91, 0x0B, 0x3F, 0x51, 0xA4, 0x03, 0x3F, 0xE5, 0x62, 0xFB, 0x3E, 0x30, 0xAC, 0xF2, 0x3E, 0x22, 0xDE, 0xA4, 0xA4, 0x82, 0x1B, 0x95, 0x2A, 0x70, 0x60, 0x5F, 0x54, 0x4A, 0x6C, 0x7A, 0x87, 0x4E, 0x8F, 0x9D, 0x3E, 0xBF, 0x6E, 0x8C, 0x3E, 0xEE, 0xEB, 0x82, 0x3E, 0x78, 0x4B, 0x78, 0x3E, 0x5C, 0x15, 0x70, 0x3E, 0x02, 0xF2, 0x67, 0x3E, 0xF5, 0xEF, 0x5B, 0x3E, 0xB3, 0x4F, 0x52, 0x3E, 0xD4, 0x35, 0x49, 0x3E, 0x10, 0xAB, 0x3B, 0x3E, 0x9E, 0x35, 0x27, 0x3E, 0x06, 0xAD, 0x0C, 0x3E, 0x9C, 0x32, 0x9C, 0x04, 0x11, 0xF7, 0xA3, 0x29, 0x04, 0xB2, 0xA3, 0xB1, 0xF8, 0xD9, 0x99, 0x44, 0x6A, 0x9E, 0x07, 0x3E, 0xE8, 0xC2, 0xC0, 0x3D, 0x87, 0x4A, 0x16, 0x3D, 0xE7, 0x9D, 0x00, 0x0F, 0x09, 0x4F, 0x44, 0x6D, 0x7D, 0xB4, 0x9D, 0x20, 0xBA, 0x11, 0x45, 0x9F, 0x82, 0xE1, 0x85, 0xD2, 0x77, 0x61, 0xB4, 0x4B, 0xA0, 0xE3, 0xBC, 0x72, 0x6E, 0x0A, 0xBD, 0x61, 0x38, 0x3D, 0x23, 0x0E, 0x3D, 0x1F, 0x5C, 0x2C, 0x5E, 0x7A, 0x61, 0x89, 0xD9, 0x08, 0xA9, 0x70, 0x24, 0x3E, 0x3E, 0xF8, 0xEB, 0x39, 0x63, 0x63, 0x09, 0x28, 0x3F, 0x5A, 0xFA, 0x05, 0x95, 0x48, 0x65, 0xF3, 0xB1, 0x2D, 0xC5, 0x6F, 0x57, 0x94, 0x71, 0xBB, 0x18, 0x85, 0x64, 0xE1, 0x18, 0x37, 0x6C, 0xB3, 0xCE, 0x51, 0x69, 0xF9, 0xE5, 0x92, 0x8A, 0xF2, 0x89, 0x47, 0xC9, 0x83, 0x25, 0x0E, 0x0A, 0x5E, 0x3D, 0xCC, 0x94, 0x9C, 0xA5, 0xB1, 0xF1, 0xC1, 0x1C, 0xA5, 0x09, 0xB7, 0xDA, 0xEF, 0x20, 0xF6, 0x20, 0x2E, 0x06, 0x2C, 0xDC, 0x99, 0xB5, 0xFA, 0xB9, 0x58, 0x1A, 0xEF, 0x53, 0x20, 0xBF, 0x43, 0x2F, 0x06, 0x1E, 0x19, 0xED, 0xE5, 0x31, 0x73, 0x43, 0xFC, 0x06, 0xC3, 0xE8, 0xB3, 0x7E, 0xA2, 0x24, 0xA0, 0xFC, 0x72, 0x50, 0xD5, 0xEA, 0xAD, 0x4D, 0x9E, 0xF7, 0x5F, 0x89, 0xEA, 0xE6, 0x25, 0x89, 0x84, 0xDF, 0xBD, 0xB7, 0x2E, 0xFC, 0xF7, 0x2F, 0xDE, 0x38, 0x0D, 0x78, 0x0F, 0x01, 0x2D, 0x62, 0xEF, 0x60, 0x7E, 0x52, 0x6C, 0x76, 0x08, 0x2B, 0x27, 0xA8, 0x55, 0x22, 0xC9, 0x88, 0xED, 0xAC, 0x46, 0x08, 0x46, 0x30, 0xCE, 0x15, 0xD9, 0x25, 0x2C, 0x50, 0xA7, 0x47, 0x43, 0x5D, 0xB8, 0xE4, 0x68, 0xD6, 0x14, 0xA6, 0x7F, 0x9D, 0x78, 0xA1, 0x0C, 0x2E, 0x7C, 0xC9, 0xF4, 0x2A, 0x7E, 0x1E, 0x77, 0x3A, 0x28, 0x20, 0x35, 0xE5, 0xED, 0x40, 0x9D, 0xE9, 0x2D, 0xEC, 0xEC, 0xEF, 0xDC, 0x04, 0x1C, 0x48, 0x07, 0x66, 0x54, 0xBA, 0xB7, 0x72, 0x84, 0xB3, 0x64, 0xE1, 0x6C, 0x50, 0x38, 0xC8, 0x12, 0x2A, 0xDB, 0x94, 0xEB, 0x53, 0x13, 0x9B, 0x1A, 0xC3, 0x6E, 0xA4, 0xF6},
     {0x61, 0x3D, 0x34, 0x01, 0x46, 0xE0, 0x01, 0x00, 0x82, 0x00, 0x00, 0x00, 0x64, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xF1, 0xC5, 0x9F, 0x08, 0x99, 0xD3, 0x09, 0x3C, 0x78, 0x4D, 0x06, 0x74, 0x54, 0xDC, 0x09, 0xB5, 0x00, 0x00, 0x00, 0x00, 0x56, 0x8B, 0x7F, 0xBB, 0x69, 0x2A, 0x21, 0x3D, 0x6E, 0xE5, 0xEF, 0x3D, 0x71, 0x38, 0x70, 0x3E, 0x1C, 0xD3, 0xC5, 0x3E, 0xB9, 0xF0, 0x0E, 0x3F, 0x6B, 0x9F, 0x39, 0x3F, 0x77, 0x0D, 0x5B, 0x3F, 0xD4, 0x9B, 0x6D, 0x3F, 0x37, 0x64, 0x72, 0x3F, 0x72, 0x56, 0x6D, 0x3F, 0x98, 0xB0, 0xD3, 0x6B, 0x62, 0xE4, 0x67, 0x2C, 0x84, 0x62, 0x9C, 0xD1, 0x24, 0x48, 0xF5, 0x0A, 0x4D, 0x7D, 0x3E, 0x3F, 0xE8, 0xE9, 0x35, 0x3F, 0x4A, 0x91, 0x29, 0x3F, 0x12, 0x57, 0x1B, 0x3F, 0x9B, 0xB3, 0x0E, 0x3F, 0x70, 0xDB, 0x06, 0x3F, 0xB4, 0x67, 0x04, 0x3F, 0x91, 0x4F, 0x05, 0x3F, 0x29, 0xAC, 0x05, 0x3F, 0xE2, 0x9A, 0x02, 0x3F, 0xEB, 0xF4, 0xF8, 0x3E, 0x02, 0x69, 0xE9, 0x3E, 0x98, 0x43, 0xC1, 0xAC, 0x00, 0xFD, 0x34, 0xA8, 0xDE, 0x49, 0xFB, 0xCB, 0xC9, 0x69, 0x70, 0x1E, 0x44, 0xC6, 0xB1, 0x3E, 0x82, 0x22, 0xA8, 0x3E, 0xBD, 0xB0, 0x9C, 0x3E, 0x35, 0xEC, 0x90, 0x3E, 0xD6, 0xC2, 0x84, 0x3E, 0xE0, 0xF2, 0x71, 0x3E, 0x64, 0x30, 0x5C, 0x3E, 0x6E, 0xAA, 0x49, 0x3E, 0x1B, 0x24, 0x3C, 0x3E, 0xA3, 0xD1, 0x34, 0x3E, 0x4E, 0x84, 0x32, 0x3E, 0x70, 0x14, 0x2E, 0x3E, 0x6E, 0x50, 0x0E, 0xEA, 0x2F, 0x78, 0x5C, 0xD6, 0xCD, 0x08, 0xF8, 0xBF, 0x56, 0xE8, 0x29, 0x5E, 0x26, 0xEE, 0xA6, 0x3D, 0xA4, 0x71, 0x3C, 0x3D, 0x07, 0xB8, 0x73, 0x3C, 0x7D, 0x61, 0x7F, 0x8B, 0x96, 0x79, 0x40, 0x93, 0xFB, 0x4A, 0xC3, 0x97, 0x24, 0x42, 0x5B, 0x66, 0x57, 0x0F, 0xA2, 0x91, 0x73, 0xF5, 0x46, 0xF2, 0xFB, 0x71, 0xBC, 0xA3, 0x7F, 0x96, 0x95, 0xA1, 0x96, 0x34, 0xB2, 0x49, 0x45, 0x9B, 0x35, 0x5E, 0x94, 0xE0, 0x8F, 0x9A, 0x6C, 0x5F, 0xDA, 0x76, 0x83, 0xD2, 0x75, 0x96, 0x86, 0xB1, 0x7D, 0x16, 0x44, 0xDA, 0x33, 0xD2, 0xD7, 0x34, 0x57, 0xF0, 0xFB, 0xC5, 0xAD, 0x8F, 0xA8, 0xE5, 0x09, 0xDE, 0x0D, 0x7A, 0xA1, 0x08, 0x87, 0xE6, 0xED, 0x43, 0x07, 0x55, 0x25, 0x06, 0x39, 0x17, 0xEA, 0xC8, 0xEC, 0x32, 0x89, 0x81, 0x71, 0xDC, 0x15, 0xC9, 0x94, 0xDD, 0xF2, 0x0F, 0x22, 0xD2, 0xEC, 0xA5, 0x3F, 0x7F, 0x7F, 0x69, 0x11, 0xF0, 0xF7, 0x9A, 0xAA, 0x58, 0x8C, 0x07, 0x40, 0xA7, 0x2C, 0x4F, 0x1D, 0xF4, 0x19, 0x70, 0x19, 0xD6, 0x89, 0x81, 0x30, 0x40, 0x76, 0x02, 0xD5, 0x69, 0x19, 0x4F, 0x8F, 0xCF, 0x38, 0xF8, 0xC1, 0x6C, 0x55, 0xF3, 0x78, 0xAC, 0x0D, 0x12, 0xC2, 0xAD, 0x49, 0x36, 0xFD, 0x65, 0x7E, 0x57, 0x71, 0x89, 0xB7, 0xD5, 0x5E, 0x4B, 0x64, 0xF0, 0x77, 0x04, 0x55, 0xCC, 0x35, 0x19, 0x41, 0x49, 0x01, 0xE6, 0x1E, 0xD7, 0x01, 0xBC, 0x5C, 0x6B, 0x0F, 0x3F, 0x4D, 0x77, 0xC8, 0x73, 0x94, 0xF2, 0x67, 0x3E, 0x48, 0xD3, 0x3B, 0x8F, 0xE8, 0x83, 0x77, 0x5C, 0x82, 0xBE, 0xFF, 0x10, 0x66, 0x4D, 0x45, 0x53, 0xCC, 0x1D, 0x91, 0xD0, 0x0B, 0x6B, 0x54, 0x3A, 0xF6, 0xAA, 0xE6, 0x8F, 0x82, 0x0F, 0xAF, 0xDF, 0xF9, 0xCF, 0x4F, 0x75, 0xEC, 0x52, 0x97, 0xEF, 0x77, 0x62, 0x0D, 0xC1, 0xF7, 0xDA, 0xAC, 0xF5, 0xDA, 0x12, 0x89, 0x48, 0xBB, 0x83, 0x52, 0x3E, 0x55, 0x37, 0xFF, 0x8E, 0xC1, 0x9E, 0x38, 0xAF, 0xFE, 0x4A, 0xE8, 0xB1, 0x1C, 0x9E, 0x1C, 0x7E, 0xD9, 0x64, 0x77, 0xA6, 0x10, 0x14, 0x68, 0x1B, 0x0F, 0xD9},
     {0x61, 0x3D, 0x34, 0x01, 0x46, 0xE0, 0x01, 0x00, 0x73, 0x00, 0x00, 0x00, 0x5A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x75, 0xD7, 0x2C, 0x83, 0x62, 0xBD, 0x6F, 0x49, 0x12, 0xC6, 0x54, 0x07, 0xB4, 0x0D, 0xBC, 0x45, 0x00, 0x00, 0x00, 0x00, 0x7B, 0x1E, 0xEB, 0xBB, 0xA9, 0x87, 0x55, 0x3D, 0x0E, 0xD7, 0x27, 0x3E, 0x21, 0x33, 0xA4, 0x3E, 0xBA, 0x29, 0xFB, 0x3E, 0x93, 0x56, 0x24, 0x3F, 0x0F, 0x84, 0x41, 0x3F, 0x65, 0x49, 0x55, 0x3F, 0x82, 0x25, 0x61, 0x3F, 0x94, 0x66, 0x67, 0x3F, 0x98, 0x58, 0x69, 0x3F, 0x23, 0xC9, 0xB2, 0xE6, 0x2D, 0xEF, 0x91, 0xB4, 0xC3, 0x04, 0x76, 0xD9, 0xBD, 0x2D, 0xB7, 0xFF, 0x9C, 0x38, 0x5C, 0x3F, 0xB0, 0xE2, 0x52, 0x3F, 0x28, 0x1C, 0x48, 0x3F, 0xEE, 0x63, 0x3E, 0x3F, 0xDD, 0x9B, 0x35, 0x3F, 0xD7, 0x81, 0x2D, 0x3F, 0x39, 0x34, 0x26, 0x3F, 0x76, 0xFC, 0x1F, 0x3F, 0x30, 0x66, 0x1B, 0x3F, 0x58, 0x57, 0x17, 0x3F, 0x24, 0xAA, 0x12, 0x3F, 0x01, 0x51, 0x0D, 0x3F, 0xB9, 0x2C, 0x84, 0x38, 0xD5, 0x7E, 0xF8, 0x24, 0xAB, 0x10, 0x8B, 0xAE, 0x39, 0xE4, 0x4C, 0x49, 0x28, 0xE9, 0xD4, 0x3E, 0xF0, 0x8D, 0xC2, 0x3E, 0x36, 0xA1, 0xB0, 0x3E, 0x35, 0x97, 0x9F, 0x3E, 0x69, 0xD6, 0x8F, 0x3E, 0xA6, 0x6C, 0x82, 0x3E, 0xB8, 0x2C, 0x70, 0x3E, 0x31, 0x11, 0x64, 0x3E, 0x5E, 0xEF, 0x5A, 0x3E, 0x13, 0x19, 0x4E, 0x3E, 0xA7, 0x53, 0x40, 0x3E, 0xB1, 0x62, 0x31, 0x3E, 0x61, 0x98, 0x77, 0x1A, 0x19, 0x4D, 0x11, 0x34, 0x3C, 0x2A, 0x9D, 0x54, 0xA4, 0xDB, 0x52, 0x81, 0x1E, 0xAA, 0xA0, 0x3D, 0x8D, 0x8D, 0x47, 0x3D, 0x1C, 0x78, 0x8E, 0x3C, 0xE1, 0xCE, 0x3B, 0xFC, 0xA8, 0xA3, 0xD6, 0x9F, 0x7A, 0x59, 0xE5, 0x45, 0x18, 0x6D, 0x73, 0x60, 0x83, 0x62, 0x16, 0x93, 0xB6, 0x6D, 0x14, 0x96, 0x96, 0x5B, 0xDD, 0x7F, 0x80, 0xCE, 0xE5, 0xE4, 0x71, 0x34, 0xD3, 0x8E, 0xC4, 0x40, 0x5F, 0xB4, 0x11, 0xF5, 0x83, 0x21, 0x08, 0x27, 0xA3, 0x21, 0xEA, 0x58, 0x72, 0xB3, 0x61, 0x8B, 0xDD, 0xE7, 0xDF, 0xA9, 0x61, 0xD6, 0xC5, 0xE5, 0x86, 0xE7, 0x59, 0xE6, 0x92, 0xEB, 0xD5, 0xBC, 0xEF, 0xAC, 0x73, 0xD6, 0x9E, 0x7F, 0x47, 0x99, 0x5D, 0x0A, 0xC7, 0xAB, 0x7F, 0xF5, 0x29, 0xC2, 0xB4, 0x64, 0xCD, 0x67, 0x20, 0xC3, 0x0A, 0x4A, 0xD9, 0xD8, 0xFD, 0x21, 0xD3, 0x1B, 0xF7, 0x1A, 0xD5, 0x68, 0xBB, 0x4B, 0xA5, 0x86, 0x10, 0x13, 0xAB, 0x31, 0x9F, 0x46, 0x65, 0x77, 0xD4, 0x0F, 0xD5, 0x72, 0x3A, 0x81, 0x4A, 0xBF, 0xCD, 0xDA, 0x66, 0xB1, 0x64, 0x4F, 0xAF, 0x94, 0xCB, 0x1F, 0x42, 0xBB, 0x9B, 0xE0, 0xEA, 0x37, 0x6F, 0x58, 0x53, 0x56, 0x00, 0x3F, 0x51, 0xC1, 0x90, 0x17, 0x3D, 0x49, 0x14, 0x47, 0x3A, 0x9F, 0x41, 0xDE, 0xB2, 0x79, 0xAE, 0x56, 0x20, 0x7F, 0x02, 0xDF, 0x7E, 0x21, 0xAF, 0xAF, 0x72, 0x7F, 0xD9, 0xF8, 0xD3, 0x99, 0x69, 0xA8, 0x4B, 0x6B, 0xC5, 0x59, 0x2C, 0x12, 0x08, 0xFD, 0xDD, 0x15, 0xDE, 0xFD, 0x79, 0x30, 0x7E, 0xF6, 0x1F, 0xFC, 0x6D, 0x8F, 0x39, 0xE8, 0x62, 0xAB, 0xD1, 0x99, 0xD9, 0xCA, 0x31, 0x3B, 0x6E, 0x5E, 0xB6, 0x0B, 0xDF, 0x67, 0x9E, 0x10, 0x30, 0x78, 0x0A, 0x36, 0xED, 0x38, 0xED, 0xB1, 0x65, 0x16, 0xBE, 0x6C, 0x7D, 0x62, 0x7E, 0x6A, 0x8E, 0x4D, 0xEF, 0xFD, 0x99, 0x65, 0x0D, 0x77, 0x4B, 0xF5, 0xEB, 0x89, 0x20, 0x18, 0xCB, 0xC8, 0xC3, 0xB0, 0xE4, 0x06, 0x15, 0xDB, 0xF4, 0x97, 0x4B, 0xB0, 0x8C, 0x35, 0x33, 0xC6, 0xA8, 0x99, 0x28, 0xEF, 0x75, 0xD0, 0x41, 0x40, 0xF3, 0x54},
     {0x61, 0x3D, 0x34, 0x01, 0x46, 0xE0, 0x01, 0x00, 0x6E, 0x00, 0x00, 0x00, 0x46, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x85, 0xA8, 0xAC, 0x06, 0x73, 0xC0, 0x53, 0x7A, 0x9B, 0x3F, 0xF2, 0x41, 0x0C, 0xCD, 0x0B, 0x96, 0x00, 0x00, 0x00, 0x00, 0x13, 0xF5, 0x51, 0xBB, 0xAF, 0xC2, 0x4B, 0x3D, 0x27, 0x19, 0x20, 0x3E, 0xDD, 0x1B, 0xA1, 0x3E, 0xD3, 0x90, 0x00, 0x3F, 0xD5, 0x4E, 0x2F, 0x3F, 0x46, 0x48, 0x55, 0x3F, 0x90, 0x65, 0x6E, 0x3F, 0x77, 0x2B, 0x7A, 0x3F, 0x30, 0xA0, 0x79, 0x3F, 0x09, 0x12, 0x6F, 0x3F, 0x68, 0x13, 0x05, 0xB8, 0xBC, 0xD3, 0x48, 0x56, 0x56, 0x50, 0x45, 0x1B, 0x13, 0x6D, 0x36, 0xF1, 0xF4, 0xDE, 0x3D, 0x3F, 0x6B, 0x2C, 0x35, 0x3F, 0x53, 0x91, 0x2C, 0x3F, 0xE3, 0x87, 0x25, 0x3F, 0x64, 0x82, 0x20, 0x3F, 0x4A, 0x76, 0x1D, 0x3F, 0xD1, 0x12, 0x1B, 0x3F, 0xA9, 0xF4, 0x17, 0x3F, 0x99, 0xDE, 0x13, 0x3F, 0x13, 0x21, 0x0F, 0x3F, 0xE6, 0xBF, 0x09, 0x3F, 0xBE, 0x59, 0x04, 0x3F, 0xE9, 0x84, 0x58, 0xEA, 0xF0, 0x47, 0xBD, 0xDC, 0xAA, 0x8F, 0xEB, 0x7C, 0x4A, 0xA4, 0xFA, 0x1D, 0x62, 0xA5, 0xBA, 0x3E, 0x9C, 0xF8, 0xB1, 0x3E, 0x9C, 0x99, 0xA9, 0x3E, 0xEE, 0x85, 0xA1, 0x3E, 0xEC, 0x3B, 0x9D, 0x3E, 0x16, 0x51, 0x9B, 0x3E, 0x7E, 0xB7, 0x98, 0x3E, 0xEE, 0xE6, 0x92, 0x3E, 0xDF, 0xF6, 0x86, 0x3E, 0x46, 0x2C, 0x6E, 0x3E, 0x37, 0xB3, 0x4C, 0x3E, 0xD4, 0x0E, 0x32, 0x3E, 0x88, 0xFD, 0x9C, 0xED, 0x70, 0x36, 0xAF, 0xBE, 0xBD, 0xCC, 0x43, 0x76, 0xD7, 0xC5, 0x15, 0x60, 0xF2, 0x39, 0xA8, 0x3D, 0x9E, 0xBC, 0x4B, 0x3D, 0x6D, 0x13, 0x98, 0x3C, 0xB6, 0xC4, 0xB0, 0x97, 0xA3, 0x50, 0x3B, 0xB1, 0xED, 0x52, 0x39, 0x33, 0x68, 0x38, 0x38, 0xF4, 0xEA, 0x7F, 0x32, 0xF6, 0x95, 0xF1, 0x3A, 0xD4, 0xE5, 0xC8, 0x88, 0x34, 0x86, 0x33, 0xEA, 0x5F, 0x55, 0xB5, 0x38, 0x60, 0xF6, 0xAB, 0x8D, 0xEB, 0xCC, 0x34, 0x9D, 0x91, 0xF7, 0xB6, 0x18, 0x1C, 0x47, 0x4D, 0x38, 0x59, 0x90, 0x1E, 0xE0, 0xCD, 0x40, 0x97, 0x13, 0xB4, 0xC5, 0x97, 0x8A, 0xC7, 0xF5, 0xC2, 0x29, 0xC1, 0xC9, 0x88, 0x68, 0x4C, 0x48, 0x8E, 0xE4, 0x96, 0xAC, 0xA3, 0x8D, 0xF8, 0x6B, 0x92, 0xEB, 0x27, 0x0C, 0xD4, 0x99, 0x01, 0x74, 0xAF, 0x18, 0x3F, 0xB6, 0x97, 0x65, 0x52, 0x79, 0x47, 0x02, 0xB7, 0x40, 0x60, 0x90, 0xA6, 0x1A, 0xC9, 0x65, 0x75, 0xFA, 0xCB, 0xA3, 0x89, 0x7E, 0xDB, 0xC1, 0x44, 0xAF, 0x43, 0xEB, 0xB2, 0x24, 0x7F, 0xD9, 0x0C, 0x9F, 0x42, 0x09, 0xB5, 0xF1, 0x3C, 0xB8, 0x07, 0x1E, 0xA9, 0x8B, 0x8F, 0x69, 0x03, 0x60, 0x0D, 0xA9, 0x1E, 0xD6, 0x16, 0x39, 0x14, 0x3A, 0xC9, 0xF9, 0xDB, 0xC9, 0x42, 0x36, 0x89, 0x05, 0xA4, 0x8E, 0x7D, 0xEE, 0xFB, 0x97, 0xDD, 0xE0, 0x57, 0xF9, 0xED, 0xA9, 0x94, 0x62, 0xAD, 0xD0, 0xB5, 0xB5, 0x0C, 0xA3, 0xEF, 0x69, 0x14, 0x4C, 0x4E, 0xA2, 0xC9, 0x23, 0x26, 0x13, 0x47, 0x28, 0x39, 0x7B, 0x43, 0xC3, 0x33, 0xCF, 0x50, 0xE1, 0x41, 0xBB, 0xB1, 0xE8, 0x64, 0x3A, 0x70, 0x72, 0xE5, 0x31, 0x95, 0xB9, 0xB8, 0x23, 0xD9, 0x5F, 0x45, 0xF9, 0x84, 0x76, 0xD8, 0xE0, 0x0F, 0x1B, 0xF8, 0x62, 0xF4, 0xC0, 0x2D, 0x24, 0x49, 0x23, 0x6A, 0x15, 0x67, 0x00, 0x20, 0xDE, 0x4F, 0xF2, 0x5C, 0x5E, 0xE8, 0x30, 0x76, 0x0F, 0xAC, 0x06, 0x0F, 0x3E, 0x4D, 0x58, 0xD6, 0xC5, 0xFC, 0x6E, 0x64, 0x62, 0x93, 0xF1, 0x2D, 0x37, 0x97, 0x2A, 0xDE, 0x0C, 0x94, 0xB3, 0x40, 0x26, 0x91, 0x81, 0xCB, 0xDA, 0x78, 0x7F, 0x73},
     {0x61, 0x3D, 0x34, 0x01, 0x46, 0xE0, 0x01, 0x00, 0x82, 0x00, 0x00, 0x00, 0x46, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xAF, 0x91, 0x08, 0xF2, 0xB8, 0xD7, 0x7D, 0x92, 0x22, 0xDE, 0xD1, 0x1B, 0x22, 0x60, 0x7D, 0x2B, 0x00, 0x00, 0x00, 0x00, 0x1D, 0x56, 0x66, 0xBB, 0x03, 0xD7, 0x53, 0x3D, 0x9E, 0xB1, 0x2E, 0x3E, 0x60, 0xE5, 0xB4, 0x3E, 0x52, 0xB0, 0x0F, 0x3F, 0x94, 0xAB, 0x3D, 0x3F, 0x36, 0xB8, 0x5D, 0x3F, 0xD4, 0x32, 0x70, 0x3F, 0x0E, 0x65, 0x76, 0x3F, 0x37, 0x7D, 0x73, 0x3F, 0x72, 0x62, 0x6C, 0x3F, 0x67, 0xAF, 0xD2, 0x26, 0xE6, 0x40, 0x6C, 0xC6, 0xAD, 0x28, 0x6D, 0x25, 0x78, 0x5D, 0x3A, 0x11, 0xFF, 0x8E, 0x43, 0x3F, 0xB1, 0xAF, 0x35, 0x3F, 0x48, 0xFC, 0x27, 0x3F, 0xD7, 0x7A, 0x1C, 0x3F, 0xCC, 0x1F, 0x14, 0x3F, 0x8F, 0x4E, 0x0F, 0x3F, 0x3C, 0x06, 0x0D, 0x3F, 0x05, 0x45, 0x09, 0x3F, 0xC4, 0x5A, 0x03, 0x3F, 0x8D, 0x02, 0xFA, 0x3E, 0x1E, 0xE8, 0xED, 0x3E, 0xBE, 0x74, 0xE1, 0x3E, 0xD9, 0x03, 0xD4, 0xD2, 0x10, 0x10, 0xB7, 0x1E, 0x42, 0x8F, 0xD1, 0x7E, 0xD5, 0x8C, 0x43, 0x21, 0x4C, 0xC1, 0xA6, 0x3E, 0xC9, 0x98, 0xA0, 0x3E, 0xD1, 0x96, 0x9E, 0x3E, 0x4C, 0xEA, 0x9C, 0x3E, 0x45, 0x47, 0x99, 0x3E, 0x3C, 0x9A, 0x92, 0x3E, 0xC5, 0x52, 0x88, 0x3E, 0x0A, 0x16, 0x78, 0x3E, 0x55, 0xA0, 0x5D, 0x3E, 0x3E, 0xE8, 0x43, 0x3E, 0x2F, 0xCE, 0x29, 0x3E, 0xCE, 0xB8, 0x14, 0x3E, 0x96, 0x77, 0xA8, 0x74, 0xBC, 0x75, 0xBC, 0x9E, 0x81, 0xFD, 0xBA, 0x95, 0x97, 0xA7, 0xB6, 0x48, 0x9C, 0xE5, 0xAB, 0x3D, 0xD7, 0x17, 0x3A, 0x3D, 0xE6, 0x5A, 0x7F, 0x3C, 0x1A, 0x5B, 0x5B, 0xAC, 0xD5, 0x86, 0xDD, 0x04, 0x49, 0x15, 0x06, 0x2A, 0x16, 0x53, 0x71, 0x9C, 0xFA, 0x38, 0x9C, 0x3C, 0x20, 0xCC, 0xEE, 0xA3, 0xA9, 0x19, 0x6F, 0x07, 0x0E, 0x6C, 0x0B, 0x98, 0x32, 0x72, 0x7D, 0x23, 0x45, 0xDD, 0x2F, 0x06, 0x83, 0x67, 0xC3, 0x00, 0xA3, 0x4D, 0x4D, 0xB7, 0xAC, 0x81, 0xA4, 0x2B, 0x03, 0xEF, 0xAA, 0x78, 0x8B, 0x9C, 0x31, 0x17, 0xE5, 0x6A, 0x23, 0x86, 0x00, 0xD0, 0x9C, 0xC9, 0xA5, 0xE8, 0xE9, 0x28, 0x1A, 0x0F, 0x23, 0x46, 0x5B, 0xBB, 0x0E, 0x7A, 0xF2, 0x9F, 0x4F, 0xEA, 0x7F, 0x69, 0xC1, 0xC5, 0x31, 0xC9, 0x44, 0xFE, 0x77, 0x65, 0xD6, 0xDE, 0xE3, 0xB7, 0x98, 0xE0, 0x32, 0xF6, 0x26, 0xB5, 0xA5, 0xFF, 0x03, 0xF9, 0x6F, 0xCA, 0xE8, 0x5D, 0xA2, 0x7A, 0x3F, 0x20, 0xA0, 0x25, 0x62, 0x8D, 0xF8, 0x68, 0x9D, 0xC1, 0xFB, 0x48, 0x12, 0x78, 0x25, 0xD4, 0xBC, 0xCD, 0x99, 0xC4, 0xA4, 0x75, 0xC8, 0x18, 0x26, 0x69, 0x40, 0x8A, 0xFD, 0xD6, 0x00, 0x7D, 0xC6, 0x54, 0x41, 0xF5, 0x19, 0xE1, 0xCE, 0x70, 0xB0, 0xE5, 0x96, 0xE8, 0x53, 0x5E, 0xB9, 0xA8, 0xB1, 0xF1, 0xD9, 0x02, 0x49, 0x64, 0x49, 0x2B, 0xD4, 0x32, 0xE2, 0xE2, 0xDB, 0xD3, 0xB2, 0x4E, 0x9E, 0x04, 0x2A, 0xCF, 0x21, 0x99, 0x2E, 0xB1, 0x93, 0x80, 0x3B, 0x0B, 0xB0, 0x4A, 0xFB, 0xED, 0x6A, 0x7C, 0xE4, 0x6A, 0x63, 0x9B, 0xB7, 0xE3, 0x22, 0xF3, 0x8D, 0x7D, 0x46, 0x73, 0xF7, 0x05, 0x0E, 0x02, 0x2F, 0x1B, 0xB6, 0x08, 0x23, 0x78, 0x32, 0x52, 0x87, 0x72, 0xE7, 0x15, 0x68, 0xF8, 0x11, 0x46, 0xDB, 0x84, 0x11, 0xA3, 0x02, 0x4B, 0xA3, 0x28, 0x4C, 0x1A, 0x09, 0xE9, 0x18, 0x8C, 0x34, 0xFA, 0x4F, 0xF4, 0x5A, 0xB6, 0x43, 0x33, 0x7F, 0xDA, 0xA2, 0xD8, 0x6D, 0x30, 0xF7, 0xA3, 0x80, 0xE0, 0xD8, 0x5B, 0x32, 0xC6, 0x05, 0x23, 0xCB, 0x9D, 0x07, 0x7E, 0x0B, 0x2A}};
-uint8_t vectorSystolicDystolic[5][2] = {{120, 80}, {130, 100}, {115, 90}, {110, 70}, {130, 70}};
+#endif
+
 ReWire_MAX32664::ReWire_MAX32664(TwoWire *i2c_instance, int pin_mfio, int pin_reset, int i2c_address)
+    : bus(&wire_bus)
 {
     ConfigurePinsAndI2C(i2c_instance, pin_mfio, pin_reset, i2c_address);
+    memset(&capabilities, 0, sizeof(capabilities));
+    output_format = OUTPUT_FORMAT_UNKNOWN;
+    fifo_threshold = MAX32664_FIFO_THRESHOLD_DEFAULT;
+#if MAX32664_ENABLE_EVENTS
+    event_callback = NULL;
+    event_context = NULL;
+    event_mask = 0;
+    last_algorithm_state = MAX32664_EVENT_UNKNOWN;
+    last_bp_status = MAX32664_EVENT_UNKNOWN;
+    last_progress = MAX32664_EVENT_UNKNOWN;
+#endif
+    spo2_coefficients[0] = MAX32664_SPO2_COEF_A;
+    spo2_coefficients[1] = MAX32664_SPO2_COEF_B;
+    spo2_coefficients[2] = MAX32664_SPO2_COEF_C;
+    ResetStats();
+    ClearTrace();
 }
 
 void ReWire_MAX32664::ConfigurePinsAndI2C(TwoWire *i2c_instance, int pin_mfio, int pin_reset, int i2c_address)
 {
-    wire_instance = i2c_instance;
+    wire_bus.SetWire(i2c_instance);
     mfio_pin = pin_mfio;
     reset_pin = pin_reset;
     max32664_i2c_address = i2c_address;
@@ -27,11 +106,327 @@ uint8_t ReWire_MAX32664::Begin(uint8_t &device_mode, TwoWire *i2c_instance, int
     return Begin(device_mode);
 }
 
+/// @brief Routes all hub traffic through a custom bus (a capture or replay bus, for example)
+/// @param custom_bus the bus to use, or NULL to go back to the I2C instance
+void ReWire_MAX32664::SetBus(MAX32664_Bus *custom_bus)
+{
+    bus = (custom_bus != NULL) ? custom_bus : &wire_bus;
+}
+
+/// @brief Takes a snapshot of the driver's counters (all zeros unless MAX32664_ENABLE_STATS is set)
+/// @param snapshot the counters since the last call to ResetStats()
+void ReWire_MAX32664::GetStats(MAX32664_Stats &snapshot)
+{
+#if MAX32664_ENABLE_STATS
+    snapshot = stats;
+    snapshot.elapsed_ms = millis() - stats_start_ms;
+    snapshot.samples_per_second = (snapshot.elapsed_ms > 0) ? (stats.samples * 1000.0f) / snapshot.elapsed_ms : 0;
+#else
+    memset(&snapshot, 0, sizeof(snapshot));
+#endif
+}
+
+/// @brief Clears the driver's counters
+void ReWire_MAX32664::ResetStats()
+{
+#if MAX32664_ENABLE_STATS
+    memset(&stats, 0, sizeof(stats));
+    stats_start_ms = millis();
+    drain_start_us = 0;
+    drain_remaining = 0;
+#endif
+}
+
+/// @brief Copies the traced transactions, oldest first (nothing unless MAX32664_TRACE_DEPTH is set)
+/// @param records the buffer to hold the records
+/// @param max_records the number of records the buffer can hold
+/// @return the number of records copied
+uint16_t ReWire_MAX32664::GetTrace(MAX32664_TraceRecord *records, uint16_t max_records)
+{
+#if MAX32664_TRACE_DEPTH > 0
+    uint32_t available = (trace_count < MAX32664_TRACE_DEPTH) ? trace_count : MAX32664_TRACE_DEPTH;
+    uint16_t num_records = (available < max_records) ? available : max_records;
+
+    // Skip the oldest records if the caller's buffer is smaller than the trace
+    uint32_t first = trace_count - num_records;
+    for (uint16_t i = 0; i < num_records; ++i)
+    {
+        records[i] = trace[(first + i) & (MAX32664_TRACE_DEPTH - 1)];
+    }
+    return num_records;
+#else
+    (void)records;
+    (void)max_records;
+    return 0;
+#endif
+}
+
+/// @brief Writes the traced transactions as Chrome trace event JSON, which can be loaded into
+///     chrome://tracing or https://ui.perfetto.dev to view them on a timeline.
+/// @param output where to write the trace (Serial, a file...)
+void ReWire_MAX32664::DumpTrace(Print &output)
+{
+    output.print("{\"traceEvents\":[");
+#if MAX32664_TRACE_DEPTH > 0
+    static const char *primitive_names[4] = {"read_byte", "read_multiple_bytes", "write_byte", "write_multiple_bytes"};
+    static const char hex_digits[] = "0123456789ABCDEF";
+
+    uint32_t available = (trace_count < MAX32664_TRACE_DEPTH) ? trace_count : MAX32664_TRACE_DEPTH;
+    for (uint32_t i = trace_count - available; i != trace_count; ++i)
+    {
+        const MAX32664_TraceRecord &record = trace[i & (MAX32664_TRACE_DEPTH - 1)];
+        char name[10] = {'0', 'x', hex_digits[record.family >> 4], hex_digits[record.family & 0x0F], ' ',
+                         '0', 'x', hex_digits[record.index >> 4], hex_digits[record.index & 0x0F], 0};
+
+        output.print((i == trace_count - available) ? "\n" : ",\n");
+        output.print("{\"name\":\"");
+        output.print(name);
+        output.print("\",\"cat\":\"");
+        output.print(primitive_names[record.primitive & 0x03]);
+        output.print("\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":");
+        output.print((unsigned long)record.start_us);
+        output.print(",\"dur\":");
+        output.print((unsigned long)(record.end_us - record.start_us));
+        output.print(",\"args\":{\"length\":");
+        output.print((unsigned int)record.length);
+        output.print(",\"status\":");
+        output.print((unsigned int)record.status);
+        output.print("}}");
+    }
+#endif
+    output.println("\n]}");
+}
+
+/// @brief Empties the trace buffer
+void ReWire_MAX32664::ClearTrace()
+{
+#if MAX32664_TRACE_DEPTH > 0
+    trace_count = 0;
+#endif
+}
+
+#if MAX32664_ENABLE_EVENTS
+/// @brief Subscribes to events raised while samples and the hub status are read. Events are raised
+///     as soon as each record is decoded, from inside the ReadSample_* and ReadSensorHubStatus calls.
+/// @param callback the function to call, or NULL to unsubscribe
+/// @param context passed unchanged to the callback
+/// @param events the MAX32664_EventType values to raise, OR'ed together
+/// @param low_latency true to lower the FIFO interrupt threshold to a single sample, so every
+///     record is available as soon as the hub produces it. If the hub is already configured the
+///     new threshold is sent right away; otherwise the Configure* functions use it.
+/// @return the status byte of the threshold update, SUCCESS_STATUS if none was needed
+uint8_t ReWire_MAX32664::SetEventCallback(MAX32664_EventCallback callback, void *context, uint8_t events, bool low_latency)
+{
+    event_callback = callback;
+    event_context = context;
+    event_mask = (callback != NULL) ? events : 0;
+    last_algorithm_state = MAX32664_EVENT_UNKNOWN;
+    last_bp_status = MAX32664_EVENT_UNKNOWN;
+    last_progress = MAX32664_EVENT_UNKNOWN;
+
+    uint8_t threshold = (callback != NULL && low_latency) ? 1 : MAX32664_FIFO_THRESHOLD_DEFAULT;
+    if (threshold == fifo_threshold)
+    {
+        return MAX32664_ReadStatusByteValue::SUCCESS_STATUS;
+    }
+    fifo_threshold = threshold;
+    if (output_format == OUTPUT_FORMAT_UNKNOWN)
+    {
+        return MAX32664_ReadStatusByteValue::SUCCESS_STATUS;
+    }
+    return SetOutputMode_FifoInterruptThreshold(fifo_threshold);
+}
+#endif
+
 /// @brief Initializes communication with the MAX32664
 /// @param device_mode the resulting operating mode of the MAX32664
 /// @return the resulting status byte of the read operation
 uint8_t ReWire_MAX32664::Begin(uint8_t &device_mode)
 {
+    reset_hub();
+
+    // After approximately 50 ms, the MAX32664 is now in "application mode".
+    // After approximately 1 second from when the reset pin was set to high, the application should have
+    // completed initialization and the device is now ready to accept I2C commands.
+    wait(1000);
+
+    // Set the mfio pin to INPUT_PULLUP. It can be used to receive interrupts.
+    pinMode(mfio_pin, INPUT_PULLUP);
+
+    // Read the device's operating mode
+    uint8_t status_byte = ReadDeviceMode(device_mode);
+
+    // Find out which hub this is, so the rest of the driver can match it. A hub that cannot be
+    // identified is still usable, so this does not change the result returned to the caller.
+    if (status_byte == MAX32664_ReadStatusByteValue::SUCCESS_STATUS && device_mode == MAX32664_DeviceOperatingMode::ApplicationMode)
+    {
+        DetectCapabilities();
+    }
+
+    return status_byte;
+}
+
+/// @brief Resets the MAX32664 (e.g. to bring it back from shutdown), but instead of always waiting
+///     the full second that Begin() does, polls the device mode until the hub reports that it is
+///     in application mode.
+/// @param device_mode the resulting operating mode of the MAX32664
+/// @param boot_timeout the longest time to wait for the hub, in milliseconds
+/// @return the resulting status byte of the last read operation
+uint8_t ReWire_MAX32664::Restart(uint8_t &device_mode, uint16_t boot_timeout)
+{
+    const uint16_t poll_interval = 50;
+
+    reset_hub();
+    wait(poll_interval);
+    pinMode(mfio_pin, INPUT_PULLUP);
+
+    uint16_t elapsed = poll_interval;
+    uint8_t status_byte = ReadDeviceMode(device_mode);
+    while ((status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS || device_mode != MAX32664_DeviceOperatingMode::ApplicationMode) && elapsed < boot_timeout)
+    {
+        wait(poll_interval);
+        elapsed += poll_interval;
+        status_byte = ReadDeviceMode(device_mode);
+    }
+
+    if (status_byte == MAX32664_ReadStatusByteValue::SUCCESS_STATUS && device_mode == MAX32664_DeviceOperatingMode::ApplicationMode)
+    {
+        DetectCapabilities();
+    }
+
+    return status_byte;
+}
+
+/// @brief Identifies the hub from its firmware version (10.x.x = MAX32664A, 20.x.x = B,
+///     30.x.x to 39.x.x = C, 40.x.x = D) and MCU type, and caches what it supports.
+///     Begin() and Restart() call this, so it only needs to be called directly after
+///     flashing new firmware.
+/// @return the status byte of the last read operation
+uint8_t ReWire_MAX32664::DetectCapabilities()
+{
+    memset(&capabilities, 0, sizeof(capabilities));
+
+    uint8_t status_byte = ReadSensorHubVersion(capabilities.firmware_major, capabilities.firmware_minor, capabilities.firmware_revision);
+    if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        return status_byte;
+    }
+
+    status_byte = getMCUType(capabilities.mcu_type);
+    if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        return status_byte;
+    }
+
+    // Firmware versions are packed as MMmmrr so they can be compared as one number
+    uint32_t version = ((uint32_t)capabilities.firmware_major << 16) | ((uint32_t)capabilities.firmware_minor << 8) | capabilities.firmware_revision;
+
+    capabilities.sensor_record_size = 12;
+    switch (capabilities.firmware_major / 10)
+    {
+    case 1:
+        // WHRM + SpO2 mode 1 report: HR, confidence, SpO2, state, status, interbeat interval
+        capabilities.variant = MAX32664_Variant::Variant_A;
+        capabilities.algorithm_record_size = 9;
+        break;
+    case 2:
+        capabilities.variant = MAX32664_Variant::Variant_B;
+        break;
+    case 3:
+        capabilities.variant = MAX32664_Variant::Variant_C;
+        break;
+    case 4:
+        // BPT report: status, progress, HR, SBP, DBP, SpO2, R, pulse flag, IBI, confidence, reports
+        capabilities.variant = MAX32664_Variant::Variant_D;
+        capabilities.algorithm_record_size = 17;
+        capabilities.has_bpt = true;
+        capabilities.needs_legacy_bpt_settings = version < 0x280202;
+        capabilities.has_bpt_calibration_index = version >= 0x280500;
+        break;
+    default:
+        capabilities.variant = MAX32664_Variant::Variant_Unknown;
+        break;
+    }
+    capabilities.detected = (capabilities.variant != MAX32664_Variant::Variant_Unknown);
+
+    return status_byte;
+}
+
+/// @brief Returns the size of one sample in the output FIFO for the detected hub and the
+///     configured output mode
+/// @return the sample size in bytes, or 0 if it is not known
+uint8_t ReWire_MAX32664::GetSampleSize()
+{
+    if (output_format == OUTPUT_FORMAT_UNKNOWN || !capabilities.detected)
+    {
+        return 0;
+    }
+
+    uint8_t sample_size = 0;
+    if (output_format & MAX32664_OutputModeFormat::SensorData)
+    {
+        sample_size += capabilities.sensor_record_size;
+    }
+    if (output_format & MAX32664_OutputModeFormat::AlgorithmData)
+    {
+        if (capabilities.algorithm_record_size == 0)
+        {
+            return 0;
+        }
+        sample_size += capabilities.algorithm_record_size;
+    }
+    if ((output_format & MAX32664_OutputModeFormat::SampleCounterByte_Pause_NoData) && sample_size > 0)
+    {
+        sample_size += 1;
+    }
+    return sample_size;
+}
+
+/// @brief Runs the sensor + algorithm configuration that matches the detected hub
+/// @return The status result, or ERR_UNAVAIL_FUNC if the hub is not one this library supports
+///     (or its variant was compiled out, see MAX32664_Config.h)
+uint8_t ReWire_MAX32664::ConfigureDevice()
+{
+    switch (capabilities.variant)
+    {
+#if MAX32664_ENABLE_VARIANT_A
+    case MAX32664_Variant::Variant_A:
+        return ConfigureDevice_SensorAndAlgorithm();
+#endif
+#if MAX32664_ENABLE_VARIANT_D
+    case MAX32664_Variant::Variant_D:
+        return ConfigureBPT_SensorAndAlgorithm();
+#endif
+    default:
+        return MAX32664_ReadStatusByteValue::ERR_UNAVAIL_FUNC;
+    }
+}
+
+/// @brief Checks that a record of the given layout can be read, so a read does not mis-decode
+///     the data of a different hub variant or output mode. Anything the driver does not know
+///     about (hub not identified, output mode never set) is let through.
+/// @param variant the hub variant the layout belongs to, or Variant_Unknown for any hub
+/// @param format the output mode the layout belongs to
+/// @return true if the record can be read
+bool ReWire_MAX32664::record_matches(uint8_t variant, uint8_t format)
+{
+    if (capabilities.detected && variant != MAX32664_Variant::Variant_Unknown && capabilities.variant != variant)
+    {
+        return false;
+    }
+    return output_format == OUTPUT_FORMAT_UNKNOWN || output_format == format;
+}
+
+void ReWire_MAX32664::reset_hub()
+{
+    // The reset clears the output mode
+    output_format = OUTPUT_FORMAT_UNKNOWN;
+#if MAX32664_ENABLE_EVENTS
+    last_algorithm_state = MAX32664_EVENT_UNKNOWN;
+    last_bp_status = MAX32664_EVENT_UNKNOWN;
+    last_progress = MAX32664_EVENT_UNKNOWN;
+#endif
+
     // Set the MFIO and reset pins to be output pins
     pinMode(mfio_pin, OUTPUT);
     pinMode(reset_pin, OUTPUT);
@@ -40,35 +435,33 @@ uint8_t ReWire_MAX32664::Begin(uint8_t &device_mode)
     // and also set the MFIO pin high.
     digitalWrite(mfio_pin, HIGH);
     digitalWrite(reset_pin, LOW);
-    delay(10);
+    wait(10);
 
     // As described in the datasheet, after 10 ms has elapsed, we must set the reset pin to high.
     digitalWrite(reset_pin, HIGH);
-
-    // After approximately 50 ms, the MAX32664 is now in "application mode".
-    // After approximately 1 second from when the reset pin was set to high, the application should have
-    // completed initialization and the device is now ready to accept I2C commands.
-    delay(1000);
-
-    // Set the mfio pin to INPUT_PULLUP. It can be used to receive interrupts.
-    pinMode(mfio_pin, INPUT_PULLUP);
-
-    // Read the device's operating mode and return the result to the caller
-    uint8_t status_byte = ReadDeviceMode(device_mode);
-    return status_byte;
 }
 
+#if MAX32664_ENABLE_VARIANT_A
 /// @brief Reads a single sample from the output fifo, working under the assumption the sample
 ///     is a sensor+algorithm sample w/o accelerometer (so 21 bytes in size)
 /// @param sample The sample
 /// @return The status of the read operation
 uint8_t ReWire_MAX32664::ReadSample_SensorAndAlgorithm(MAX32664_Data &sample)
 {
+    if (!record_matches(MAX32664_Variant::Variant_A, MAX32664_OutputModeFormat::SensorData_And_AlgorithmData))
+    {
+        return MAX32664_ReadStatusByteValue::ERR_RECORD_MISMATCH;
+    }
+
     uint8_t read_length = 21;
     uint8_t read_buffer[21] = {0};
 
     // Read the sample
     uint8_t read_status = ReadOutputFifo(read_buffer, read_length);
+    if (read_status == MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        count_sample();
+    }
 
     // Parse the sample
     uint32_t ir0 = ((uint32_t)read_buffer[0]) << 16;
@@ -99,7 +492,14 @@ uint8_t ReWire_MAX32664::ReadSample_SensorAndAlgorithm(MAX32664_Data &sample)
     sample.spo2 = spo2;
     sample.algorithm_state = read_buffer[17];
     sample.algorithm_status = read_buffer[18];
-    sample.interbeat_interval = ((read_buffer[19] << 8) | read_buffer[20]) / 1000;
+    sample.interbeat_interval = (read_buffer[19] << 8) | read_buffer[20];
+
+#if MAX32664_ENABLE_EVENTS
+    if (read_status == MAX32664_ReadStatusByteValue::SUCCESS_STATUS && event_mask != 0)
+    {
+        raise_state_events(sample);
+    }
+#endif
 
     // Return the result of the read operation
     return read_status;
@@ -118,7 +518,7 @@ uint8_t ReWire_MAX32664::ConfigureDevice_SensorAndAlgorithm()
     // Step 1.2: Set output mode to sensor + algorithm data (0x03, streamed data will include
     //   PPG and algorithm data, but NOT accelerometer data).
     uint8_t status_byte = SetOutputMode_OutputFormat(MAX32664_OutputModeFormat::SensorData_And_AlgorithmData);
-    delay(10);
+    wait(10);
 
     // Check to make sure the operation was successful
     if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
@@ -126,9 +526,10 @@ uint8_t ReWire_MAX32664::ConfigureDevice_SensorAndAlgorithm()
         return status_byte;
     }
 
-    // Step 1.3: Set sensor hub interrupt threshold to 0x0F (the value used in the datasheet example).
-    status_byte = SetOutputMode_FifoInterruptThreshold(0x0F);
-    delay(10);
+    // Step 1.3: Set sensor hub interrupt threshold (0x0F, the value used in the datasheet example,
+    //   unless a low-latency event subscriber lowered it).
+    status_byte = SetOutputMode_FifoInterruptThreshold(fifo_threshold);
+    wait(10);
 
     // Check to make sure the operation was successful
     if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
@@ -138,7 +539,7 @@ uint8_t ReWire_MAX32664::ConfigureDevice_SensorAndAlgorithm()
 
     // Step 1.4: Enable the AGC (automatic gain control)
     status_byte = SetAlgorithmMode_EnableAGC(true);
-    delay(200);
+    wait(200);
 
     // Check to make sure the operation was successful
     if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
@@ -152,7 +553,7 @@ uint8_t ReWire_MAX32664::ConfigureDevice_SensorAndAlgorithm()
 
     // Step 1.6: Enable the AFE ("analog front end" - the MAX30101 in this case)
     status_byte = EnableSensor(true);
-    delay(40);
+    wait(40);
 
     // Check to make sure the operation was successful
     if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
@@ -162,11 +563,12 @@ uint8_t ReWire_MAX32664::ConfigureDevice_SensorAndAlgorithm()
 
     // Step 1.7: Enable the HR/SpO2 algorithm.
     status_byte = EnableAlgorithmMode_MaximFast(0x01);
-    delay(10);
+    wait(10);
 
     // Return the result of the final operation
     return status_byte;
 }
+#endif
 
 /// @brief Reads the status of the sensor hub
 /// @param status the sensor hub status
@@ -191,6 +593,19 @@ uint8_t ReWire_MAX32664::ConfigureDevice_SensorAndAlgorithm()
 uint8_t ReWire_MAX32664::ReadSensorHubStatus(uint8_t &status)
 {
     uint8_t status_byte = read_byte(MAX32664_CommandFamilyByte::ReadSensorHubStatus, 0x00, status);
+    if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        return status_byte;
+    }
+
+    MAX32664_STAT(stats.fifo_out_overflows += (status >> 4) & 0x01);
+    MAX32664_STAT(stats.fifo_in_overflows += (status >> 5) & 0x01);
+#if MAX32664_ENABLE_EVENTS
+    if (status & 0x30)
+    {
+        raise_event(Event_FifoOverflow, MAX32664_EVENT_UNKNOWN, status);
+    }
+#endif
     return status_byte;
 }
 
@@ -210,22 +625,14 @@ uint8_t ReWire_MAX32664::ReadDeviceMode(uint8_t &device_mode)
 /// @return the status byte of the read operation
 uint8_t ReWire_MAX32664::ReadSensorHubVersion(uint8_t &major_version, uint8_t &minor_version, uint8_t &revision_number)
 {
-    uint8_t status_byte;
+    // The identity command is answered immediately, so there is no command delay here.
+    uint8_t command[2] = {MAX32664_CommandFamilyByte::ReadIdentity, 0x03};
+    uint8_t version[3] = {0};
+    uint8_t status_byte = transfer(TracePrimitive_ReadMultipleBytes, command, 2, NULL, 0, 0, version, 3);
 
-    wire_instance->beginTransmission(max32664_i2c_address);
-    wire_instance->write(MAX32664_CommandFamilyByte::ReadIdentity);
-    wire_instance->write(0x03);
-    wire_instance->endTransmission();
-
-    wire_instance->requestFrom(max32664_i2c_address, 4);
-    status_byte = wire_instance->read();
-    delayMicroseconds(10);
-    major_version = wire_instance->read();
-    delayMicroseconds(10);
-    minor_version = wire_instance->read();
-    delayMicroseconds(10);
-    revision_number = wire_instance->read();
-    delayMicroseconds(10);
+    major_version = version[0];
+    minor_version = version[1];
+    revision_number = version[2];
 
     return status_byte;
 }
@@ -235,7 +642,12 @@ uint8_t ReWire_MAX32664::ReadSensorHubVersion(uint8_t &major_version, uint8_t &m
 /// @return the status byte of the write operation
 uint8_t ReWire_MAX32664::SetDeviceOperatingMode(MAX32664_DeviceOperatingMode operating_mode)
 {
-    return write_byte(MAX32664_CommandFamilyByte::SetDeviceMode, 0x00, operating_mode);
+    uint8_t status_byte = write_byte(MAX32664_CommandFamilyByte::SetDeviceMode, 0x00, operating_mode);
+    if (operating_mode != MAX32664_DeviceOperatingMode::ApplicationMode)
+    {
+        output_format = OUTPUT_FORMAT_UNKNOWN;
+    }
+    return status_byte;
 }
 
 /// @brief Sets the output format of the sensor data
@@ -243,7 +655,9 @@ uint8_t ReWire_MAX32664::SetDeviceOperatingMode(MAX32664_DeviceOperatingMode ope
 /// @return the status byte of the write operation
 uint8_t ReWire_MAX32664::SetOutputMode_OutputFormat(MAX32664_OutputModeFormat output_format)
 {
-    return write_byte(MAX32664_CommandFamilyByte::SetOutputMode, 0x00, output_format);
+    uint8_t status_byte = write_byte(MAX32664_CommandFamilyByte::SetOutputMode, 0x00, output_format);
+    this->output_format = (status_byte == MAX32664_ReadStatusByteValue::SUCCESS_STATUS) ? output_format : OUTPUT_FORMAT_UNKNOWN;
+    return status_byte;
 }
 
 /// @brief Sets the threshold for the FIFO interrupt bit/pin. The MFIO pin is used as the interrupt pin.
@@ -283,18 +697,14 @@ uint8_t ReWire_MAX32664::EnableAlgorithmMode_MaximFast(uint8_t mode)
 /// @return the status byte of the read operation
 uint8_t ReWire_MAX32664::ReadNumberAvailableSamples(uint8_t &num_samples)
 {
-    uint8_t status_byte;
-
-    wire_instance->beginTransmission(max32664_i2c_address);
-    wire_instance->write(MAX32664_CommandFamilyByte::ReadOutputFIFO);
-    wire_instance->write(0x00);
-    wire_instance->endTransmission();
-    delay(MAX32664_COMMAND_DELAY);
-
-    wire_instance->requestFrom(max32664_i2c_address, 2);
-    status_byte = wire_instance->read();
-    num_samples = wire_instance->read();
-
+    uint8_t status_byte = read_byte(MAX32664_CommandFamilyByte::ReadOutputFIFO, 0x00, num_samples);
+#if MAX32664_ENABLE_STATS
+    if (status_byte == MAX32664_ReadStatusByteValue::SUCCESS_STATUS && num_samples > 0)
+    {
+        drain_start_us = micros();
+        drain_remaining = num_samples;
+    }
+#endif
     return status_byte;
 }
 
@@ -307,114 +717,257 @@ uint8_t ReWire_MAX32664::ReadOutputFifo(uint8_t *read_buffer, uint8_t read_lengt
     return read_multiple_bytes(MAX32664_CommandFamilyByte::ReadOutputFIFO, 0x01, read_buffer, read_length);
 }
 
-uint8_t ReWire_MAX32664::read_byte(uint8_t data1, uint8_t data2, uint8_t &return_byte)
+#if MAX32664_ENABLE_INPUT_FIFO
+/// @brief Reads the size of one sample in the input FIFO, i.e. of the data the host supplies
+///     (6 bytes for the accelerometer: X, Y and Z as 16-bit values, MSB first)
+/// @param sample_size the sample size in bytes
+/// @return the status byte of the read operation
+uint8_t ReWire_MAX32664::ReadInputFifoSampleSize(uint8_t &sample_size)
 {
-    uint8_t status_byte;
+    return read_byte(MAX32664_CommandFamilyByte::ReadInputFIFO, 0x00, sample_size);
+}
 
-    wire_instance->beginTransmission(max32664_i2c_address);
-    wire_instance->write(data1);
-    wire_instance->write(data2);
-    wire_instance->endTransmission();
-    delay(MAX32664_COMMAND_DELAY);
+/// @brief Reads how many samples the input FIFO can hold
+/// @param max_samples the capacity of the input FIFO
+/// @return the status byte of the read operation
+uint8_t ReWire_MAX32664::ReadInputFifoSize(uint16_t &max_samples)
+{
+    return read_word(MAX32664_CommandFamilyByte::ReadInputFIFO, 0x01, max_samples);
+}
 
-    wire_instance->requestFrom(max32664_i2c_address, 2);
-    status_byte = wire_instance->read();
-    return_byte = wire_instance->read();
-    return status_byte;
+/// @brief Reads how many samples the sensor FIFO (where the hub collects the input of the
+///     algorithm) can hold
+/// @param max_samples the capacity of the sensor FIFO
+/// @return the status byte of the read operation
+uint8_t ReWire_MAX32664::ReadSensorFifoSize(uint16_t &max_samples)
+{
+    return read_word(MAX32664_CommandFamilyByte::ReadInputFIFO, 0x02, max_samples);
 }
 
-uint8_t ReWire_MAX32664::read_multiple_bytes(uint8_t data1, uint8_t data2, uint8_t *read_buffer, uint8_t read_length)
+/// @brief Reads the number of samples waiting in the input FIFO
+/// @param num_samples the number of samples
+/// @return the status byte of the read operation
+uint8_t ReWire_MAX32664::ReadInputFifoCount(uint16_t &num_samples)
 {
-    uint8_t status_byte;
+    return read_word(MAX32664_CommandFamilyByte::ReadInputFIFO, 0x03, num_samples);
+}
+
+/// @brief Reads the number of samples waiting in the sensor FIFO
+/// @param num_samples the number of samples
+/// @return the status byte of the read operation
+uint8_t ReWire_MAX32664::ReadSensorFifoCount(uint16_t &num_samples)
+{
+    return read_word(MAX32664_CommandFamilyByte::ReadInputFIFO, 0x04, num_samples);
+}
 
-    wire_instance->beginTransmission(max32664_i2c_address);
-    wire_instance->write(data1);
-    wire_instance->write(data2);
-    wire_instance->endTransmission();
-    delay(MAX32664_COMMAND_DELAY);
+/// @brief Writes samples to the input FIFO in one transaction. Samples that do not fit are lost
+///     and the hub sets FifoInOvrInt (see ReadSensorHubStatus()).
+/// @param samples whole samples of ReadInputFifoSampleSize() bytes each
+/// @param length the number of bytes to write; the command and the samples must fit in the
+///     buffer of the I2C driver (32 bytes on AVR, 128 on ESP32)
+/// @return the status byte of the write operation
+uint8_t ReWire_MAX32664::WriteInputFifo(const uint8_t *samples, uint16_t length)
+{
+    uint8_t command[2] = {MAX32664_CommandFamilyByte::WriteInputFIFO, 0x00};
+    return transfer(TracePrimitive_WriteMultipleBytes, command, 2, samples, length, MAX32664_COMMAND_DELAY, NULL, 0);
+}
+
+/// @brief Enables the accelerometer input of the algorithm with data supplied by the host through
+///     WriteInputFifo() instead of an accelerometer attached to the hub. Send it before the
+///     algorithm is enabled (step 1.5 of Table 8 in the MAX32664A user guide).
+/// @param enable 0 = disable, 1 = enable
+/// @return the status byte of the write operation
+uint8_t ReWire_MAX32664::EnableHostAccelerometer(bool enable)
+{
+    uint8_t command[4] = {MAX32664_CommandFamilyByte::EnableSensorMode, 0x04, enable, 0x01};
+    return transfer(TracePrimitive_WriteByte, command, enable ? 4 : 3, NULL, 0, 20, NULL, 0);
+}
+#endif
+
+/// @brief Performs one complete hub transaction: writes the command, waits for the hub to
+///     process it and reads back the status byte followed by the response bytes.
+/// @param primitive the helper that sent the command (MAX32664_TracePrimitive), for the trace
+/// @param command the family byte, index byte and (optionally) the first write byte
+/// @param command_length the number of bytes in command
+/// @param payload any additional write bytes (may be NULL)
+/// @param payload_length the number of bytes in payload
+/// @param cmd_delay the time the hub needs to process the command, in milliseconds
+/// @param read_buffer the buffer to hold the response bytes
+/// @param read_length the number of response bytes to read
+/// @return the status byte sent by the hub
+uint8_t ReWire_MAX32664::transfer(uint8_t primitive, const uint8_t *command, uint8_t command_length, const uint8_t *payload, uint16_t payload_length, uint16_t cmd_delay, uint8_t *read_buffer, uint16_t read_length)
+{
+    uint8_t status_byte;
+#if MAX32664_TRACE_DEPTH > 0
+    uint32_t start_us = micros();
+#endif
 
-    wire_instance->requestFrom(max32664_i2c_address, read_length + 1);
-    status_byte = wire_instance->read();
-    for (int i = 0; i < read_length; ++i)
+    uint8_t write_result = bus->Write(max32664_i2c_address, command, command_length, payload, payload_length);
+    if (cmd_delay > 0)
     {
-        read_buffer[i] = wire_instance->read();
-        delayMicroseconds(1);
+        wait(cmd_delay);
     }
+    uint16_t received = bus->Read(max32664_i2c_address, status_byte, read_buffer, read_length);
+    if (received < read_length + 1 && status_byte == MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        // The missing bytes read back as 0xFF, so the data cannot be used
+        status_byte = MAX32664_ReadStatusByteValue::ERR_SHORT_READ;
+    }
+
+#if MAX32664_ENABLE_STATS
+    MAX32664_FamilyStats &family = stats.family[stats_family(command[0])];
+    family.transactions++;
+    family.bytes_written += command_length + payload_length;
+    family.bytes_read += received;
+    stats.write_errors += (write_result != 0);
+    stats.short_reads += (received < read_length + 1);
+    stats.try_again += (status_byte == MAX32664_ReadStatusByteValue::ERR_TRY_AGAIN);
+#else
+    (void)write_result;
+#endif
+
+#if MAX32664_TRACE_DEPTH > 0
+    MAX32664_TraceRecord &record = trace[trace_count++ & (MAX32664_TRACE_DEPTH - 1)];
+    record.start_us = start_us;
+    record.end_us = micros();
+    record.length = command_length + payload_length + read_length + 1;
+    record.family = command[0];
+    record.index = command[1];
+    record.status = status_byte;
+    record.primitive = primitive;
+#else
+    (void)primitive;
+#endif
 
     return status_byte;
 }
 
-uint8_t ReWire_MAX32664::write_byte(uint8_t data1, uint8_t data2, uint8_t data3)
+void ReWire_MAX32664::wait(uint16_t milliseconds)
 {
-    wire_instance->beginTransmission(max32664_i2c_address);
-    wire_instance->write(data1);
-    wire_instance->write(data2);
-    wire_instance->write(data3);
-    wire_instance->endTransmission();
-    delay(MAX32664_COMMAND_DELAY);
+    bus->Wait(milliseconds);
+    MAX32664_STAT(stats.delay_ms += milliseconds);
+}
 
-    wire_instance->requestFrom(max32664_i2c_address, 1);
-    uint8_t status_byte = wire_instance->read();
-    return status_byte;
+/// @brief Counts a sample read from the output FIFO and tracks how long the current drain took
+void ReWire_MAX32664::count_sample()
+{
+#if MAX32664_ENABLE_STATS
+    stats.samples++;
+    if (drain_remaining > 0 && --drain_remaining == 0)
+    {
+        uint32_t latency = micros() - drain_start_us;
+        if (latency > stats.max_drain_latency_us)
+        {
+            stats.max_drain_latency_us = latency;
+        }
+    }
+#endif
 }
 
-uint8_t ReWire_MAX32664::write_byte_with_custom_cmd_delay(uint8_t data1, uint8_t data2, uint8_t data3, uint16_t cmd_delay)
+#if MAX32664_ENABLE_EVENTS
+void ReWire_MAX32664::raise_event(uint8_t type, uint8_t previous, uint8_t current)
 {
-    wire_instance->beginTransmission(max32664_i2c_address);
-    wire_instance->write(data1);
-    wire_instance->write(data2);
-    wire_instance->write(data3);
-    wire_instance->endTransmission();
-    delay(cmd_delay);
+    if (!(event_mask & type))
+    {
+        return;
+    }
 
-    wire_instance->requestFrom(max32664_i2c_address, 1);
-    uint8_t status_byte = wire_instance->read();
-    return status_byte;
+    MAX32664_Event event;
+    memset(&event, 0, sizeof(event));
+    event.type = type;
+    event.previous = previous;
+    event.current = current;
+    event.time_us = micros();
+    event_callback(event, event_context);
 }
 
-uint8_t ReWire_MAX32664::write_multiple_bytes(uint8_t data1, uint8_t data2, uint8_t data3, uint8_t *buffer, uint16_t buffer_size)
+/// @brief Raises the events of a decoded MAX32664A record
+void ReWire_MAX32664::raise_state_events(const MAX32664_Data &sample)
 {
-    wire_instance->beginTransmission(max32664_i2c_address);
-    wire_instance->write(data1);
-    wire_instance->write(data2);
-    wire_instance->write(data3);
-    // wire_instance->write((const uint8_t *)buffer,(size_t) buffer_size);
-    for (uint16_t i = 0; i < buffer_size; ++i)
+    if (sample.algorithm_state != last_algorithm_state)
     {
-        wire_instance->write(buffer[i]);
-        delayMicroseconds(1);
+        raise_event(Event_AlgorithmState, last_algorithm_state, sample.algorithm_state);
+        last_algorithm_state = sample.algorithm_state;
     }
-    wire_instance->endTransmission();
-    delay(MAX32664_COMMAND_DELAY);
-
-    wire_instance->requestFrom(max32664_i2c_address, 1);
-    uint8_t status_byte = wire_instance->read();
-    return status_byte;
 }
-uint8_t ReWire_MAX32664::write_multiple_bytes(uint8_t data1, uint8_t data2, uint8_t data3, uint8_t *buffer, uint16_t buffer_size, uint16_t cmd_delay)
+
+/// @brief Raises the events of a decoded MAX32664D record
+void ReWire_MAX32664::raise_state_events(const MAX32664_Data_VerD &sample)
 {
-    wire_instance->beginTransmission(max32664_i2c_address);
-    wire_instance->write(data1);
-    wire_instance->write(data2);
-    wire_instance->write(data3);
-    wire_instance->write((const uint8_t *)buffer, (size_t)buffer_size);
-    /*for (uint16_t i = 0; i < buffer_size; ++i)
+    if (sample.pulse_flag && (event_mask & Event_Beat))
     {
-        wire_instance->write(buffer[i]);
-        delayMicroseconds(1);
-    }*/
-    wire_instance->endTransmission();
-    delay(cmd_delay);
+        MAX32664_Event event;
+        memset(&event, 0, sizeof(event));
+        event.type = Event_Beat;
+        event.previous = MAX32664_EVENT_UNKNOWN;
+        event.current = sample.pulse_flag;
+        event.ibi_ms = (uint16_t)sample.ibi;
+        event.hr = sample.hr;
+        event.time_us = micros();
+        event_callback(event, event_context);
+    }
+    if (sample.bp_status != last_bp_status)
+    {
+        raise_event(Event_BptStatus, last_bp_status, sample.bp_status);
+        last_bp_status = sample.bp_status;
+    }
+    if (sample.progress != last_progress)
+    {
+        raise_event(Event_BptProgress, last_progress, sample.progress);
+        last_progress = sample.progress;
+    }
+}
+#endif
+
+uint8_t ReWire_MAX32664::read_byte(uint8_t data1, uint8_t data2, uint8_t &return_byte)
+{
+    uint8_t command[2] = {data1, data2};
+    return transfer(TracePrimitive_ReadByte, command, 2, NULL, 0, MAX32664_COMMAND_DELAY, &return_byte, 1);
+}
 
-    wire_instance->requestFrom(max32664_i2c_address, 1);
-    uint8_t status_byte = wire_instance->read();
+uint8_t ReWire_MAX32664::read_multiple_bytes(uint8_t data1, uint8_t data2, uint8_t *read_buffer, uint8_t read_length)
+{
+    uint8_t command[2] = {data1, data2};
+    return transfer(TracePrimitive_ReadMultipleBytes, command, 2, NULL, 0, MAX32664_COMMAND_DELAY, read_buffer, read_length);
+}
+
+#if MAX32664_ENABLE_INPUT_FIFO
+uint8_t ReWire_MAX32664::read_word(uint8_t data1, uint8_t data2, uint16_t &return_word)
+{
+    uint8_t read_buffer[2] = {0};
+    uint8_t status_byte = read_multiple_bytes(data1, data2, read_buffer, 2);
+    return_word = ((uint16_t)read_buffer[0] << 8) | read_buffer[1];
     return status_byte;
 }
-uint8_t ReWire_MAX32664::loadBPTCalibVector(uint8_t *buffer, uint16_t buffer_size)
+#endif
+
+uint8_t ReWire_MAX32664::write_byte(uint8_t data1, uint8_t data2, uint8_t data3)
+{
+    return write_byte_with_custom_cmd_delay(data1, data2, data3, MAX32664_COMMAND_DELAY);
+}
+
+uint8_t ReWire_MAX32664::write_byte_with_custom_cmd_delay(uint8_t data1, uint8_t data2, uint8_t data3, uint16_t cmd_delay)
+{
+    uint8_t command[3] = {data1, data2, data3};
+    return transfer(TracePrimitive_WriteByte, command, 3, NULL, 0, cmd_delay, NULL, 0);
+}
+
+uint8_t ReWire_MAX32664::write_multiple_bytes(uint8_t data1, uint8_t data2, uint8_t data3, const uint8_t *buffer, uint16_t buffer_size)
+{
+    return write_multiple_bytes(data1, data2, data3, buffer, buffer_size, MAX32664_COMMAND_DELAY);
+}
+uint8_t ReWire_MAX32664::write_multiple_bytes(uint8_t data1, uint8_t data2, uint8_t data3, const uint8_t *buffer, uint16_t buffer_size, uint16_t cmd_delay)
+{
+    uint8_t command[3] = {data1, data2, data3};
+    return transfer(TracePrimitive_WriteMultipleBytes, command, 3, buffer, buffer_size, cmd_delay, NULL, 0);
+}
+#if MAX32664_ENABLE_VARIANT_D
+uint8_t ReWire_MAX32664::loadBPTCalibVector(const uint8_t *buffer, uint16_t buffer_size)
 {
     uint8_t status = write_multiple_bytes(MAX32664_CommandFamilyByte::SetAlgorithmConfiguration, 0x04, MAX32664_ConfigrationIndex::BPCalibrationData, buffer, buffer_size, 30);
     return status;
 }
+#endif
 
 uint8_t ReWire_MAX32664::setDataTime()
 {
@@ -446,10 +999,26 @@ uint8_t ReWire_MAX32664::loadSpo2Coefficients(float spo2CalibCoefA, float spo2Ca
     spo2CoefBuffer[11] = (C & 0x000000ff);
 
     uint8_t status = write_multiple_bytes(MAX32664_CommandFamilyByte::SetAlgorithmConfiguration, 0x04, MAX32664_ConfigrationIndex::SpO2CalibrationCoefficients, spo2CoefBuffer, 12, 5);
+    if (status == MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        spo2_coefficients[0] = spo2CalibCoefA;
+        spo2_coefficients[1] = spo2CalibCoefB;
+        spo2_coefficients[2] = spo2CalibCoefC;
+    }
 
     return status;
 }
 
+/// @brief Returns the SpO2 calibration coefficients last loaded into the hub (or the defaults
+///     from the documentation), e.g. to give a host-side MAX32664_PpgPipeline the same calibration
+void ReWire_MAX32664::GetSpo2Coefficients(float &spo2CalibCoefA, float &spo2CalibCoefB, float &spo2CalibCoefC)
+{
+    spo2CalibCoefA = spo2_coefficients[0];
+    spo2CalibCoefB = spo2_coefficients[1];
+    spo2CalibCoefC = spo2_coefficients[2];
+}
+
+#if MAX32664_ENABLE_VARIANT_D
 uint8_t ReWire_MAX32664::EnableBPT_Algorithm(uint8_t mode)
 {
     return write_byte_with_custom_cmd_delay(MAX32664_CommandFamilyByte::EnableAlgorithm, 0x04, mode, 600);
@@ -457,11 +1026,20 @@ uint8_t ReWire_MAX32664::EnableBPT_Algorithm(uint8_t mode)
 
 uint8_t ReWire_MAX32664::ReadSample_BPTSensorAndAlgorithm(MAX32664_Data_VerD &sample)
 {
+    if (!record_matches(MAX32664_Variant::Variant_D, MAX32664_OutputModeFormat::SensorData_And_AlgorithmData))
+    {
+        return MAX32664_ReadStatusByteValue::ERR_RECORD_MISMATCH;
+    }
+
     uint8_t read_length = 29;
     uint8_t read_buffer[29] = {0};
 
     // Read the sample
     uint8_t read_status = ReadOutputFifo(read_buffer, read_length);
+    if (read_status == MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        count_sample();
+    }
 
     // Parse the sample
     uint32_t ir0 = ((uint32_t)read_buffer[0]) << 16;
@@ -476,15 +1054,12 @@ uint8_t ReWire_MAX32664::ReadSample_BPTSensorAndAlgorithm(MAX32664_Data_VerD &sa
 
     uint16_t hr = (uint16_t(read_buffer[14]) << 8);
     hr |= (read_buffer[15]);
-    // hr /= 10;
 
     uint16_t spo2 = uint16_t(read_buffer[18]) << 8;
     spo2 |= read_buffer[19];
-    // spo2 /= 10;
 
     uint16_t r_value = uint16_t(read_buffer[20]) << 8;
     r_value |= read_buffer[21];
-    // r_value /= 1000;
 
     uint16_t ibi_value = uint16_t(read_buffer[23]) << 8;
     ibi_value |= read_buffer[24];
@@ -494,46 +1069,91 @@ uint8_t ReWire_MAX32664::ReadSample_BPTSensorAndAlgorithm(MAX32664_Data_VerD &sa
     sample.red = red_final;
     sample.bp_status = read_buffer[12];
     sample.progress = read_buffer[13];
-    sample.hr = hr / 10;
+    // HR and SpO2 are sent in tenths, R in thousandths
+    sample.hr = hr / 10.0f;
     sample.sys_bp = read_buffer[16];
     sample.dia_bp = read_buffer[17];
-    sample.spo2 = spo2 / 10;
-    sample.r_value = r_value / 1000;
+    sample.spo2 = spo2 / 10.0f;
+    sample.r_value = r_value / 1000.0f;
     sample.pulse_flag = read_buffer[22];
     sample.ibi = ibi_value;
     sample.spo2_conf = read_buffer[25];
     sample.bpt_report = read_buffer[26];
-    sample.spo2_report = read_buffer[28];
+    sample.spo2_report = read_buffer[27];
+    sample.end_bpt = read_buffer[28];
+
+#if MAX32664_ENABLE_EVENTS
+    if (read_status == MAX32664_ReadStatusByteValue::SUCCESS_STATUS && event_mask != 0)
+    {
+        raise_state_events(sample);
+    }
+#endif
+
     // Return the result of the read operation
     return read_status;
 }
 
-uint8_t ReWire_MAX32664::ConfigureBPT_SensorAndAlgorithm()
+/// @brief Loads the calibration vectors and starts the BPT estimation algorithm
+/// @param calibration_vectors count * CALIBVECTOR_SIZE bytes, the vector of each cal_index (e.g.
+///     from MAX32664_CalibrationSession). When NULL, the sample vectors are loaded if they are
+///     compiled in (MAX32664_ENABLE_SAMPLE_CALIBRATION); otherwise the hub keeps the vectors it has.
+/// @param count the number of vectors, 1 to MAX32664_CALIBRATION_POINTS
+/// @return The status result
+uint8_t ReWire_MAX32664::ConfigureBPT_SensorAndAlgorithm(const uint8_t *calibration_vectors, uint8_t count)
 {
     // In this function, we are following the steps outlined in Table 8 (section 3.2) of
     //   the document "measuring-heart-rate-and-spo2-using-the-max32664a.pdf".
 
+    if (count == 0 || count > MAX32664_CALIBRATION_POINTS)
+    {
+        return MAX32664_ReadStatusByteValue::ERR_INPUT_VALUE;
+    }
+    const uint8_t *vectors = calibration_vectors;
+#if MAX32664_ENABLE_SAMPLE_CALIBRATION
+    uint8_t sample_vector[CALIBVECTOR_SIZE];
+    if (vectors == NULL)
+    {
+        vectors = &calibVector[0][0];
+    }
+#endif
+
     // Step 1.1: Load 824 bytes of BPT calibration vector data
-    uint8_t status_byte = 255;
-    for (uint8_t i = 0; i < 5; ++i)
+    uint8_t status_byte = MAX32664_ReadStatusByteValue::SUCCESS_STATUS;
+    for (uint8_t i = 0; vectors != NULL && i < count; ++i)
     {
         status_byte = setCalibrationIndex(i);
         if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
         {
             return status_byte;
         }
-        // uint8_t buffer[CalibVectorSize];
-        // std::copy(calibVector, calibVector + CalibVectorSize, buffer);
 
-        status_byte = loadBPTCalibVector(calibVector[i], CALIBVECTOR_SIZE);
+        const uint8_t *vector = vectors + (uint16_t)i * CALIBVECTOR_SIZE;
+#if MAX32664_ENABLE_SAMPLE_CALIBRATION
+        if (calibration_vectors == NULL)
+        {
+            // The bus sends a payload from RAM
+            memcpy_P(sample_vector, vector, CALIBVECTOR_SIZE);
+            vector = sample_vector;
+        }
+#endif
+        status_byte = loadBPTCalibVector(vector, CALIBVECTOR_SIZE);
+        if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+        {
+            return status_byte;
+        }
+        wait(30);
+    }
+    // Step 1.2: Set whether the user is on BP medication.
+    // Step 1.3: Set whether the user is resting.
+    // THESE STEPS ARE NOT NEEDED IN FW VER. 40.2.2 AND LATER, so they are only sent to older hubs.
+    if (capabilities.detected && capabilities.needs_legacy_bpt_settings)
+    {
+        status_byte = configure_legacy_bpt_settings();
         if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
         {
             return status_byte;
         }
-        delay(30);
     }
-    // Step 1.2: THIS STEP IS NOT NEEDED IN FW VER. 40.2.2 AND LATER.
-    // Step 1.3: THIS STEP IS NOT NEEDED IN FW VER. 40.2.2 AND LATER.
 
     // Step 1.4: Set data and time as two 32-bit numbers for
     // YYMMDD and HHMMSS in little-endian format.
@@ -547,17 +1167,17 @@ uint8_t ReWire_MAX32664::ConfigureBPT_SensorAndAlgorithm()
     // Step 1.5: Set SpO_2 calibration coefficients as described in
     // the document. Provided example for:
     // A = 1.5958422, B = -34.659664, C = 112.68987
-    status_byte = loadSpo2Coefficients(1.5958422, -34.659664, 112.68987); //@note Default values from documentation (change)
+    status_byte = loadSpo2Coefficients(MAX32664_SPO2_COEF_A, MAX32664_SPO2_COEF_B, MAX32664_SPO2_COEF_C); //@note Default values from documentation (change)
     if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
     {
         return status_byte;
     }
-    delay(10);
+    wait(10);
 
     // Step 1.7: ąSet output mode to sensor + algorithm data
     //(streamed data will include PPG and algorithm data).
     status_byte = SetOutputMode_OutputFormat(MAX32664_OutputModeFormat::SensorData_And_AlgorithmData);
-    delay(10);
+    wait(10);
 
     // Check to make sure the operation was successful
     if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
@@ -565,9 +1185,10 @@ uint8_t ReWire_MAX32664::ConfigureBPT_SensorAndAlgorithm()
         return status_byte;
     }
 
-    // Step 1.8: Set sensor hub interrupt threshold to 0x0F (the value used in the datasheet example).
-    status_byte = SetOutputMode_FifoInterruptThreshold(0x0F);
-    delay(10);
+    // Step 1.8: Set sensor hub interrupt threshold (0x0F, the value used in the datasheet example,
+    //   unless a low-latency event subscriber lowered it).
+    status_byte = SetOutputMode_FifoInterruptThreshold(fifo_threshold);
+    wait(10);
 
     // Check to make sure the operation was successful
     if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
@@ -577,7 +1198,7 @@ uint8_t ReWire_MAX32664::ConfigureBPT_SensorAndAlgorithm()
 
     // Step 1.9: Enable the AGC (automatic gain control)
     status_byte = SetAlgorithmMode_EnableAGC(true);
-    delay(20);
+    wait(20);
     if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
     {
         return status_byte;
@@ -585,7 +1206,7 @@ uint8_t ReWire_MAX32664::ConfigureBPT_SensorAndAlgorithm()
 
     // Step 1.10: Enable the AFE ("analog front end" - the MAX30101 in this case)
     status_byte = EnableSensor(true);
-    delay(40);
+    wait(40);
 
     // Check to make sure the operation was successful
     if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
@@ -595,24 +1216,24 @@ uint8_t ReWire_MAX32664::ConfigureBPT_SensorAndAlgorithm()
 
     // Step 1.11: Enable the BPT Estimation algorithm.
     status_byte = EnableBPT_Algorithm(0x02);
-    if (status_byte == MAX32664_ReadStatusByteValue::ERR_TRY_AGAIN)
+    for (uint8_t retries = 0; status_byte == MAX32664_ReadStatusByteValue::ERR_TRY_AGAIN && retries < MAX32664_MAX_RETRIES; retries++)
     {
-        do
-        {
-            delay(10);
-            status_byte = EnableBPT_Algorithm(0x02);
-        } while (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS);
+        MAX32664_STAT(stats.retries++);
+        wait(10);
+        status_byte = EnableBPT_Algorithm(0x02);
     }
-    else if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
     {
         return status_byte;
     }
-    delay(100);
+    wait(100);
 
     // Return the result of the final operation
     return status_byte;
 }
+#endif
 
+#if MAX32664_ENABLE_RAW_OUTPUT
 uint8_t ReWire_MAX32664::ConfigureBPT_RawValue()
 {
     // In this function, we are following the steps outlined in Table 8 (section 3.2) of
@@ -621,7 +1242,7 @@ uint8_t ReWire_MAX32664::ConfigureBPT_RawValue()
     // Step 1.7: Set output mode to sensor + algorithm data
     //(streamed data will include PPG and algorithm data).
     uint8_t status_byte = SetOutputMode_OutputFormat(MAX32664_OutputModeFormat::SensorData);
-    delay(10);
+    wait(10);
 
     // Check to make sure the operation was successful
     if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
@@ -629,9 +1250,10 @@ uint8_t ReWire_MAX32664::ConfigureBPT_RawValue()
         return status_byte;
     }
 
-    // Step 1.8: Set sensor hub interrupt threshold to 0x0F (the value used in the datasheet example).
-    status_byte = SetOutputMode_FifoInterruptThreshold(0x0F);
-    delay(10);
+    // Step 1.8: Set sensor hub interrupt threshold (0x0F, the value used in the datasheet example,
+    //   unless a low-latency event subscriber lowered it).
+    status_byte = SetOutputMode_FifoInterruptThreshold(fifo_threshold);
+    wait(10);
 
     // Check to make sure the operation was successful
     if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
@@ -641,7 +1263,7 @@ uint8_t ReWire_MAX32664::ConfigureBPT_RawValue()
 
     // Step 1.10: Enable the AFE ("analog front end" - the MAX30101 in this case)
     status_byte = EnableSensor(true);
-    delay(1);
+    wait(1);
 
     // Check to make sure the operation was successful
     if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
@@ -652,38 +1274,34 @@ uint8_t ReWire_MAX32664::ConfigureBPT_RawValue()
     // Step 1.11: Enable the BPT Estimation algorithm.
     status_byte = EnableBPT_Algorithm(0x02);
 
-    if (status_byte == MAX32664_ReadStatusByteValue::ERR_TRY_AGAIN)
+    for (uint8_t retries = 0; status_byte == MAX32664_ReadStatusByteValue::ERR_TRY_AGAIN && retries < MAX32664_MAX_RETRIES; retries++)
     {
-        do
-        {
-            delay(10);
-            status_byte = EnableBPT_Algorithm(0x02);
-        } while (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS);
+        MAX32664_STAT(stats.retries++);
+        wait(10);
+        status_byte = EnableBPT_Algorithm(0x02);
     }
-    else if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
     {
         return status_byte;
     }
     // Step 1.9: Enable the AGC (automatic gain control)
     status_byte = SetAlgorithmMode_EnableAGC(false);
 
-    // Check to make sure the operation was successful
-    if (status_byte == MAX32664_ReadStatusByteValue::ERR_TRY_AGAIN)
+    // Re-send while the hub is busy, then check to make sure the operation was successful
+    for (uint8_t retries = 0; status_byte == MAX32664_ReadStatusByteValue::ERR_TRY_AGAIN && retries < MAX32664_MAX_RETRIES; retries++)
     {
-        do
-        {
-            delay(10);
-            status_byte = SetAlgorithmMode_EnableAGC(false);
-        } while (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS);
+        MAX32664_STAT(stats.retries++);
+        wait(10);
+        status_byte = SetAlgorithmMode_EnableAGC(false);
     }
-    else if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
     {
         return status_byte;
     }
 
     // Step 1.11: Enable the HR/SpO2 algorithm.
     status_byte = EnableBPT_Algorithm(0x02);
-    delay(600);
+    wait(600);
 
     // Return the result of the final operation
     return status_byte;
@@ -691,11 +1309,20 @@ uint8_t ReWire_MAX32664::ConfigureBPT_RawValue()
 
 uint8_t ReWire_MAX32664::ReadSample_BPTSensor(MAX32664_Data_VerD &sample)
 {
+    if (!record_matches(MAX32664_Variant::Variant_Unknown, MAX32664_OutputModeFormat::SensorData))
+    {
+        return MAX32664_ReadStatusByteValue::ERR_RECORD_MISMATCH;
+    }
+
     uint8_t read_length = 12;
     uint8_t read_buffer[12] = {0};
 
     // Read the sample
     uint8_t read_status = ReadOutputFifo(read_buffer, read_length);
+    if (read_status == MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        count_sample();
+    }
 
     // Parse the sample
     uint32_t ir0 = ((uint32_t)read_buffer[0]) << 16;
@@ -723,6 +1350,40 @@ uint8_t ReWire_MAX32664::ReadSample_BPTSensor(MAX32664_Data_VerD &sample)
     return read_status;
 }
 
+/// @brief Reads several SensorData samples from the output FIFO in a single transaction and
+///     decodes them with MAX32664_DecodeRawBatch()
+/// @param ir receives num_samples IR values; unchanged unless the read succeeds
+/// @param red receives num_samples red values; unchanged unless the read succeeds
+/// @param num_samples the number of samples to read, at most MAX32664_RAW_BATCH_MAX
+/// @return The status of the read operation
+uint8_t ReWire_MAX32664::ReadSamples_BPTSensor(uint32_t *ir, uint32_t *red, uint8_t num_samples)
+{
+    if (num_samples > MAX32664_RAW_BATCH_MAX)
+    {
+        return MAX32664_ReadStatusByteValue::ERR_INPUT_VALUE;
+    }
+    if (!record_matches(MAX32664_Variant::Variant_Unknown, MAX32664_OutputModeFormat::SensorData))
+    {
+        return MAX32664_ReadStatusByteValue::ERR_RECORD_MISMATCH;
+    }
+
+    uint8_t read_buffer[MAX32664_RAW_BATCH_MAX * MAX32664_RAW_RECORD_SIZE] = {0};
+    uint8_t read_status = ReadOutputFifo(read_buffer, num_samples * MAX32664_RAW_RECORD_SIZE);
+    if (read_status != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        // ir and red are left untouched; the buffer holds no valid records
+        return read_status;
+    }
+
+    for (uint8_t i = 0; i < num_samples; ++i)
+    {
+        count_sample();
+    }
+    MAX32664_DecodeRawBatch(read_buffer, num_samples, ir, red);
+    return read_status;
+}
+#endif
+
 uint8_t ReWire_MAX32664::getMCUType(uint8_t &return_byte)
 {
 
@@ -730,34 +1391,22 @@ uint8_t ReWire_MAX32664::getMCUType(uint8_t &return_byte)
     return status_byte;
 }
 
+#if MAX32664_ENABLE_BPT_CALIBRATION
 uint8_t ReWire_MAX32664::readBPTAlgoCalibData(uint8_t *calibArray)
 {
 
     uint8_t status = read_multiple_bytes(0x51, 0x04, 0x03, calibArray, CALIBVECTOR_SIZE);
     return status;
 }
+#endif
 
-uint8_t ReWire_MAX32664::read_multiple_bytes(uint8_t data1, uint8_t data2, uint8_t data3, uint8_t *read_buffer, uint16_t read_length)
+uint8_t ReWire_MAX32664::read_multiple_bytes(uint8_t data1, uint8_t data2, uint8_t data_3, uint8_t *read_buffer, uint16_t read_length)
 {
-    uint8_t status_byte;
-
-    wire_instance->beginTransmission(max32664_i2c_address);
-    wire_instance->write(data1);
-    wire_instance->write(data2);
-    wire_instance->write(data3);
-    wire_instance->endTransmission();
-    delay(MAX32664_COMMAND_DELAY);
-
-    wire_instance->requestFrom(max32664_i2c_address, read_length + 1, 0, 0, true);
-    status_byte = wire_instance->read();
-    for (uint16_t i = 0; i < read_length; ++i)
-    {
-        read_buffer[i] = wire_instance->read();
-    }
-
-    return status_byte;
+    uint8_t command[3] = {data1, data2, data_3};
+    return transfer(TracePrimitive_ReadMultipleBytes, command, 3, NULL, 0, MAX32664_COMMAND_DELAY, read_buffer, read_length);
 }
 
+#if MAX32664_ENABLE_BPT_CALIBRATION
 uint8_t ReWire_MAX32664::Configure_BPTCalibrationMode()
 {
     uint8_t status_byte = setDataTime();
@@ -770,7 +1419,7 @@ uint8_t ReWire_MAX32664::Configure_BPTCalibrationMode()
     {
         return status_byte;
     }
-    status_byte = SetOutputMode_FifoInterruptThreshold(0x0F);
+    status_byte = SetOutputMode_FifoInterruptThreshold(fifo_threshold);
 
     // Check to make sure the operation was successful
     if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
@@ -798,28 +1447,32 @@ uint8_t ReWire_MAX32664::Configure_BPTCalibrationMode()
 }
 uint8_t ReWire_MAX32664::Start_BPTCalibrationMode(uint8_t calIndex, uint8_t systolicValue, uint8_t dystolicValue)
 {
+    // Reference values per calibration index (0x50 0x04 0x07) only exist in FW VER. 40.5.0 and later
+    if (capabilities.detected && capabilities.has_bpt && !capabilities.has_bpt_calibration_index)
+    {
+        return MAX32664_ReadStatusByteValue::ERR_UNAVAIL_FUNC;
+    }
+
     uint8_t status_byte = setCalibrationIndex(calIndex, systolicValue, dystolicValue);
     if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
     {
         return status_byte;
     }
-    delay(10);
+    wait(10);
 
     status_byte = EnableBPT_Algorithm(0x01);
 
-    if (status_byte == MAX32664_ReadStatusByteValue::ERR_TRY_AGAIN)
+    for (uint8_t retries = 0; status_byte == MAX32664_ReadStatusByteValue::ERR_TRY_AGAIN && retries < MAX32664_MAX_RETRIES; retries++)
     {
-        do
-        {
-            delay(1);
-            status_byte = EnableBPT_Algorithm(0x01);
-        } while (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS);
+        MAX32664_STAT(stats.retries++);
+        wait(1);
+        status_byte = EnableBPT_Algorithm(0x01);
     }
-    else if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
     {
         return status_byte;
     }
-    delay(100);
+    wait(100);
     return status_byte;
 }
 
@@ -828,8 +1481,25 @@ uint8_t ReWire_MAX32664::setCalibrationIndex(uint8_t calIndex, uint8_t systolicV
     uint8_t buffer[3] = {calIndex, systolicValue, dystolicValue};
     return write_multiple_bytes(0x50, 0x04, 0x07, buffer, 3, 5);
 }
+#endif
+
+#if MAX32664_ENABLE_VARIANT_D
 uint8_t ReWire_MAX32664::setCalibrationIndex(uint8_t calIndex)
 {
     uint8_t buffer[1] = {calIndex};
     return write_multiple_bytes(0x50, 0x04, 0x08, buffer, 1, 5);
-}
\ No newline at end of file
+}
+uint8_t ReWire_MAX32664::configure_legacy_bpt_settings()
+{
+    // Step 1.2: The user does not take BP medication
+    uint8_t setting[1] = {0x00};
+    uint8_t status_byte = write_multiple_bytes(MAX32664_CommandFamilyByte::SetAlgorithmConfiguration, 0x04, MAX32664_ConfigrationIndex::BPMedication, setting, 1, 5);
+    if (status_byte != MAX32664_ReadStatusByteValue::SUCCESS_STATUS)
+    {
+        return status_byte;
+    }
+
+    // Step 1.3: The user is resting
+    return write_multiple_bytes(MAX32664_CommandFamilyByte::SetAlgorithmConfiguration, 0x04, MAX32664_ConfigrationIndex::NonRestingEstimation, setting, 1, 5);
+}
+#endif
@@ -4,10 +4,51 @@
 #include <Arduino.h>
 #include <Wire.h>
 #include <algorithm>
+#include "MAX32664_Config.h"
+#include "MAX32664_Bus.h"
+#include "MAX32664_BatchDecode.h"
 
 #define MAX32664_I2C_ADDRESS_DEFAULT 0x55
 #define MAX32664_COMMAND_DELAY 5
+// How many times a command is re-sent while the hub answers ERR_TRY_AGAIN, before the
+// ERR_TRY_AGAIN is returned to the caller (the hub guide allows a maximum of five retries)
+#ifndef MAX32664_MAX_RETRIES
+#define MAX32664_MAX_RETRIES 5
+#endif
 #define CALIBVECTOR_SIZE 512
+// Number of calibration vectors a MAX32664D holds (cal_index 0 to 4)
+#define MAX32664_CALIBRATION_POINTS 5
+// Receive buffer of the I2C driver, which limits the length of a single read (status byte
+// included). Taken from the Wire library when it says (32 on AVR, 128 on ESP32), otherwise 32.
+#ifndef MAX32664_I2C_BUFFER_SIZE
+#if defined(I2C_BUFFER_LENGTH)
+#define MAX32664_I2C_BUFFER_SIZE I2C_BUFFER_LENGTH
+#elif defined(BUFFER_LENGTH)
+#define MAX32664_I2C_BUFFER_SIZE BUFFER_LENGTH
+#else
+#define MAX32664_I2C_BUFFER_SIZE 32
+#endif
+#endif
+// Most SensorData records that fit in a single output FIFO read
+#define MAX32664_RAW_BATCH_MAX ((MAX32664_I2C_BUFFER_SIZE - 1) / MAX32664_RAW_RECORD_SIZE)
+
+// Sensor hub interrupt threshold set by the Configure* functions (the value used in the datasheet
+// example). SetEventCallback() lowers it to 1 for low-latency subscribers.
+#define MAX32664_FIFO_THRESHOLD_DEFAULT 0x0F
+
+// Previous value of an event when there was no earlier record to compare with
+#define MAX32664_EVENT_UNKNOWN 0xFF
+
+// Values of MAX32664_Data::algorithm_state and algorithm_status that mean the reading is usable
+// (see "measuring-heart-rate-and-spo2-using-the-max32664a.pdf", output FIFO format).
+#define MAX32664_ALGORITHM_STATE_FINGER_DETECTED 3
+#define MAX32664_ALGORITHM_STATUS_SUCCESS 0
+
+// Value of MAX32664_Data_VerD::bp_status while an estimation is running, and once it succeeded
+// (see "MAX32664D Quick Start Guide", Table 4)
+#define MAX32664_BP_STATUS_IN_PROGRESS 1
+#define MAX32664_BP_STATUS_SUCCESS 2
+
 struct MAX32664_Data
 {
     uint32_t ir;
@@ -20,7 +61,7 @@ struct MAX32664_Data
     uint16_t spo2;
     uint8_t algorithm_state;
     uint8_t algorithm_status;
-    uint16_t interbeat_interval;
+    uint16_t interbeat_interval; // ms
 };
 struct MAX32664_Data_VerD
 {
@@ -55,6 +96,13 @@ enum MAX32664_ReadStatusByteValue
     ERR_BTLDR_AUTH = 0x82,
     ERR_BTLDR_INVALID_APP = 0x83,
 
+    // Not sent by the hub: the driver refused to read a record whose layout does not match the
+    // detected hub variant or the configured output mode.
+    ERR_RECORD_MISMATCH = 0xF0,
+    // Not sent by the hub: the hub answered SUCCESS_STATUS but fewer bytes than requested were
+    // received, e.g. because the read does not fit in the buffer of the I2C driver.
+    ERR_SHORT_READ = 0xF1,
+
     ERR_TRY_AGAIN = 0xFE,
     ERR_UNKNOWN = 0xFF
 };
@@ -112,20 +160,158 @@ enum MAX32664_OutputModeFormat
 
 enum MAX32664_ConfigrationIndex
 {
+    BPMedication = 0x00,
     SystolicBPCalibrationValues = 0x01,
     DiastolicBPCalibrationValues = 0x02,
     BPCalibrationData = 0x03,
     SetDateAndTime = 0x04,
+    NonRestingEstimation = 0x05,
     SpO2CalibrationCoefficients = 0x06
 };
 
+enum MAX32664_Variant
+{
+    Variant_Unknown = 0x00,
+    Variant_A = 0x0A,
+    Variant_B = 0x0B,
+    Variant_C = 0x0C,
+    Variant_D = 0x0D
+};
+
+enum MAX32664_McuType
+{
+    McuType_MAX32625 = 0x00,
+    McuType_MAX32660 = 0x01 // MAX32660/MAX32664
+};
+
+struct MAX32664_Capabilities
+{
+    bool detected;  // false if the hub could not be identified; nothing is rejected in that case
+    uint8_t variant; // MAX32664_Variant
+    uint8_t mcu_type; // MAX32664_McuType
+    uint8_t firmware_major;
+    uint8_t firmware_minor;
+    uint8_t firmware_revision;
+    uint8_t sensor_record_size;    // bytes of PPG data per sample (MAX30101, no accelerometer)
+    uint8_t algorithm_record_size; // bytes of algorithm data per sample
+    bool has_bpt;                   // blood pressure trending (MAX32664D)
+    bool needs_legacy_bpt_settings; // BPT firmware before 40.2.2 needs the medication and rest settings
+    bool has_bpt_calibration_index; // BPT firmware 40.5.0+ takes reference values per calibration index
+};
+
+enum MAX32664_StatsFamily
+{
+    StatsFamily_Status = 0x00,
+    StatsFamily_DeviceMode = 0x01,
+    StatsFamily_OutputMode = 0x02,
+    StatsFamily_OutputFifo = 0x03,
+    StatsFamily_InputFifo = 0x04,
+    StatsFamily_Sensor = 0x05,
+    StatsFamily_Algorithm = 0x06,
+    StatsFamily_Identity = 0x07,
+    StatsFamily_Other = 0x08,
+
+    StatsFamily_Count = 0x09
+};
+
+struct MAX32664_FamilyStats
+{
+    uint32_t transactions;
+    uint32_t bytes_written;
+    uint32_t bytes_read; // including the status byte
+};
+
+struct MAX32664_Stats
+{
+    MAX32664_FamilyStats family[StatsFamily_Count];
+    uint32_t delay_ms;           // time spent blocked in command and configuration delays
+    uint32_t try_again;          // ERR_TRY_AGAIN status bytes received
+    uint32_t retries;            // commands re-sent after ERR_TRY_AGAIN
+    uint32_t short_reads;        // reads where the hub sent fewer bytes than requested
+    uint32_t write_errors;       // writes the hub did not acknowledge
+    uint32_t fifo_out_overflows; // FifoOutOvrInt seen by ReadSensorHubStatus
+    uint32_t fifo_in_overflows;  // FifoInOvrInt seen by ReadSensorHubStatus
+    uint32_t samples;            // samples read from the output FIFO
+    uint32_t elapsed_ms;         // time since the counters were last reset
+    float samples_per_second;
+    uint32_t max_drain_latency_us; // worst time from ReadNumberAvailableSamples to the last sample read
+};
+
+enum MAX32664_TracePrimitive
+{
+    TracePrimitive_ReadByte = 0x00,
+    TracePrimitive_ReadMultipleBytes = 0x01,
+    TracePrimitive_WriteByte = 0x02,
+    TracePrimitive_WriteMultipleBytes = 0x03
+};
+
+struct MAX32664_TraceRecord
+{
+    uint32_t start_us;
+    uint32_t end_us;
+    uint16_t length; // bytes written + bytes requested (including the status byte)
+    uint8_t family;
+    uint8_t index;
+    uint8_t status;
+    uint8_t primitive; // MAX32664_TracePrimitive
+};
+
+enum MAX32664_EventType
+{
+    Event_Beat = 0x01,               // a MAX32664D record flagged a pulse peak (pulse_flag)
+    Event_AlgorithmState = 0x02,     // algorithm_state of a MAX32664A record changed
+    Event_BptStatus = 0x04,          // bp_status of a MAX32664D record changed
+    Event_BptProgress = 0x08,        // progress of a MAX32664D record changed
+    Event_FifoOverflow = 0x10,       // ReadSensorHubStatus saw FifoOutOvrInt or FifoInOvrInt
+
+    Event_All = 0x1F
+};
+
+struct MAX32664_Event
+{
+    uint8_t type;     // MAX32664_EventType
+    uint8_t previous; // state, status or progress before the change (MAX32664_EVENT_UNKNOWN for the first record)
+    uint8_t current;  // state, status or progress after the change; hub status bits for Event_FifoOverflow
+    uint16_t ibi_ms;  // Event_Beat: interbeat interval
+    float hr;         // Event_Beat: heart rate of the record
+    uint32_t time_us; // micros() when the record was decoded
+};
+
+typedef void (*MAX32664_EventCallback)(const MAX32664_Event &event, void *context);
+
 class ReWire_MAX32664
 {
 private:
-    TwoWire *wire_instance;
+    MAX32664_WireBus wire_bus;
+    MAX32664_Bus *bus;
     int mfio_pin;
     int reset_pin;
     int max32664_i2c_address;
+    MAX32664_Capabilities capabilities;
+    uint8_t output_format;
+    float spo2_coefficients[3];
+    uint8_t fifo_threshold;
+
+#if MAX32664_ENABLE_EVENTS
+    MAX32664_EventCallback event_callback;
+    void *event_context;
+    uint8_t event_mask;
+    uint8_t last_algorithm_state;
+    uint8_t last_bp_status;
+    uint8_t last_progress;
+#endif
+
+#if MAX32664_ENABLE_STATS
+    MAX32664_Stats stats;
+    uint32_t stats_start_ms;
+    uint32_t drain_start_us;
+    uint8_t drain_remaining;
+#endif
+
+#if MAX32664_TRACE_DEPTH > 0
+    MAX32664_TraceRecord trace[MAX32664_TRACE_DEPTH];
+    uint32_t trace_count;
+#endif
 
 public:
     // Constructor
@@ -135,8 +321,25 @@ public:
     void ConfigurePinsAndI2C(TwoWire *i2c_instance = &Wire, int pin_mfio = -1, int pin_reset = -1, int i2c_address = MAX32664_I2C_ADDRESS_DEFAULT);
     uint8_t Begin(uint8_t &device_mode, TwoWire *i2c_instance, int pin_mfio, int pin_reset, int i2c_address = MAX32664_I2C_ADDRESS_DEFAULT);
     uint8_t Begin(uint8_t &device_mode);
+    uint8_t Restart(uint8_t &device_mode, uint16_t boot_timeout = 1000);
+    uint8_t DetectCapabilities();
+    const MAX32664_Capabilities &GetCapabilities() { return capabilities; }
+    uint8_t GetSampleSize();
+    uint8_t ConfigureDevice();
+    void SetBus(MAX32664_Bus *custom_bus);
+    MAX32664_Bus *GetBus() { return bus; }
+    void GetStats(MAX32664_Stats &snapshot);
+    void ResetStats();
+    uint16_t GetTrace(MAX32664_TraceRecord *records, uint16_t max_records);
+    void DumpTrace(Print &output);
+    void ClearTrace();
+#if MAX32664_ENABLE_EVENTS
+    uint8_t SetEventCallback(MAX32664_EventCallback callback, void *context = NULL, uint8_t events = Event_All, bool low_latency = false);
+#endif
+#if MAX32664_ENABLE_VARIANT_A
     uint8_t ReadSample_SensorAndAlgorithm(MAX32664_Data &sample);
     uint8_t ConfigureDevice_SensorAndAlgorithm();
+#endif
     uint8_t ReadSensorHubStatus(uint8_t &status);
     uint8_t ReadDeviceMode(uint8_t &device_mode);
     uint8_t ReadSensorHubVersion(uint8_t &major_version, uint8_t &minor_version, uint8_t &revision_number);
@@ -148,33 +351,70 @@ public:
     uint8_t EnableAlgorithmMode_MaximFast(uint8_t mode);
     uint8_t ReadNumberAvailableSamples(uint8_t &num_samples);
     uint8_t ReadOutputFifo(uint8_t *read_buffer, uint8_t read_length);
+#if MAX32664_ENABLE_INPUT_FIFO
+    uint8_t ReadInputFifoSampleSize(uint8_t &sample_size);
+    uint8_t ReadInputFifoSize(uint16_t &max_samples);
+    uint8_t ReadSensorFifoSize(uint16_t &max_samples);
+    uint8_t ReadInputFifoCount(uint16_t &num_samples);
+    uint8_t ReadSensorFifoCount(uint16_t &num_samples);
+    uint8_t WriteInputFifo(const uint8_t *samples, uint16_t length);
+    uint8_t EnableHostAccelerometer(bool enable);
+#endif
 
     uint8_t loadSpo2Coefficients(float spo2CalibCoefA, float spo2CalibCoefB, float spo2CalibCoefC);
+    void GetSpo2Coefficients(float &spo2CalibCoefA, float &spo2CalibCoefB, float &spo2CalibCoefC);
     uint8_t setDataTime();
+    uint8_t getMCUType(uint8_t &return_byte);
+    uint8_t read_multiple_bytes(uint8_t data1, uint8_t data2, uint8_t data_3, uint8_t *read_buffer, uint16_t read_length);
+#if MAX32664_ENABLE_VARIANT_D
     uint8_t ReadSample_BPTSensorAndAlgorithm(MAX32664_Data_VerD &sample);
-    uint8_t ConfigureBPT_SensorAndAlgorithm();
+    uint8_t ConfigureBPT_SensorAndAlgorithm(const uint8_t *calibration_vectors = NULL, uint8_t count = MAX32664_CALIBRATION_POINTS);
+#endif
+#if MAX32664_ENABLE_RAW_OUTPUT
     uint8_t ConfigureBPT_RawValue();
     uint8_t ReadSample_BPTSensor(MAX32664_Data_VerD &sample);
-    uint8_t getMCUType(uint8_t &return_byte);
-    uint8_t read_multiple_bytes(uint8_t data1, uint8_t data2, uint8_t data_3, uint8_t *read_buffer, uint16_t read_length);
+    uint8_t ReadSamples_BPTSensor(uint32_t *ir, uint32_t *red, uint8_t num_samples);
+#endif
+#if MAX32664_ENABLE_BPT_CALIBRATION
     uint8_t readBPTAlgoCalibData(uint8_t *calibArray);
     uint8_t Configure_BPTCalibrationMode();
     uint8_t Start_BPTCalibrationMode(uint8_t calIndex, uint8_t systolicValue, uint8_t dystolicValue);
+#endif
 
+#if MAX32664_ENABLE_VARIANT_D
     //@note maybe as private functions
-    uint8_t loadBPTCalibVector(uint8_t *buffer, uint16_t buffer_size);
+    uint8_t loadBPTCalibVector(const uint8_t *buffer, uint16_t buffer_size);
     uint8_t EnableBPT_Algorithm(uint8_t mode);
+#endif
 
 private:
+    uint8_t transfer(uint8_t primitive, const uint8_t *command, uint8_t command_length, const uint8_t *payload, uint16_t payload_length, uint16_t cmd_delay, uint8_t *read_buffer, uint16_t read_length);
+    void reset_hub();
+    bool record_matches(uint8_t variant, uint8_t format);
+    void wait(uint16_t milliseconds);
+    void count_sample();
+#if MAX32664_ENABLE_EVENTS
+    void raise_event(uint8_t type, uint8_t previous, uint8_t current);
+    void raise_state_events(const MAX32664_Data &sample);
+    void raise_state_events(const MAX32664_Data_VerD &sample);
+#endif
     uint8_t read_byte(uint8_t data1, uint8_t data2, uint8_t &return_byte);
     uint8_t read_multiple_bytes(uint8_t data1, uint8_t data2, uint8_t *read_buffer, uint8_t read_length);
+#if MAX32664_ENABLE_INPUT_FIFO
+    uint8_t read_word(uint8_t data1, uint8_t data2, uint16_t &return_word);
+#endif
 
     uint8_t write_byte(uint8_t data1, uint8_t data2, uint8_t data3);
     uint8_t write_byte_with_custom_cmd_delay(uint8_t data1, uint8_t data2, uint8_t data3, uint16_t cmd_delay);
-    uint8_t write_multiple_bytes(uint8_t data1, uint8_t data2, uint8_t data3, uint8_t *buffer, uint16_t buffer_size);
-    uint8_t write_multiple_bytes(uint8_t data1, uint8_t data2, uint8_t data3, uint8_t *buffer, uint16_t buffer_size, uint16_t cmd_delay);
-    uint8_t setCalibrationIndex(uint8_t calIndex, uint8_t systolicValue, uint8_t dystolicValue);
+    uint8_t write_multiple_bytes(uint8_t data1, uint8_t data2, uint8_t data3, const uint8_t *buffer, uint16_t buffer_size);
+    uint8_t write_multiple_bytes(uint8_t data1, uint8_t data2, uint8_t data3, const uint8_t *buffer, uint16_t buffer_size, uint16_t cmd_delay);
+#if MAX32664_ENABLE_VARIANT_D
+    uint8_t configure_legacy_bpt_settings();
     uint8_t setCalibrationIndex(uint8_t calIndex);
+#endif
+#if MAX32664_ENABLE_BPT_CALIBRATION
+    uint8_t setCalibrationIndex(uint8_t calIndex, uint8_t systolicValue, uint8_t dystolicValue);
+#endif
 };
 
 #endif /* __REWIRE_MAX32664_H */